@@ -0,0 +1,53 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char *extensions[] = {".c", ".h", ".tar.gz", ".gz"};
+    char *files[] = {"plstr.c", "release.tar.gz", "notes.txt"};
+    pl_affixset *set;
+
+    set = pl_affixset_new(extensions, 4, PL_SUFFIX);
+    if (set == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        int idx = pl_affixset_match(set, files[i]);
+
+        if (idx >= 0) {
+            printf("%s: %s\n", files[i], extensions[idx]);
+        }
+
+        else {
+            printf("%s: no match\n", files[i]);
+        }
+    }
+
+    pl_affixset_free(set);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+
+
+int main() {
+    char *lines[] = {
+        "ERROR disk full", "INFO started", "ERROR timeout, ERROR retry"
+    };
+    int total = 0;
+
+    if (pl_cache_enable(16) == -1) {
+        return 1;
+    }
+
+    // The pattern is compiled on the first call, and reused after that.
+    for (int i = 0; i < 3; i++) {
+        total += pl_count(lines[i], "ERROR");
+    }
+
+    printf("errors: %d\n", total);
+
+    pl_cache_disable();
+
+    return 0;
+}
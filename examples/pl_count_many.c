@@ -0,0 +1,48 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char *keywords[] = {"ERROR", "WARN", "timeout"};
+    char log[] = "WARN slow\nERROR timeout\nERROR disk\n";
+    int counts[3];
+    pl_multi_pattern *mp;
+
+    mp = pl_multi_pattern_new(keywords, 3);
+    if (mp == NULL) {
+        return 1;
+    }
+
+    if (pl_count_many(mp, log, counts) != -1) {
+        for (int i = 0; i < 3; i++) {
+            printf("%s: %d\n", keywords[i], counts[i]);
+        }
+    }
+
+    pl_multi_pattern_free(mp);
+
+    return 0;
+}
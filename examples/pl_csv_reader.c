@@ -0,0 +1,59 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+#include <string.h>
+
+
+static int print_row(pl_span *fields, size_t count, void *arg) {
+    for (size_t i = 0; i < count; i++) {
+        printf("%s[%.*s]", i ? " " : "", (int) fields[i].length, fields[i].ptr);
+    }
+
+    printf("\n");
+
+    return 0;
+}
+
+
+int main() {
+    char *chunks[] = {
+        "id,name,comment\r\n1,Ada,\"likes \"\"commas\"\", a",
+        "nd\nnewlines\"\n2,Bob,plain\n3,Eve,\"no newline at the end\""
+    };
+    pl_csv_reader *reader;
+
+    reader = pl_csv_reader_new(',', '"', print_row, NULL);
+    if (reader == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        pl_csv_reader_feed(reader, chunks[i], strlen(chunks[i]));
+    }
+
+    pl_csv_reader_finish(reader);
+    pl_csv_reader_free(reader);
+
+    return 0;
+}
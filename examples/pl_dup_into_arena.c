@@ -0,0 +1,54 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char *records[] = {"id=1 name=ada", "id=2 name=grace"};
+    pl_arena *arena = pl_arena_new(0);
+    pl_span parts[3];
+    char *key, *value;
+
+    if (arena == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        pl_rpartition(records[i], "=", parts);
+
+        key = pl_dup_into_arena(arena, records[i], parts[0].length);
+        value = pl_dup_into_arena(arena, parts[2].ptr, parts[2].length);
+
+        if (key != NULL && value != NULL) {
+            printf("%s -> %s\n", key, value);
+        }
+
+        pl_arena_reset(arena);
+    }
+
+    pl_arena_free(arena);
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+
+
+int main() {
+    char line[] = "ts=1700000000 method=GET path=\"/a b\" status=200 ua=\"x\\\"y\"";
+    char *wanted[] = {"path", "status", "ua"};
+    pl_kv_filter *filter;
+    pl_kv_pair pairs[8];
+    ptrdiff_t count;
+
+    filter = pl_kv_filter_new(wanted, 3);
+    if (filter == NULL) {
+        return 1;
+    }
+
+    count = pl_kv_parse(line, ' ', '=', '"', filter, pairs, 8);
+
+    for (ptrdiff_t i = 0; i < count; i++) {
+        printf("%.*s -> %.*s\n", (int) pairs[i].key.length, pairs[i].key.ptr,
+               (int) pairs[i].value.length, pairs[i].value.ptr);
+    }
+
+    pl_kv_filter_free(filter);
+
+    return 0;
+}
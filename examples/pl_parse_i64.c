@@ -0,0 +1,50 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+
+int main() {
+    int64_t values[8];
+    double price;
+    ptrdiff_t count;
+    pl_span span = {"-9223372036854775808", 20};
+
+    count = pl_split_to_i64("17,-4,+250,1000000000000", ",", values, 8);
+    for (ptrdiff_t i = 0; i < count; i++) {
+        printf("%" PRId64 "\n", values[i]);
+    }
+
+    if (pl_parse_i64(span, &values[0]) == 0) {
+        printf("min: %" PRId64 "\n", values[0]);
+    }
+
+    span.ptr = "1.25e2";
+    span.length = 6;
+    if (pl_parse_f64(span, &price) == 0) {
+        printf("price: %.2f\n", price);
+    }
+
+    return 0;
+}
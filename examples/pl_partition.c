@@ -0,0 +1,49 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdio.h>
+
+
+int main() {
+    char *lines[] = {"host=db01.example", "port=5432", "readonly"};
+    pl_span parts[3 * 3];
+
+    if (pl_partition_many(lines, 3, "=", parts) == -1) {
+        return 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        pl_span *kv = parts + 3 * i;
+
+        printf("key: %.*s value: %.*s\n", (int) kv[0].length, kv[0].ptr,
+               (int) kv[2].length, kv[2].ptr);
+    }
+
+    pl_partition("db01.example:5432", ":", parts);
+    printf("host: %.*s\n", (int) parts[0].length, parts[0].ptr);
+
+    pl_rpartition("/usr/local/bin/env", "/", parts);
+    printf("name: %.*s\n", (int) parts[2].length, parts[2].ptr);
+
+    return 0;
+}
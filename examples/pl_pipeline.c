@@ -0,0 +1,75 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "pl_pipeline.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static int print_items(pl_span *items, size_t count, void *arg) {
+    for (size_t i = 0; i < count; i++) {
+        printf("%.*s\n", (int) items[i].length, items[i].ptr);
+    }
+
+    return 0;
+}
+
+
+int main() {
+    char input[] = "  ERROR Disk Full  \nINFO ok\n ERROR Timeout, retry\n";
+    pl_pipeline_stats stats;
+    pl_pipeline *pipeline;
+    int fds[2], errors;
+
+    if (pipe(fds) == -1) {
+        return 1;
+    }
+
+    write(fds[1], input, strlen(input));
+    close(fds[1]);
+
+    pipeline = pl_pipeline_new(4, 0, PL_PIPELINE_ORDERED);
+    if (pipeline == NULL) {
+        return 1;
+    }
+
+    pl_pipeline_strip(pipeline, NULL);
+    errors = pl_pipeline_count(pipeline, "ERROR");
+    pl_pipeline_lower(pipeline);
+    pl_pipeline_translate(pipeline, NULL, ",");
+    pl_pipeline_split(pipeline, " ");
+    pl_pipeline_sink(pipeline, print_items, NULL);
+
+    if (pl_pipeline_run(pipeline, fds[0]) == 0) {
+        pl_pipeline_get_stats(pipeline, &stats);
+        printf("errors: %d lines: %d\n", (int) pl_pipeline_counter(pipeline, errors),
+               (int) stats.lines);
+    }
+
+    pl_pipeline_free(pipeline);
+    close(fds[0]);
+
+    return 0;
+}
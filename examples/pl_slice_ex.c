@@ -0,0 +1,59 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "subdermatoglyphic";
+    size_t length = strlen(the_string);
+    char *sliced;
+
+    sliced = pl_slice_ex(the_string, length, PL_SLICE_NONE, PL_SLICE_NONE, -1, NULL);
+    if (sliced != NULL) {
+        printf("[::-1]: %s\n", sliced);
+        free(sliced);
+    }
+
+    sliced = pl_slice_ex(the_string, length, 1, PL_SLICE_NONE, 2, NULL);
+    if (sliced != NULL) {
+        printf("[1::2]: %s\n", sliced);
+        free(sliced);
+    }
+
+    sliced = pl_slice_ex(the_string, length, -3, 2, -3, NULL);
+    if (sliced != NULL) {
+        printf("[-3:2:-3]: %s\n", sliced);
+        free(sliced);
+    }
+
+    sliced = pl_slice_ex(the_string, length, 3, 100, 1, NULL);
+    if (sliced != NULL) {
+        printf("[3:100]: %s\n", sliced);
+        free(sliced);
+    }
+
+    return 0;
+}
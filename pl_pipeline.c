@@ -0,0 +1,1924 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file pl_pipeline.c
+ *
+ * A pipeline that runs a chain of plstr operations over the lines of a file
+ * on several threads. The calling thread reads the input into batches of whole
+ * lines, the worker threads run the chain over the lines of a batch, and a
+ * sink thread passes the results to a callback, in input order if asked to.
+ * The stages are connected with bounded lock free queues, so a slow stage
+ * makes the stage before it wait instead of buffering without limit.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include "pl_pipeline.h"
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define PL_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+// How many times a thread retries a full or empty queue before it sleeps.
+#define PIPELINE_SPIN   64
+
+
+enum stage_kind {
+    STAGE_STRIP,
+    STAGE_LOWER,
+    STAGE_TRANSLATE,
+    STAGE_SPLIT,
+    STAGE_FILTER,
+    STAGE_COUNT
+};
+
+
+/**
+ * @brief One operation of the chain. \a text holds the characters, the
+ * delimiter or the word of the operation.
+ */
+struct stage {
+    enum stage_kind kind;
+    char *text;
+    size_t text_length;
+    unsigned char *table;
+    pl_pipeline_filter_fn filter;
+    void *arg;
+    int counter;
+};
+
+
+struct queue_cell {
+    size_t sequence;
+    void *data;
+};
+
+
+/**
+ * @brief Lets a thread sleep until another thread has changed what it waits
+ * for. A waiter registers itself before it checks its condition a last time,
+ * so a change made after that check always wakes it up, and a thread that
+ * makes a change only takes the lock when someone is waiting.
+ */
+struct eventcount {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned epoch;
+    int waiters;
+};
+
+
+/**
+ * @brief Bounded multi producer multi consumer queue (Vyukov). Every cell
+ * has a sequence number that tells if it is ready to be written or read for
+ * the current lap, so a push or pop is one compare and swap on the position.
+ * The positions are on their own cache lines.
+ */
+struct queue {
+    struct queue_cell *cells;
+    size_t mask;
+    struct eventcount readable;
+    struct eventcount writable;
+    char pad0[64];
+    size_t enqueue_pos;
+    char pad1[64];
+    size_t dequeue_pos;
+    char pad2[64];
+};
+
+
+/**
+ * @brief A batch of whole lines, and the items that came out of it.
+ */
+struct batch {
+    uint64_t sequence;
+    char *data;
+    size_t length;
+    size_t capacity;
+    uint64_t lines;
+    char *out;
+    size_t out_length;
+    pl_span *items;
+    size_t item_count;
+    size_t item_capacity;
+};
+
+
+struct pl_pipeline {
+    int workers;
+    size_t batch_size;
+    int ordered;
+    struct stage *stages;
+    int stage_count;
+    int64_t *counters;
+    int counter_count;
+    pl_pipeline_sink_fn sink;
+    void *sink_arg;
+    struct queue input;
+    struct queue output;
+    size_t window;
+    uint64_t sequence;
+    uint64_t delivered;
+    struct eventcount progress;
+    double blocked_seconds;
+    int stopped;
+    int failed;
+    pl_pipeline_stats stats;
+};
+
+
+struct worker {
+    pl_pipeline *pipeline;
+    pthread_t thread;
+    char **scratch;
+    size_t *scratch_capacity;
+    int64_t *counters;
+    struct batch *batch;
+    uint64_t waits;
+    uint64_t stalls;
+    uint64_t items;
+    double seconds;
+};
+
+
+struct sink_state {
+    pl_pipeline *pipeline;
+    pthread_t thread;
+    uint64_t waits;
+    double seconds;
+};
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int event_init(struct eventcount *ec) {
+    ec->epoch = 0;
+    ec->waiters = 0;
+
+    if (pthread_mutex_init(&ec->lock, NULL) != 0) {
+        return -1;
+    }
+
+    if (pthread_cond_init(&ec->cond, NULL) != 0) {
+        pthread_mutex_destroy(&ec->lock);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void event_destroy(struct eventcount *ec) {
+    pthread_cond_destroy(&ec->cond);
+    pthread_mutex_destroy(&ec->lock);
+}
+
+
+/**
+ * @brief Registers the calling thread as a waiter, and returns the epoch that
+ * \ref event_wait sleeps on. The condition must be checked again after this,
+ * and the wait cancelled with \ref event_cancel if it already holds.
+ */
+static unsigned event_prepare(struct eventcount *ec) {
+    __atomic_add_fetch(&ec->waiters, 1, __ATOMIC_SEQ_CST);
+
+    return __atomic_load_n(&ec->epoch, __ATOMIC_ACQUIRE);
+}
+
+
+static void event_cancel(struct eventcount *ec) {
+    __atomic_sub_fetch(&ec->waiters, 1, __ATOMIC_RELAXED);
+}
+
+
+static void event_wait(struct eventcount *ec, unsigned epoch) {
+    pthread_mutex_lock(&ec->lock);
+
+    while (__atomic_load_n(&ec->epoch, __ATOMIC_RELAXED) == epoch) {
+        pthread_cond_wait(&ec->cond, &ec->lock);
+    }
+
+    pthread_mutex_unlock(&ec->lock);
+    event_cancel(ec);
+}
+
+
+/**
+ * @brief Wakes the threads waiting on an eventcount, after a change they may
+ * be waiting for has been published.
+ */
+static void event_notify(struct eventcount *ec) {
+    /*
+     * A read-modify-write, so it is ordered with the increment in
+     * event_prepare. Either it sees the waiter, or the waiter sees the change
+     * when it checks its condition again.
+     */
+    if (__atomic_add_fetch(&ec->waiters, 0, __ATOMIC_SEQ_CST) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&ec->lock);
+    __atomic_store_n(&ec->epoch, ec->epoch + 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&ec->cond);
+    pthread_mutex_unlock(&ec->lock);
+}
+
+
+static int queue_init(struct queue *q, size_t capacity) {
+    q->cells = (struct queue_cell *) malloc(capacity * sizeof(struct queue_cell));
+    if (q->cells == NULL) {
+        return -1;
+    }
+
+    if (event_init(&q->readable) == -1) {
+        goto error_exit;
+    }
+
+    if (event_init(&q->writable) == -1) {
+        event_destroy(&q->readable);
+        goto error_exit;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        q->cells[i].sequence = i;
+    }
+
+    q->mask = capacity - 1;
+    q->enqueue_pos = 0;
+    q->dequeue_pos = 0;
+
+    return 0;
+
+error_exit:
+    free(q->cells);
+    q->cells = NULL;
+
+    return -1;
+}
+
+
+static void queue_free(struct queue *q) {
+    if (q->cells == NULL) {
+        return;
+    }
+
+    event_destroy(&q->readable);
+    event_destroy(&q->writable);
+    free(q->cells);
+}
+
+
+static int queue_try_push(struct queue *q, void *data) {
+    size_t pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+    struct queue_cell *cell;
+
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+
+        // The cell has not been read since the last lap, so the queue is full.
+        else if (diff < 0) {
+            return 0;
+        }
+
+        else {
+            pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->data = data;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+
+static int queue_try_pop(struct queue *q, void **data) {
+    size_t pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+    struct queue_cell *cell;
+
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) (pos + 1);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->dequeue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+
+        // The cell has not been written this lap, so the queue is empty.
+        else if (diff < 0) {
+            return 0;
+        }
+
+        else {
+            pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    *data = cell->data;
+    __atomic_store_n(&cell->sequence, pos + q->mask + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+
+/**
+ * @brief Pushes to a queue. While it is full the push spins for a short while
+ * and then sleeps until a pop makes room. Every push that had to wait is
+ * counted in \a stalls.
+ */
+static void queue_push(struct queue *q, void *data, uint64_t *stalls) {
+    int spins = 0;
+
+    if (!queue_try_push(q, data)) {
+        (*stalls)++;
+
+        while (!queue_try_push(q, data)) {
+            if (spins++ < PIPELINE_SPIN) {
+                continue;
+            }
+
+            unsigned epoch = event_prepare(&q->writable);
+
+            if (queue_try_push(q, data)) {
+                event_cancel(&q->writable);
+                break;
+            }
+
+            event_wait(&q->writable, epoch);
+        }
+    }
+
+    event_notify(&q->readable);
+}
+
+
+/**
+ * @brief Pops from a queue. While it is empty the pop spins for a short while
+ * and then sleeps until a push. Every pop that had to wait is counted in
+ * \a waits.
+ */
+static void *queue_pop(struct queue *q, uint64_t *waits) {
+    void *data;
+    int spins = 0;
+
+    if (!queue_try_pop(q, &data)) {
+        (*waits)++;
+
+        while (!queue_try_pop(q, &data)) {
+            if (spins++ < PIPELINE_SPIN) {
+                continue;
+            }
+
+            unsigned epoch = event_prepare(&q->readable);
+
+            if (queue_try_pop(q, &data)) {
+                event_cancel(&q->readable);
+                break;
+            }
+
+            event_wait(&q->readable, epoch);
+        }
+    }
+
+    event_notify(&q->writable);
+
+    return data;
+}
+
+
+/**
+ * @brief Stops the pipeline, and wakes the reader if it waits for the sink.
+ */
+static void pipeline_stop(pl_pipeline *pipeline) {
+    __atomic_store_n(&pipeline->stopped, 1, __ATOMIC_RELEASE);
+    event_notify(&pipeline->progress);
+}
+
+
+static struct batch *batch_new(size_t capacity) {
+    struct batch *batch = (struct batch *) calloc(1, sizeof(struct batch));
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    batch->data = (char *) malloc(capacity);
+    if (batch->data == NULL) {
+        free(batch);
+
+        return NULL;
+    }
+
+    batch->capacity = capacity;
+
+    return batch;
+}
+
+
+static void batch_free(struct batch *batch) {
+    if (batch == NULL) {
+        return;
+    }
+
+    free(batch->data);
+    free(batch->out);
+    free(batch->items);
+    free(batch);
+}
+
+
+/**
+ * @brief Creates a pipeline. Add the operations in the order they should run
+ * with the pl_pipeline_* stage functions, optionally a sink, and start it with
+ * \ref pl_pipeline_run.
+ *
+ * @param workers The number of worker threads, usually the number of cores.
+ *
+ * @param batch_size The number of bytes of input in a batch, lines are never
+ * split over batches. \b 0 uses \b PL_PIPELINE_BATCH.
+ *
+ * @param ordered \b PL_PIPELINE_ORDERED to get the results in input order,
+ * or \b PL_PIPELINE_UNORDERED to get them as soon as they are ready.
+ *
+ * @return Returns a pointer to the pipeline, which you need to free with
+ * \ref pl_pipeline_free. If the function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#define _POSIX_C_SOURCE 200809L
+
+#include "pl_pipeline.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static int print_items(pl_span *items, size_t count, void *arg) {
+    for (size_t i = 0; i < count; i++) {
+        printf("%.*s\n", (int) items[i].length, items[i].ptr);
+    }
+
+    return 0;
+}
+
+
+int main() {
+    char input[] = "  ERROR Disk Full  \nINFO ok\n ERROR Timeout, retry\n";
+    pl_pipeline_stats stats;
+    pl_pipeline *pipeline;
+    int fds[2], errors;
+
+    if (pipe(fds) == -1) {
+        return 1;
+    }
+
+    write(fds[1], input, strlen(input));
+    close(fds[1]);
+
+    pipeline = pl_pipeline_new(4, 0, PL_PIPELINE_ORDERED);
+    if (pipeline == NULL) {
+        return 1;
+    }
+
+    pl_pipeline_strip(pipeline, NULL);
+    errors = pl_pipeline_count(pipeline, "ERROR");
+    pl_pipeline_lower(pipeline);
+    pl_pipeline_translate(pipeline, NULL, ",");
+    pl_pipeline_split(pipeline, " ");
+    pl_pipeline_sink(pipeline, print_items, NULL);
+
+    if (pl_pipeline_run(pipeline, fds[0]) == 0) {
+        pl_pipeline_get_stats(pipeline, &stats);
+        printf("errors: %d lines: %d\n", (int) pl_pipeline_counter(pipeline, errors),
+               (int) stats.lines);
+    }
+
+    pl_pipeline_free(pipeline);
+    close(fds[0]);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+error
+disk
+full
+info
+ok
+error
+timeout
+retry
+errors: 2 lines: 3
+\endcode
+ */
+pl_pipeline *pl_pipeline_new(int workers, size_t batch_size, int ordered) {
+    if (workers < 1) {
+        return NULL;
+    }
+
+    pl_pipeline *pipeline = (pl_pipeline *) calloc(1, sizeof(pl_pipeline));
+    if (pipeline == NULL) {
+        return NULL;
+    }
+
+    if (event_init(&pipeline->progress) == -1) {
+        free(pipeline);
+
+        return NULL;
+    }
+
+    pipeline->workers = workers;
+    pipeline->batch_size = batch_size == 0 ? PL_PIPELINE_BATCH : batch_size;
+    pipeline->ordered = ordered == PL_PIPELINE_ORDERED;
+
+    // Room for a few batches per worker, a power of two for the queue.
+    size_t capacity = 4;
+    while (capacity < (size_t) workers * 2) {
+        capacity *= 2;
+    }
+
+    if (queue_init(&pipeline->input, capacity) == -1 ||
+        queue_init(&pipeline->output, capacity) == -1) {
+        pl_pipeline_free(pipeline);
+
+        return NULL;
+    }
+
+    // The batches an ordered sink can hold while it waits for an older one.
+    pipeline->window = 2 * capacity + workers;
+
+    return pipeline;
+}
+
+
+/**
+ * @brief Frees a pipeline created with \ref pl_pipeline_new.
+ *
+ * @param pipeline The pipeline you want to free.
+ */
+void pl_pipeline_free(pl_pipeline *pipeline) {
+    if (pipeline == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        free(pipeline->stages[i].text);
+        free(pipeline->stages[i].table);
+    }
+
+    free(pipeline->stages);
+    free(pipeline->counters);
+    queue_free(&pipeline->input);
+    queue_free(&pipeline->output);
+    event_destroy(&pipeline->progress);
+    free(pipeline);
+}
+
+
+/**
+ * @brief Appends a stage to the chain, and copies \a text and \a table into
+ * it. The stage is only added once both copies are made. Returns the new
+ * stage, or \b NULL if it can not be allocated.
+ */
+static struct stage *add_stage(pl_pipeline *pipeline, enum stage_kind kind,
+                               char *text, unsigned char *table) {
+    if (pipeline == NULL) {
+        return NULL;
+    }
+
+    struct stage *stages = (struct stage *) realloc(pipeline->stages,
+            (pipeline->stage_count + 1) * sizeof(struct stage));
+    if (stages == NULL) {
+        return NULL;
+    }
+
+    pipeline->stages = stages;
+
+    struct stage *stage = &stages[pipeline->stage_count];
+    memset(stage, 0, sizeof(struct stage));
+    stage->kind = kind;
+
+    if (text != NULL) {
+        stage->text = pl_cpy(text, NULL);
+        if (stage->text == NULL) {
+            return NULL;
+        }
+
+        stage->text_length = strlen(text);
+    }
+
+    if (table != NULL) {
+        stage->table = (unsigned char *) pl_cpy((char *) table, NULL);
+        if (stage->table == NULL) {
+            free(stage->text);
+
+            return NULL;
+        }
+    }
+
+    pipeline->stage_count++;
+
+    return stage;
+}
+
+
+/**
+ * @brief Adds a stage that strips every item, like \ref pl_strip. The item
+ * is not copied.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param chars The characters to strip, or \b NULL to strip whitespace.
+ *
+ * @return Returns \b 0 if the stage was added. If the function fails \b -1 is
+ * returned.
+ */
+int pl_pipeline_strip(pl_pipeline *pipeline, char *chars) {
+    return add_stage(pipeline, STAGE_STRIP, chars, NULL) == NULL ? -1 : 0;
+}
+
+
+/**
+ * @brief Adds a stage that converts every item to lower case, like
+ * \ref pl_lower.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @return Returns \b 0 if the stage was added. If the function fails \b -1 is
+ * returned.
+ */
+int pl_pipeline_lower(pl_pipeline *pipeline) {
+    return add_stage(pipeline, STAGE_LOWER, NULL, NULL) == NULL ? -1 : 0;
+}
+
+
+/**
+ * @brief Adds a stage that translates every item, like \ref pl_translate.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param table Optional, the characters to swap.
+ *
+ * @param deletechars The characters to delete, or to swap in.
+ *
+ * @return Returns \b 0 if the stage was added. If the function fails \b -1 is
+ * returned.
+ */
+int pl_pipeline_translate(pl_pipeline *pipeline, unsigned char *table,
+                          char *deletechars) {
+    if (deletechars == NULL || *deletechars == '\0' ||
+        (table != NULL && strlen((char *) table) != strlen(deletechars))) {
+        return -1;
+    }
+
+    return add_stage(pipeline, STAGE_TRANSLATE, deletechars, table) == NULL ?
+           -1 : 0;
+}
+
+
+/**
+ * @brief Adds a stage that splits every item on a delimiter, the stages after
+ * it run on every token.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param delim The delimiter, it can not be empty.
+ *
+ * @return Returns \b 0 if the stage was added. If the function fails \b -1 is
+ * returned.
+ */
+int pl_pipeline_split(pl_pipeline *pipeline, char *delim) {
+    if (delim == NULL || *delim == '\0') {
+        return -1;
+    }
+
+    return add_stage(pipeline, STAGE_SPLIT, delim, NULL) == NULL ? -1 : 0;
+}
+
+
+/**
+ * @brief Adds a stage that drops the items the callback returns \b 0 for.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param filter The callback, it is called from the worker threads.
+ *
+ * @param arg Passed to the callback.
+ *
+ * @return Returns \b 0 if the stage was added. If the function fails \b -1 is
+ * returned.
+ */
+int pl_pipeline_filter(pl_pipeline *pipeline, pl_pipeline_filter_fn filter,
+                       void *arg) {
+    if (filter == NULL) {
+        return -1;
+    }
+
+    struct stage *stage = add_stage(pipeline, STAGE_FILTER, NULL, NULL);
+    if (stage == NULL) {
+        return -1;
+    }
+
+    stage->filter = filter;
+    stage->arg = arg;
+
+    return 0;
+}
+
+
+/**
+ * @brief Adds a stage that counts a word in every item, like \ref pl_count.
+ * The items are passed on unchanged. Every worker counts on its own, and the
+ * counts are added together at the end of the run.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param word The word to count, it can not be empty.
+ *
+ * @return Returns the id of the counter, to use with
+ * \ref pl_pipeline_counter. If the function fails \b -1 is returned.
+ */
+int pl_pipeline_count(pl_pipeline *pipeline, char *word) {
+    if (pipeline == NULL || word == NULL || *word == '\0') {
+        return -1;
+    }
+
+    int64_t *counters = (int64_t *) realloc(pipeline->counters,
+            (pipeline->counter_count + 1) * sizeof(int64_t));
+    if (counters == NULL) {
+        return -1;
+    }
+
+    pipeline->counters = counters;
+    counters[pipeline->counter_count] = 0;
+
+    struct stage *stage = add_stage(pipeline, STAGE_COUNT, word, NULL);
+    if (stage == NULL) {
+        return -1;
+    }
+
+    stage->counter = pipeline->counter_count++;
+
+    return stage->counter;
+}
+
+
+/**
+ * @brief Sets the callback that gets the items that come out of the chain.
+ * Without a sink the items are dropped, which is useful when only the
+ * counters are needed.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param sink The callback, it is called from the sink thread with the items
+ * of one batch at a time. It returns \b 0 to keep going, anything else stops
+ * the pipeline.
+ *
+ * @param arg Passed to the callback.
+ *
+ * @return Returns \b 0 if the sink was set. If the function fails \b -1 is
+ * returned.
+ */
+int pl_pipeline_sink(pl_pipeline *pipeline, pl_pipeline_sink_fn sink,
+                     void *arg) {
+    if (pipeline == NULL || sink == NULL) {
+        return -1;
+    }
+
+    pipeline->sink = sink;
+    pipeline->sink_arg = arg;
+
+    return 0;
+}
+
+
+/**
+ * @brief Copies a finished item to the output of the batch. No stage makes
+ * an item longer than its line, so the output buffer never needs to grow.
+ */
+static int emit_item(struct worker *worker, char *ptr, size_t length) {
+    struct batch *batch = worker->batch;
+
+    worker->items++;
+
+    if (worker->pipeline->sink == NULL) {
+        return 0;
+    }
+
+    if (batch->item_count == batch->item_capacity) {
+        size_t capacity = batch->item_capacity ? batch->item_capacity * 2 : 256;
+
+        pl_span *items = (pl_span *) realloc(batch->items,
+                                             capacity * sizeof(pl_span));
+        if (items == NULL) {
+            return -1;
+        }
+
+        batch->items = items;
+        batch->item_capacity = capacity;
+    }
+
+    char *out = batch->out + batch->out_length;
+    memcpy(out, ptr, length);
+    batch->out_length += length;
+
+    batch->items[batch->item_count].ptr = out;
+    batch->items[batch->item_count].length = length;
+    batch->item_count++;
+
+    return 0;
+}
+
+
+/**
+ * @brief Makes sure the scratch buffer of a stage has room for \a length
+ * bytes and a NUL terminator.
+ */
+static char *stage_scratch(struct worker *worker, int index, size_t length) {
+    if (worker->scratch_capacity[index] < length + 1) {
+        char *tmp = (char *) realloc(worker->scratch[index], length + 1);
+        if (tmp == NULL) {
+            return NULL;
+        }
+
+        worker->scratch[index] = tmp;
+        worker->scratch_capacity[index] = length + 1;
+    }
+
+    return worker->scratch[index];
+}
+
+
+/**
+ * @brief Runs the stages from \a index on one item. Every stage that changes
+ * the text writes it to its own scratch buffer, so the stages after a split
+ * can reuse them for every token.
+ */
+static int run_stages(struct worker *worker, char *ptr, size_t length,
+                      int index) {
+    pl_pipeline *pipeline = worker->pipeline;
+
+    if (index == pipeline->stage_count) {
+        return emit_item(worker, ptr, length);
+    }
+
+    struct stage *stage = &pipeline->stages[index];
+    char *scratch;
+    pl_span view;
+
+    switch (stage->kind) {
+        case STAGE_STRIP:
+            pl_strip_view(ptr, length, stage->text, stage->text_length, &view);
+
+            return run_stages(worker, view.ptr, view.length, index + 1);
+
+        case STAGE_LOWER:
+            scratch = stage_scratch(worker, index, length);
+            if (scratch == NULL) {
+                return -1;
+            }
+
+            pl_lower_n(ptr, length, scratch);
+
+            return run_stages(worker, scratch, length, index + 1);
+
+        case STAGE_TRANSLATE: {
+            scratch = stage_scratch(worker, index, length);
+            if (scratch == NULL) {
+                return -1;
+            }
+
+            // The result is never longer than the item, so it fits.
+            ptrdiff_t out_length = pl_translate_into(ptr, length, stage->table,
+                                                     stage->text,
+                                                     stage->text_length,
+                                                     scratch);
+            if (out_length == -1) {
+                return -1;
+            }
+
+            return run_stages(worker, scratch, out_length, index + 1);
+        }
+
+        case STAGE_SPLIT: {
+            pl_split_iter iter;
+            pl_span token;
+
+            pl_split_iter_init_n(&iter, ptr, length, stage->text,
+                                 stage->text_length);
+
+            while (pl_split_iter_next(&iter, &token) == 1) {
+                if (run_stages(worker, token.ptr, token.length, index + 1) == -1) {
+                    return -1;
+                }
+            }
+
+            return 0;
+        }
+
+        case STAGE_FILTER:
+            view.ptr = ptr;
+            view.length = length;
+
+            if (!stage->filter(view, stage->arg)) {
+                return 0;
+            }
+
+            return run_stages(worker, ptr, length, index + 1);
+
+        case STAGE_COUNT:
+            if (length > 0) {
+                ptrdiff_t count = pl_count_n(ptr, length, stage->text,
+                                             stage->text_length);
+
+                if (count > 0) {
+                    worker->counters[stage->counter] += count;
+                }
+            }
+
+            return run_stages(worker, ptr, length, index + 1);
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Runs the chain over every line of a batch.
+ */
+static int process_batch(struct worker *worker, struct batch *batch) {
+    pl_split_iter iter;
+    pl_span line;
+    size_t length = batch->length;
+
+    worker->batch = batch;
+
+    if (worker->pipeline->sink != NULL) {
+        batch->out = (char *) malloc(length + 1);
+        if (batch->out == NULL) {
+            return -1;
+        }
+    }
+
+    // The newline at the end of the batch does not start another line.
+    if (length > 0 && batch->data[length - 1] == '\n') {
+        length--;
+    }
+
+    pl_split_iter_init_n(&iter, batch->data, length, "\n", 1);
+
+    while (pl_split_iter_next(&iter, &line) == 1) {
+        batch->lines++;
+
+        if (run_stages(worker, line.ptr, line.length, 0) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void *worker_main(void *arg) {
+    struct worker *worker = (struct worker *) arg;
+    pl_pipeline *pipeline = worker->pipeline;
+    struct batch *batch;
+
+    // The patterns of the stages are compiled once per thread.
+    pl_cache_enable(pipeline->stage_count + 1);
+
+    while ((batch = (struct batch *) queue_pop(&pipeline->input,
+                                               &worker->waits)) != NULL) {
+        if (__atomic_load_n(&pipeline->stopped, __ATOMIC_ACQUIRE)) {
+            batch_free(batch);
+            continue;
+        }
+
+        double start = now();
+
+        if (process_batch(worker, batch) == -1) {
+            __atomic_store_n(&pipeline->failed, 1, __ATOMIC_RELEASE);
+            pipeline_stop(pipeline);
+            batch_free(batch);
+            continue;
+        }
+
+        worker->seconds += now() - start;
+
+        if (pipeline->sink == NULL) {
+            __atomic_fetch_add(&pipeline->stats.lines, batch->lines,
+                               __ATOMIC_RELAXED);
+            batch_free(batch);
+        }
+
+        else {
+            queue_push(&pipeline->output, batch, &worker->stalls);
+        }
+    }
+
+    pl_cache_disable();
+
+    return NULL;
+}
+
+
+/**
+ * @brief Passes the items of the batches to the sink. In an ordered pipeline
+ * a batch that is ahead waits in \a pending until the batches before it have
+ * arrived. The reader never gets more than a window ahead of the last
+ * delivered batch, so two pending batches never share a slot.
+ */
+static void *sink_main(void *arg) {
+    struct sink_state *state = (struct sink_state *) arg;
+    pl_pipeline *pipeline = state->pipeline;
+    size_t window = pipeline->window;
+    struct batch **pending = NULL, *batch;
+    uint64_t next = 0;
+
+    if (pipeline->ordered) {
+        pending = (struct batch **) calloc(window, sizeof(struct batch *));
+        if (pending == NULL) {
+            __atomic_store_n(&pipeline->failed, 1, __ATOMIC_RELEASE);
+            pipeline_stop(pipeline);
+        }
+    }
+
+    while ((batch = (struct batch *) queue_pop(&pipeline->output,
+                                               &state->waits)) != NULL) {
+        if (__atomic_load_n(&pipeline->stopped, __ATOMIC_ACQUIRE)) {
+            batch_free(batch);
+            continue;
+        }
+
+        if (pipeline->ordered) {
+            pending[batch->sequence % window] = batch;
+            batch = pending[next % window];
+        }
+
+        while (batch != NULL &&
+               !__atomic_load_n(&pipeline->stopped, __ATOMIC_ACQUIRE)) {
+            double start = now();
+
+            pipeline->stats.lines += batch->lines;
+            pipeline->stats.items += batch->item_count;
+
+            if (pipeline->sink(batch->items, batch->item_count,
+                               pipeline->sink_arg) != 0) {
+                pipeline_stop(pipeline);
+            }
+
+            state->seconds += now() - start;
+
+            if (!pipeline->ordered) {
+                batch_free(batch);
+                break;
+            }
+
+            pending[next % window] = NULL;
+            batch_free(batch);
+            next++;
+            __atomic_store_n(&pipeline->delivered, next, __ATOMIC_RELEASE);
+            event_notify(&pipeline->progress);
+            batch = pending[next % window];
+        }
+    }
+
+    if (pending != NULL) {
+        for (size_t i = 0; i < window; i++) {
+            batch_free(pending[i]);
+        }
+
+        free(pending);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Finds the end of the last whole line in a buffer.
+ */
+static size_t last_line_end(char *data, size_t length) {
+    pl_span parts[3];
+
+    if (pl_rpartition_n(data, length, "\n", 1, parts) != 1) {
+        return 0;
+    }
+
+    return parts[2].ptr - data;
+}
+
+
+static int window_open(pl_pipeline *pipeline, uint64_t sequence) {
+    return sequence < __atomic_load_n(&pipeline->delivered, __ATOMIC_ACQUIRE) +
+                      pipeline->window ||
+           __atomic_load_n(&pipeline->stopped, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Waits until an ordered sink has room for a batch. Without this one
+ * slow batch would let the others pile up in the sink without limit. The
+ * reader sleeps until the sink delivers a batch or the pipeline is stopped.
+ */
+static void wait_for_window(pl_pipeline *pipeline, uint64_t sequence,
+                            uint64_t *stalls) {
+    if (!pipeline->ordered || pipeline->sink == NULL ||
+        window_open(pipeline, sequence)) {
+        return;
+    }
+
+    (*stalls)++;
+
+    while (!window_open(pipeline, sequence)) {
+        unsigned epoch = event_prepare(&pipeline->progress);
+
+        if (window_open(pipeline, sequence)) {
+            event_cancel(&pipeline->progress);
+            break;
+        }
+
+        event_wait(&pipeline->progress, epoch);
+    }
+}
+
+
+/**
+ * @brief Queues a batch for the workers, or frees it if it is empty. The time
+ * spent waiting for room is not counted as reader time.
+ */
+static void queue_batch(pl_pipeline *pipeline, struct batch *batch) {
+    if (batch->length == 0) {
+        batch_free(batch);
+
+        return;
+    }
+
+    batch->sequence = pipeline->sequence++;
+    pipeline->stats.batches++;
+    pipeline->stats.bytes += batch->length;
+
+    double start = now();
+
+    wait_for_window(pipeline, batch->sequence, &pipeline->stats.reader_stalls);
+    queue_push(&pipeline->input, batch, &pipeline->stats.reader_stalls);
+
+    pipeline->blocked_seconds += now() - start;
+}
+
+
+/**
+ * @brief Reads the input into batches of whole lines and queues them for the
+ * workers. Returns \b -1 if the input can not be read or a batch can not be
+ * allocated.
+ */
+static int read_input(pl_pipeline *pipeline, int fd) {
+    struct batch *batch = batch_new(pipeline->batch_size);
+    int eof = 0;
+
+    if (batch == NULL) {
+        return -1;
+    }
+
+    while (!eof && !__atomic_load_n(&pipeline->stopped, __ATOMIC_ACQUIRE)) {
+        while (batch->length < batch->capacity) {
+            ssize_t n = read(fd, batch->data + batch->length,
+                             batch->capacity - batch->length);
+
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+
+            if (n == -1) {
+                batch_free(batch);
+
+                return -1;
+            }
+
+            if (n == 0) {
+                eof = 1;
+                break;
+            }
+
+            batch->length += n;
+        }
+
+        size_t end = eof ? batch->length : last_line_end(batch->data, batch->length);
+
+        // A line longer than the batch, read more of it into a bigger batch.
+        if (end == 0 && !eof) {
+            char *tmp = (char *) realloc(batch->data, batch->capacity * 2);
+            if (tmp == NULL) {
+                batch_free(batch);
+
+                return -1;
+            }
+
+            batch->data = tmp;
+            batch->capacity *= 2;
+            continue;
+        }
+
+        struct batch *next = NULL;
+
+        if (!eof) {
+            size_t rest = batch->length - end;
+            size_t capacity = pipeline->batch_size;
+
+            while (capacity < rest * 2) {
+                capacity *= 2;
+            }
+
+            next = batch_new(capacity);
+            if (next == NULL) {
+                batch_free(batch);
+
+                return -1;
+            }
+
+            memcpy(next->data, batch->data + end, rest);
+            next->length = rest;
+            batch->length = end;
+        }
+
+        queue_batch(pipeline, batch);
+        batch = next;
+    }
+
+    batch_free(batch);
+
+    return 0;
+}
+
+
+#ifdef PL_HAVE_IO_URING
+
+/**
+ * @brief The rings of an io_uring instance, mapped from the kernel.
+ */
+struct uring {
+    int fd;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+
+
+/**
+ * @brief One input file of an io_uring read. The part after the last newline
+ * of a read is kept in \a carry until the rest of the line has been read. A
+ * file whose first read is refused by the kernel is marked \a fallback, and
+ * read with read() after the rest.
+ */
+struct uring_file {
+    int fd;
+    off_t offset;
+    char *carry;
+    size_t carry_length;
+    size_t carry_capacity;
+    int started;
+    int fallback;
+};
+
+
+static void uring_free(struct uring *ring) {
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED &&
+        ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+}
+
+
+/**
+ * @brief Sets up an io_uring with raw system calls. Returns \b -1 if the
+ * kernel does not have io_uring or does not allow it, or if it is older than
+ * 5.6 and can not do plain reads from the current position of a pipe.
+ */
+static int uring_init(struct uring *ring, unsigned entries) {
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(struct uring));
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    // IORING_OP_READ came in the same kernel as this feature.
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        goto error_exit;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes +
+                         params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        goto error_exit;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    }
+
+    else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            goto error_exit;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqes_size,
+                                              PROT_READ | PROT_WRITE, MAP_SHARED,
+                                              ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        goto error_exit;
+    }
+
+    char *sq = (char *) ring->sq_ring;
+    char *cq = (char *) ring->cq_ring;
+
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    return 0;
+
+error_exit:
+    uring_free(ring);
+
+    return -1;
+}
+
+
+/**
+ * @brief Queues a read of the next part of a file into buffer \a index. With
+ * registered buffers the read goes straight into them without the kernel
+ * mapping the pages for every read.
+ */
+static void uring_read(struct uring *ring, struct uring_file *file,
+                       char *buffer, size_t length, int index, int fixed) {
+    unsigned tail = *ring->sq_tail;
+    unsigned slot = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[slot];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = file->fd;
+    sqe->off = (uint64_t) file->offset;
+    sqe->addr = (uint64_t) (uintptr_t) buffer;
+    sqe->len = (unsigned) length;
+    sqe->buf_index = fixed ? index : 0;
+    sqe->user_data = (uint64_t) index;
+
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Adds the lines of a finished read to the batches. Only the bytes
+ * after the last newline are kept back, the rest is copied into a batch with
+ * the carry of the file in front of it.
+ */
+static int uring_consume(pl_pipeline *pipeline, struct uring_file *file,
+                         char *data, size_t length) {
+    size_t end = length == 0 ? 0 : last_line_end(data, length);
+
+    // At the end of the file the carry is the last line, without a newline.
+    if (end > 0 || length == 0) {
+        struct batch *batch = batch_new(file->carry_length + end + 1);
+        if (batch == NULL) {
+            return -1;
+        }
+
+        if (file->carry_length > 0) {
+            memcpy(batch->data, file->carry, file->carry_length);
+        }
+
+        memcpy(batch->data + file->carry_length, data, end);
+        batch->length = file->carry_length + end;
+        file->carry_length = 0;
+
+        queue_batch(pipeline, batch);
+    }
+
+    size_t rest = length - end;
+
+    if (rest == 0) {
+        return 0;
+    }
+
+    if (file->carry_length + rest > file->carry_capacity) {
+        size_t capacity = file->carry_capacity ? file->carry_capacity : 256;
+
+        while (capacity < file->carry_length + rest) {
+            capacity *= 2;
+        }
+
+        char *tmp = (char *) realloc(file->carry, capacity);
+        if (tmp == NULL) {
+            return -1;
+        }
+
+        file->carry = tmp;
+        file->carry_capacity = capacity;
+    }
+
+    memcpy(file->carry + file->carry_length, data + end, rest);
+    file->carry_length += rest;
+
+    return 0;
+}
+
+
+/**
+ * @brief Reads several files with io_uring. Every file has at most one read
+ * in flight so its lines stay in order, and up to \b PL_PIPELINE_URING_DEPTH
+ * files are read at the same time into registered buffers. Returns \b -2 if
+ * io_uring can not be used, so the caller can fall back to read(). Files the
+ * kernel refuses to read with io_uring are read with read() after the rest.
+ */
+static int read_files_uring(pl_pipeline *pipeline, int *fds, int count) {
+    int depth = count < PL_PIPELINE_URING_DEPTH ? count : PL_PIPELINE_URING_DEPTH;
+    struct uring_file *files = NULL;
+    struct iovec *buffers = NULL;
+    int *ready = NULL, *owner = NULL;
+    int ready_head = 0, ready_count = count, in_flight = 0, unsent = 0;
+    int fixed = 0, ret_val = 0;
+    struct uring ring;
+
+    if (uring_init(&ring, (unsigned) depth) == -1) {
+        return -2;
+    }
+
+    files = (struct uring_file *) calloc(count, sizeof(struct uring_file));
+    ready = (int *) malloc(count * sizeof(int));
+    owner = (int *) malloc(depth * sizeof(int));
+    buffers = (struct iovec *) calloc(depth, sizeof(struct iovec));
+
+    if (files == NULL || ready == NULL || owner == NULL || buffers == NULL) {
+        ret_val = -1;
+        goto exit;
+    }
+
+    for (int i = 0; i < depth; i++) {
+        buffers[i].iov_base = malloc(pipeline->batch_size);
+        buffers[i].iov_len = pipeline->batch_size;
+
+        if (buffers[i].iov_base == NULL) {
+            ret_val = -1;
+            goto exit;
+        }
+
+        owner[i] = -1;
+    }
+
+    // Registering can fail on the locked memory limit, plain reads still work.
+    fixed = syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS,
+                    buffers, depth) == 0;
+
+    for (int i = 0; i < count; i++) {
+        files[i].fd = fds[i];
+        files[i].offset = lseek(fds[i], 0, SEEK_CUR);
+        ready[i] = i;
+    }
+
+    pipeline->stats.io_uring = 1;
+
+    while (ready_count > 0 || in_flight > 0) {
+        int submit = 0;
+
+        for (int i = 0; i < depth && ready_count > 0 &&
+                        !__atomic_load_n(&pipeline->stopped, __ATOMIC_ACQUIRE); i++) {
+            if (owner[i] != -1) {
+                continue;
+            }
+
+            owner[i] = ready[ready_head];
+            ready_head = (ready_head + 1) % count;
+            ready_count--;
+
+            uring_read(&ring, &files[owner[i]], buffers[i].iov_base,
+                       buffers[i].iov_len, i, fixed);
+            submit++;
+        }
+
+        unsent += submit;
+
+        // A stopped pipeline only waits for the reads already in flight.
+        if (unsent == 0 && in_flight == 0) {
+            break;
+        }
+
+        long sent = syscall(__NR_io_uring_enter, ring.fd, unsent, 1,
+                            IORING_ENTER_GETEVENTS, NULL, 0);
+
+        if (sent < 0 && errno != EINTR) {
+            ret_val = -1;
+            break;
+        }
+
+        if (sent > 0) {
+            in_flight += (int) sent;
+            unsent -= (int) sent;
+        }
+
+        unsigned head = *ring.cq_head;
+
+        while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            int index = (int) cqe->user_data;
+            int res = cqe->res;
+            struct uring_file *file = &files[owner[index]];
+
+            head++;
+            __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+            in_flight--;
+
+            if (res == -EINTR || res == -EAGAIN) {
+                uring_read(&ring, file, buffers[index].iov_base,
+                           buffers[index].iov_len, index, fixed);
+                unsent++;
+                continue;
+            }
+
+            // The kernel can refuse a kind of file, read it with read() later.
+            if (!file->started && (res == -EINVAL || res == -EOPNOTSUPP)) {
+                file->fallback = 1;
+                owner[index] = -1;
+                continue;
+            }
+
+            if (res < 0 || ret_val == -1 ||
+                uring_consume(pipeline, file, buffers[index].iov_base,
+                              (size_t) res) == -1) {
+                ret_val = -1;
+                pipeline_stop(pipeline);
+            }
+
+            // Not at the end of the file, read the next part later.
+            else if (res > 0) {
+                file->started = 1;
+
+                if (file->offset != -1) {
+                    file->offset += res;
+                }
+
+                ready[(ready_head + ready_count) % count] = owner[index];
+                ready_count++;
+            }
+
+            owner[index] = -1;
+        }
+    }
+
+exit:
+    uring_free(&ring);
+
+    for (int i = 0; ret_val == 0 && i < count; i++) {
+        if (files[i].fallback && read_input(pipeline, files[i].fd) == -1) {
+            ret_val = -1;
+        }
+    }
+
+    for (int i = 0; files != NULL && i < count; i++) {
+        free(files[i].carry);
+    }
+
+    for (int i = 0; buffers != NULL && i < depth; i++) {
+        free(buffers[i].iov_base);
+    }
+
+    free(files);
+    free(ready);
+    free(owner);
+    free(buffers);
+
+    return ret_val;
+}
+
+#endif
+
+
+/**
+ * @brief Reads all the files, with io_uring when there are several of them
+ * and the kernel allows it, otherwise one after the other with read().
+ */
+static int read_files(pl_pipeline *pipeline, int *fds, int count) {
+    double start = now();
+    int ret_val = -2;
+
+#ifdef PL_HAVE_IO_URING
+    if (count > 1) {
+        ret_val = read_files_uring(pipeline, fds, count);
+    }
+#endif
+
+    for (int i = 0; ret_val == -2 && i < count; i++) {
+        if (read_input(pipeline, fds[i]) == -1) {
+            ret_val = -1;
+        }
+    }
+
+    pipeline->stats.reader_seconds = now() - start - pipeline->blocked_seconds;
+
+    return ret_val == -2 ? 0 : ret_val;
+}
+
+
+/**
+ * @brief Runs the pipeline over everything that can be read from a file
+ * descriptor, and returns when all of it has been through the sink. The
+ * calling thread reads the input, and the worker and sink threads are
+ * started and joined by this function. The counters and the stats are reset
+ * at the start of every run.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param fd The file descriptor to read the lines from.
+ *
+ * @return Returns \b 0 when all the input has been processed, or \b 1 if the
+ * sink stopped the pipeline. If the function fails \b -1 is returned.
+ */
+int pl_pipeline_run(pl_pipeline *pipeline, int fd) {
+    return pl_pipeline_run_files(pipeline, &fd, 1);
+}
+
+
+/**
+ * @brief Runs the pipeline over several files, like \ref pl_pipeline_run.
+ * On Linux the files are read with io_uring, with a read in flight for up to
+ * \b PL_PIPELINE_URING_DEPTH files at a time, so a slow file does not hold up
+ * the others. Without io_uring the files are read one after the other. The
+ * \a io_uring field of the stats tells which was used.
+ *
+ * The lines of a file stay in order, but the batches of different files are
+ * mixed, also in an ordered pipeline.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param fds The file descriptors to read the lines from.
+ *
+ * @param count The number of file descriptors.
+ *
+ * @return Returns \b 0 when all the input has been processed, or \b 1 if the
+ * sink stopped the pipeline. If the function fails \b -1 is returned.
+ */
+int pl_pipeline_run_files(pl_pipeline *pipeline, int *fds, int count) {
+    struct sink_state sink = {pipeline, 0, 0, 0.0};
+    struct worker *workers;
+    uint64_t ignored = 0;
+    int created = 0, ret_val = 0;
+
+    if (pipeline == NULL || fds == NULL || count < 1) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (fds[i] < 0) {
+            return -1;
+        }
+    }
+
+    memset(&pipeline->stats, 0, sizeof(pl_pipeline_stats));
+    for (int i = 0; i < pipeline->counter_count; i++) {
+        pipeline->counters[i] = 0;
+    }
+
+    pipeline->sequence = 0;
+    pipeline->delivered = 0;
+    pipeline->blocked_seconds = 0.0;
+    pipeline->stopped = 0;
+    pipeline->failed = 0;
+
+    workers = (struct worker *) calloc(pipeline->workers, sizeof(struct worker));
+    if (workers == NULL) {
+        return -1;
+    }
+
+    double start = now();
+
+    if (pipeline->sink != NULL &&
+        pthread_create(&sink.thread, NULL, sink_main, &sink) != 0) {
+        free(workers);
+
+        return -1;
+    }
+
+    for (; created < pipeline->workers; created++) {
+        struct worker *worker = &workers[created];
+        int stages = pipeline->stage_count + 1;
+
+        worker->pipeline = pipeline;
+        worker->scratch = (char **) calloc(stages, sizeof(char *));
+        worker->scratch_capacity = (size_t *) calloc(stages, sizeof(size_t));
+        worker->counters = (int64_t *) calloc(pipeline->counter_count + 1,
+                                              sizeof(int64_t));
+
+        if (worker->scratch == NULL || worker->scratch_capacity == NULL ||
+            worker->counters == NULL ||
+            pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            pipeline->failed = 1;
+            break;
+        }
+    }
+
+    if (!pipeline->failed && read_files(pipeline, fds, count) == -1) {
+        pipeline->failed = 1;
+    }
+
+    for (int i = 0; i < created; i++) {
+        queue_push(&pipeline->input, NULL, &ignored);
+    }
+
+    for (int i = 0; i < created; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    if (pipeline->sink != NULL) {
+        queue_push(&pipeline->output, NULL, &ignored);
+        pthread_join(sink.thread, NULL);
+    }
+
+    for (int i = 0; i < pipeline->workers; i++) {
+        struct worker *worker = &workers[i];
+
+        for (int x = 0; i < created && x < pipeline->counter_count; x++) {
+            pipeline->counters[x] += worker->counters[x];
+        }
+
+        pipeline->stats.worker_seconds += worker->seconds;
+        pipeline->stats.worker_waits += worker->waits;
+        pipeline->stats.worker_stalls += worker->stalls;
+
+        if (pipeline->sink == NULL) {
+            pipeline->stats.items += worker->items;
+        }
+
+        for (int x = 0; worker->scratch != NULL && x <= pipeline->stage_count; x++) {
+            free(worker->scratch[x]);
+        }
+
+        free(worker->scratch);
+        free(worker->scratch_capacity);
+        free(worker->counters);
+    }
+
+    free(workers);
+
+    pipeline->stats.sink_seconds = sink.seconds;
+    pipeline->stats.sink_waits = sink.waits;
+    pipeline->stats.elapsed_seconds = now() - start;
+
+    if (pipeline->failed) {
+        ret_val = -1;
+    }
+
+    else if (pipeline->stopped) {
+        ret_val = 1;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Returns the value of a counter after a run.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param counter The id returned by \ref pl_pipeline_count.
+ *
+ * @return Returns the number of times the word was found in the last run. If
+ * the function fails \b -1 is returned.
+ */
+int64_t pl_pipeline_counter(pl_pipeline *pipeline, int counter) {
+    if (pipeline == NULL || counter < 0 || counter >= pipeline->counter_count) {
+        return -1;
+    }
+
+    return pipeline->counters[counter];
+}
+
+
+/**
+ * @brief Gets the metrics of the last run. The bytes divided by the seconds
+ * of a stage is the throughput of that stage, and the stage with the most
+ * stalls in front of it is the one that limits the pipeline.
+ *
+ * @param pipeline The pipeline.
+ *
+ * @param stats Set to the metrics.
+ *
+ * @return Returns \b 0 if the stats were set. If the function fails \b -1 is
+ * returned.
+ */
+int pl_pipeline_get_stats(pl_pipeline *pipeline, pl_pipeline_stats *stats) {
+    if (pipeline == NULL || stats == NULL) {
+        return -1;
+    }
+
+    *stats = pipeline->stats;
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2014> <Sindre Smistad>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PL_PIPELINE_H
+#define PL_PIPELINE_H
+
+#include "plstr.h"
+#include <stdint.h>
+
+
+/*****************************************************************
+ *                  TYPES AND CONSTANTS                          *
+ *****************************************************************/
+
+
+#define PL_PIPELINE_UNORDERED   0
+#define PL_PIPELINE_ORDERED     1
+
+#define PL_PIPELINE_BATCH       (64 * 1024)
+#define PL_PIPELINE_URING_DEPTH 32
+
+typedef struct pl_pipeline pl_pipeline;
+
+/*
+ * Called for the items that come out of one batch. With an ordered pipeline
+ * the batches arrive in input order. The items are only valid during the call.
+ */
+typedef int (*pl_pipeline_sink_fn)(pl_span *, size_t, void *);
+
+/*
+ * Called for every item by a filter stage, the item is kept if it returns
+ * non zero. It is called from the worker threads.
+ */
+typedef int (*pl_pipeline_filter_fn)(pl_span, void *);
+
+/*
+ * What happened in a run. The seconds are the time every stage spent working,
+ * for the workers summed over all of them, and the stalls count how often a
+ * stage had to wait for the next one (back pressure), or for work. io_uring
+ * is non zero if the files were read with io_uring.
+ */
+typedef struct pl_pipeline_stats {
+    uint64_t batches;
+    uint64_t lines;
+    uint64_t bytes;
+    uint64_t items;
+    double elapsed_seconds;
+    double reader_seconds;
+    double worker_seconds;
+    double sink_seconds;
+    uint64_t reader_stalls;
+    uint64_t worker_waits;
+    uint64_t worker_stalls;
+    uint64_t sink_waits;
+    int io_uring;
+} pl_pipeline_stats;
+
+
+/*****************************************************************
+ *                  FUNCTION DEFINITIONS                         *
+ *****************************************************************/
+
+
+pl_pipeline *pl_pipeline_new(int, size_t, int);
+void    pl_pipeline_free(pl_pipeline *);
+int     pl_pipeline_strip(pl_pipeline *, char *);
+int     pl_pipeline_lower(pl_pipeline *);
+int     pl_pipeline_translate(pl_pipeline *, unsigned char *, char *);
+int     pl_pipeline_split(pl_pipeline *, char *);
+int     pl_pipeline_filter(pl_pipeline *, pl_pipeline_filter_fn, void *);
+int     pl_pipeline_count(pl_pipeline *, char *);
+int     pl_pipeline_sink(pl_pipeline *, pl_pipeline_sink_fn, void *);
+int     pl_pipeline_run(pl_pipeline *, int);
+int     pl_pipeline_run_files(pl_pipeline *, int *, int);
+int64_t pl_pipeline_counter(pl_pipeline *, int);
+int     pl_pipeline_get_stats(pl_pipeline *, pl_pipeline_stats *);
+
+#endif /* PL_PIPELINE_H */
@@ -49,131 +49,8188 @@
  * functions.
  */
 
+#include "plstr.h"
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <locale.h>
+#include <math.h>
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PL_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define PL_THREAD_LOCAL __thread
+#else
+#define PL_THREAD_LOCAL
+#endif
+
+
+/**
+ * @brief Portable substring search on a buffer with a known length. The first
+ * byte of the needle is located with memchr, and the last byte is checked
+ * before the rest of the needle is compared.
+ */
+static char *find_scalar(char *haystack, size_t length, char *needle,
+                         size_t needle_length) {
+    if (needle_length == 0) {
+        return haystack;
+    }
+
+    if (needle_length > length) {
+        return NULL;
+    }
+
+    char *pch = haystack;
+    char *end = haystack + length - needle_length + 1;
+    char last = needle[needle_length - 1];
+
+    while (pch < end) {
+        pch = memchr(pch, needle[0], end - pch);
+        if (pch == NULL) {
+            return NULL;
+        }
+
+        if (pch[needle_length - 1] == last &&
+            !memcmp(pch + 1, needle + 1, needle_length - 1)) {
+            return pch;
+        }
+
+        pch++;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Portable reverse substring search, returns the last occurence of the
+ * needle in the buffer.
+ */
+static char *rfind_scalar(char *haystack, size_t length, char *needle,
+                          size_t needle_length) {
+    if (needle_length == 0) {
+        return haystack + length;
+    }
+
+    if (needle_length > length) {
+        return NULL;
+    }
+
+    char first = needle[0], last = needle[needle_length - 1];
+
+    for (size_t i = length - needle_length + 1; i-- > 0;) {
+        if (haystack[i] == first && haystack[i + needle_length - 1] == last &&
+            !memcmp(haystack + i, needle, needle_length)) {
+            return haystack + i;
+        }
+    }
+
+    return NULL;
+}
+
+
+#ifdef PL_X86
+/*
+ * The vector kernels compare the first and the last byte of the needle
+ * against a whole block of candidate positions at once, and only verify the
+ * positions where both bytes match. The positions at the end of the buffer
+ * that do not fill a block are left to the scalar kernels.
+ */
+__attribute__((target("sse2")))
+static char *find_sse2(char *haystack, size_t length, char *needle,
+                       size_t needle_length) {
+    if (needle_length < 2 || needle_length > length) {
+        return find_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    size_t i = 0;
+
+    for (; i + needle_length - 1 + 16 <= length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((__m128i *) (haystack + i));
+        __m128i block_last = _mm_loadu_si128((__m128i *) (haystack + i + needle_length - 1));
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(first, block_first),
+                    _mm_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+
+            if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return find_scalar(haystack + i, length - i, needle, needle_length);
+}
+
+
+/**
+ * @brief Reverse search for a single byte, like memrchr. Blocks are read from
+ * the end of the buffer, so only the suffix after the match is scanned.
+ */
+__attribute__((target("sse2")))
+static char *rchr_sse2(char *haystack, size_t length, char c) {
+    __m128i target = _mm_set1_epi8(c);
+
+    for (; length >= 16; length -= 16) {
+        __m128i block = _mm_loadu_si128((__m128i *) (haystack + length - 16));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(target, block));
+
+        if (mask != 0) {
+            return haystack + length - 16 + 31 - __builtin_clz(mask);
+        }
+    }
+
+    return rfind_scalar(haystack, length, &c, 1);
+}
+
+
+__attribute__((target("sse2")))
+static char *rfind_sse2(char *haystack, size_t length, char *needle,
+                        size_t needle_length) {
+    if (needle_length == 1) {
+        return rchr_sse2(haystack, length, needle[0]);
+    }
+
+    if (needle_length < 2 || needle_length > length) {
+        return rfind_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    size_t end = length - needle_length + 1;
+
+    // end is one past the last candidate position not yet checked.
+    for (; end >= 16; end -= 16) {
+        size_t i = end - 16;
+        __m128i block_first = _mm_loadu_si128((__m128i *) (haystack + i));
+        __m128i block_last = _mm_loadu_si128((__m128i *) (haystack + i + needle_length - 1));
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(first, block_first),
+                    _mm_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            int bit = 31 - __builtin_clz(mask);
+
+            if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return rfind_scalar(haystack, end + needle_length - 1, needle, needle_length);
+}
+
+
+__attribute__((target("avx2")))
+static char *find_avx2(char *haystack, size_t length, char *needle,
+                       size_t needle_length) {
+    if (needle_length < 2 || needle_length > length) {
+        return find_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    size_t i = 0;
+
+    for (; i + needle_length - 1 + 32 <= length; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((__m256i *) (haystack + i));
+        __m256i block_last = _mm256_loadu_si256((__m256i *) (haystack + i + needle_length - 1));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(first, block_first),
+                    _mm256_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+
+            if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return find_sse2(haystack + i, length - i, needle, needle_length);
+}
+
+
+__attribute__((target("avx2")))
+static char *rchr_avx2(char *haystack, size_t length, char c) {
+    __m256i target = _mm256_set1_epi8(c);
+
+    for (; length >= 32; length -= 32) {
+        __m256i block = _mm256_loadu_si256((__m256i *) (haystack + length - 32));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(target, block));
+
+        if (mask != 0) {
+            return haystack + length - 32 + 31 - __builtin_clz(mask);
+        }
+    }
+
+    return rchr_sse2(haystack, length, c);
+}
+
+
+__attribute__((target("avx2")))
+static char *rfind_avx2(char *haystack, size_t length, char *needle,
+                        size_t needle_length) {
+    if (needle_length == 1) {
+        return rchr_avx2(haystack, length, needle[0]);
+    }
+
+    if (needle_length < 2 || needle_length > length) {
+        return rfind_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    size_t end = length - needle_length + 1;
+
+    for (; end >= 32; end -= 32) {
+        size_t i = end - 32;
+        __m256i block_first = _mm256_loadu_si256((__m256i *) (haystack + i));
+        __m256i block_last = _mm256_loadu_si256((__m256i *) (haystack + i + needle_length - 1));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(first, block_first),
+                    _mm256_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            int bit = 31 - __builtin_clz(mask);
+
+            if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return rfind_sse2(haystack, end + needle_length - 1, needle, needle_length);
+}
+#endif
+
+
+/**
+ * @brief Returns the number of bytes at the start of the buffer that are
+ * plain ASCII.
+ */
+static size_t ascii_prefix_scalar(char *string, size_t length) {
+    size_t i = 0;
+
+    while (i < length && (unsigned char) string[i] < 0x80) {
+        i++;
+    }
+
+    return i;
+}
+
+
+/**
+ * @brief Counts the code points in a buffer of UTF-8, which is the number of
+ * bytes that are not continuation bytes.
+ */
+static size_t utf8_count_scalar(char *string, size_t length) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        count += ((unsigned char) string[i] & 0xC0) != 0x80;
+    }
+
+    return count;
+}
+
+
+#ifdef PL_X86
+__attribute__((target("sse2")))
+static size_t ascii_prefix_sse2(char *string, size_t length) {
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        unsigned int mask = _mm_movemask_epi8(_mm_loadu_si128((__m128i *) (string + i)));
+
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return i + ascii_prefix_scalar(string + i, length - i);
+}
+
+
+/*
+ * Continuation bytes are 0x80 to 0xBF, which are the only bytes below -64
+ * when they are compared as signed values.
+ */
+__attribute__((target("sse2")))
+static size_t utf8_count_sse2(char *string, size_t length) {
+    __m128i limit = _mm_set1_epi8(-64);
+    size_t i = 0, continuations = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((__m128i *) (string + i));
+
+        continuations += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(limit, block)));
+    }
+
+    return i - continuations + utf8_count_scalar(string + i, length - i);
+}
+
+
+__attribute__((target("avx2")))
+static size_t ascii_prefix_avx2(char *string, size_t length) {
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        unsigned int mask = _mm256_movemask_epi8(_mm256_loadu_si256((__m256i *) (string + i)));
+
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return i + ascii_prefix_sse2(string + i, length - i);
+}
+
+
+__attribute__((target("avx2,popcnt")))
+static size_t utf8_count_avx2(char *string, size_t length) {
+    __m256i limit = _mm256_set1_epi8(-64);
+    size_t i = 0, continuations = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((__m256i *) (string + i));
+
+        continuations += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(limit, block)));
+    }
+
+    return i - continuations + utf8_count_sse2(string + i, length - i);
+}
+#endif
+
+
+/**
+ * @brief Lower cases a single ASCII character, other bytes are unchanged.
+ */
+static unsigned char fold_ascii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+}
+
+
+/**
+ * @brief Compares two buffers ignoring ASCII case, returns \b 1 if equal.
+ */
+static int equal_ci(char *a, char *b, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (fold_ascii(a[i]) != fold_ascii(b[i])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*
+ * The case kernels flip bit 0x20 of every byte that is inside one of two
+ * ranges, A-Z for lower, a-z for upper and both for swapcase. An empty range
+ * is given as lo > hi.
+ */
+static void case_scalar(char *destination, char *source, size_t length,
+                        char lo1, char hi1, char lo2, char hi2) {
+    for (size_t i = 0; i < length; i++) {
+        char c = source[i];
+
+        if ((c >= lo1 && c <= hi1) || (c >= lo2 && c <= hi2)) {
+            c ^= 0x20;
+        }
+
+        destination[i] = c;
+    }
+}
+
+
+/**
+ * @brief Portable case insensitive substring search, the needle and the
+ * haystack are folded as they are compared.
+ */
+static char *find_ci_scalar(char *haystack, size_t length, char *needle,
+                            size_t needle_length) {
+    if (needle_length == 0) {
+        return haystack;
+    }
+
+    if (needle_length > length) {
+        return NULL;
+    }
+
+    unsigned char first = fold_ascii(needle[0]);
+    unsigned char last = fold_ascii(needle[needle_length - 1]);
+
+    for (size_t i = 0; i + needle_length <= length; i++) {
+        if (fold_ascii(haystack[i]) == first &&
+            fold_ascii(haystack[i + needle_length - 1]) == last &&
+            equal_ci(haystack + i + 1, needle + 1, needle_length - 1)) {
+            return haystack + i;
+        }
+    }
+
+    return NULL;
+}
+
+
+#ifdef PL_X86
+/*
+ * Signed compares are used for the ranges, bytes above 0x7F are negative and
+ * are never inside an ASCII letter range.
+ */
+__attribute__((target("sse2")))
+static __m128i case_block_sse2(__m128i v, char lo1, char hi1, char lo2,
+                               char hi2) {
+    __m128i in1 = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo1 - 1)),
+                                _mm_cmpgt_epi8(_mm_set1_epi8(hi1 + 1), v));
+    __m128i in2 = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo2 - 1)),
+                                _mm_cmpgt_epi8(_mm_set1_epi8(hi2 + 1), v));
+    __m128i flip = _mm_and_si128(_mm_or_si128(in1, in2), _mm_set1_epi8(0x20));
+
+    return _mm_xor_si128(v, flip);
+}
+
+
+__attribute__((target("sse2")))
+static void case_sse2(char *destination, char *source, size_t length,
+                      char lo1, char hi1, char lo2, char hi2) {
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) (source + i));
+
+        _mm_storeu_si128((__m128i *) (destination + i),
+                         case_block_sse2(v, lo1, hi1, lo2, hi2));
+    }
+
+    case_scalar(destination + i, source + i, length - i, lo1, hi1, lo2, hi2);
+}
+
+
+__attribute__((target("sse2")))
+static char *find_ci_sse2(char *haystack, size_t length, char *needle,
+                          size_t needle_length) {
+    if (needle_length < 2 || needle_length > length) {
+        return find_ci_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m128i first = _mm_set1_epi8(fold_ascii(needle[0]));
+    __m128i last = _mm_set1_epi8(fold_ascii(needle[needle_length - 1]));
+    size_t i = 0;
+
+    for (; i + needle_length - 1 + 16 <= length; i += 16) {
+        __m128i block_first = case_block_sse2(
+                _mm_loadu_si128((__m128i *) (haystack + i)), 'A', 'Z', 1, 0);
+        __m128i block_last = case_block_sse2(
+                _mm_loadu_si128((__m128i *) (haystack + i + needle_length - 1)),
+                'A', 'Z', 1, 0);
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(first, block_first),
+                    _mm_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+
+            if (equal_ci(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return find_ci_scalar(haystack + i, length - i, needle, needle_length);
+}
+
+
+__attribute__((target("avx2")))
+static __m256i case_block_avx2(__m256i v, char lo1, char hi1, char lo2,
+                               char hi2) {
+    __m256i in1 = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo1 - 1)),
+                                   _mm256_cmpgt_epi8(_mm256_set1_epi8(hi1 + 1), v));
+    __m256i in2 = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo2 - 1)),
+                                   _mm256_cmpgt_epi8(_mm256_set1_epi8(hi2 + 1), v));
+    __m256i flip = _mm256_and_si256(_mm256_or_si256(in1, in2), _mm256_set1_epi8(0x20));
+
+    return _mm256_xor_si256(v, flip);
+}
+
+
+__attribute__((target("avx2")))
+static void case_avx2(char *destination, char *source, size_t length,
+                      char lo1, char hi1, char lo2, char hi2) {
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i *) (source + i));
+
+        _mm256_storeu_si256((__m256i *) (destination + i),
+                            case_block_avx2(v, lo1, hi1, lo2, hi2));
+    }
+
+    case_sse2(destination + i, source + i, length - i, lo1, hi1, lo2, hi2);
+}
+
+
+__attribute__((target("avx2")))
+static char *find_ci_avx2(char *haystack, size_t length, char *needle,
+                          size_t needle_length) {
+    if (needle_length < 2 || needle_length > length) {
+        return find_ci_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m256i first = _mm256_set1_epi8(fold_ascii(needle[0]));
+    __m256i last = _mm256_set1_epi8(fold_ascii(needle[needle_length - 1]));
+    size_t i = 0;
+
+    for (; i + needle_length - 1 + 32 <= length; i += 32) {
+        __m256i block_first = case_block_avx2(
+                _mm256_loadu_si256((__m256i *) (haystack + i)), 'A', 'Z', 1, 0);
+        __m256i block_last = case_block_avx2(
+                _mm256_loadu_si256((__m256i *) (haystack + i + needle_length - 1)),
+                'A', 'Z', 1, 0);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(first, block_first),
+                    _mm256_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+
+            if (equal_ci(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return find_ci_sse2(haystack + i, length - i, needle, needle_length);
+}
+#endif
+
+
+/**
+ * @brief Returns a mask with bit i set if byte i of the 64 byte block is
+ * whitespace, using the same whitespace as \ref pl_strip.
+ */
+static unsigned long long ws_mask_scalar(char *block) {
+    unsigned long long mask = 0;
+
+    for (int i = 0; i < 64; i++) {
+        unsigned char c = block[i];
+
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            mask |= 1ULL << i;
+        }
+    }
+
+    return mask;
+}
+
+
+#ifdef PL_X86
+/*
+ * Whitespace is a space, or a byte from \t to \r. The range is checked with
+ * two signed compares, bytes above 127 are negative and never match.
+ */
+__attribute__((target("sse2")))
+static unsigned long long ws_mask_sse2(char *block) {
+    __m128i space = _mm_set1_epi8(' ');
+    __m128i low = _mm_set1_epi8('\t' - 1), high = _mm_set1_epi8('\r' + 1);
+    unsigned long long mask = 0;
+
+    for (int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) (block + i));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                  _mm_and_si128(_mm_cmpgt_epi8(v, low),
+                                                _mm_cmpgt_epi8(high, v)));
+
+        mask |= (unsigned long long) _mm_movemask_epi8(ws) << i;
+    }
+
+    return mask;
+}
+
+
+__attribute__((target("avx2")))
+static unsigned long long ws_mask_avx2(char *block) {
+    __m256i space = _mm256_set1_epi8(' ');
+    __m256i low = _mm256_set1_epi8('\t' - 1), high = _mm256_set1_epi8('\r' + 1);
+    unsigned long long mask = 0;
+
+    for (int i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i *) (block + i));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                     _mm256_and_si256(_mm256_cmpgt_epi8(v, low),
+                                                      _mm256_cmpgt_epi8(high, v)));
+
+        mask |= (unsigned long long) (unsigned int) _mm256_movemask_epi8(ws) << i;
+    }
+
+    return mask;
+}
+#endif
+
+
+/**
+ * @brief Classifies a 64 byte block for the CSV reader. Bit i of masks[0] is
+ * set if byte i is the quote character, of masks[1] if it is the delimiter
+ * and of masks[2] if it is a newline.
+ */
+static void csv_mask_scalar(char *block, char delim, char quote,
+                            unsigned long long *masks) {
+    masks[0] = masks[1] = masks[2] = 0;
+
+    for (int i = 0; i < 64; i++) {
+        masks[0] |= (unsigned long long) (block[i] == quote) << i;
+        masks[1] |= (unsigned long long) (block[i] == delim) << i;
+        masks[2] |= (unsigned long long) (block[i] == '\n') << i;
+    }
+}
+
+
+/**
+ * @brief Returns a mask where bit i is the xor of bits 0 to i of the input.
+ * With the quote bits as input the result has the bits inside quotes set,
+ * counting the opening quote but not the closing one.
+ */
+static unsigned long long prefix_xor_scalar(unsigned long long bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+
+    return bits;
+}
+
+
+#ifdef PL_X86
+__attribute__((target("sse2")))
+static void csv_mask_sse2(char *block, char delim, char quote,
+                          unsigned long long *masks) {
+    __m128i q = _mm_set1_epi8(quote), d = _mm_set1_epi8(delim);
+    __m128i n = _mm_set1_epi8('\n');
+
+    masks[0] = masks[1] = masks[2] = 0;
+
+    for (int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) (block + i));
+
+        masks[0] |= (unsigned long long) _mm_movemask_epi8(_mm_cmpeq_epi8(v, q)) << i;
+        masks[1] |= (unsigned long long) _mm_movemask_epi8(_mm_cmpeq_epi8(v, d)) << i;
+        masks[2] |= (unsigned long long) _mm_movemask_epi8(_mm_cmpeq_epi8(v, n)) << i;
+    }
+}
+
+
+__attribute__((target("avx2")))
+static void csv_mask_avx2(char *block, char delim, char quote,
+                          unsigned long long *masks) {
+    __m256i q = _mm256_set1_epi8(quote), d = _mm256_set1_epi8(delim);
+    __m256i n = _mm256_set1_epi8('\n');
+
+    masks[0] = masks[1] = masks[2] = 0;
+
+    for (int i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i *) (block + i));
+
+        masks[0] |= (unsigned long long) (unsigned int) _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(v, q)) << i;
+        masks[1] |= (unsigned long long) (unsigned int) _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(v, d)) << i;
+        masks[2] |= (unsigned long long) (unsigned int) _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(v, n)) << i;
+    }
+}
+
+
+/*
+ * A carry-less multiply by all ones is the same prefix xor in a single
+ * instruction.
+ */
+__attribute__((target("pclmul,sse2")))
+static unsigned long long prefix_xor_clmul(unsigned long long bits) {
+    __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, bits),
+                                           _mm_set1_epi8(-1), 0);
+
+    return _mm_cvtsi128_si64(product);
+}
+#endif
+
+
+/**
+ * @brief Maps every byte of \a source through the 256 byte translate map
+ * into \a destination.
+ */
+static void translate_scalar(char *destination, char *source, size_t length,
+                             unsigned char *map) {
+    for (size_t i = 0; i < length; i++) {
+        destination[i] = map[(unsigned char) source[i]];
+    }
+}
+
+
+/*
+ * Most translate maps only change a few bytes, and those are swapped with a
+ * compare and a blend each. When a map changes many bytes, every 16 byte row
+ * of the map that changes something is looked up with a shuffle on the low
+ * nibble, and blended in where the high nibble selects that row. With AVX2
+ * that only beats the scalar loop up to about half of the rows.
+ */
+#define TRANSLATE_SPARSE    8
+#define TRANSLATE_ROWS      8
+
+struct translate_plan {
+    int pairs;
+    unsigned char from[256];
+    unsigned char to[256];
+    int rows;
+    unsigned char row[16];
+};
+
+
+/**
+ * @brief Lists the bytes a translate map changes, and the rows they are in.
+ */
+static void plan_translate(unsigned char *map, struct translate_plan *plan) {
+    plan->pairs = 0;
+    plan->rows = 0;
+
+    for (int r = 0; r < 16; r++) {
+        int changed = plan->pairs;
+
+        for (int i = r * 16; i < r * 16 + 16; i++) {
+            if (map[i] != i) {
+                plan->from[plan->pairs] = i;
+                plan->to[plan->pairs] = map[i];
+                plan->pairs++;
+            }
+        }
+
+        if (plan->pairs != changed) {
+            plan->row[plan->rows++] = r;
+        }
+    }
+}
+
+
+#ifdef PL_X86
+/*
+ * SSE2 has no byte shuffle, so a map that changes many bytes is left to the
+ * scalar loop.
+ */
+__attribute__((target("sse2")))
+static void translate_sse2(char *destination, char *source, size_t length,
+                           unsigned char *map) {
+    struct translate_plan plan;
+    size_t i = 0;
+
+    plan_translate(map, &plan);
+
+    for (; plan.pairs <= TRANSLATE_SPARSE && i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) (source + i));
+        __m128i out = v;
+
+        for (int p = 0; p < plan.pairs; p++) {
+            __m128i hit = _mm_cmpeq_epi8(v, _mm_set1_epi8(plan.from[p]));
+
+            out = _mm_or_si128(_mm_andnot_si128(hit, out),
+                               _mm_and_si128(hit, _mm_set1_epi8(plan.to[p])));
+        }
+
+        _mm_storeu_si128((__m128i *) (destination + i), out);
+    }
+
+    translate_scalar(destination + i, source + i, length - i, map);
+}
+
+
+__attribute__((target("avx2")))
+static void translate_avx2(char *destination, char *source, size_t length,
+                           unsigned char *map) {
+    __m256i nibble = _mm256_set1_epi8(0x0f), rows[16];
+    struct translate_plan plan;
+    size_t i = 0;
+
+    plan_translate(map, &plan);
+
+    if (plan.pairs <= TRANSLATE_SPARSE || plan.pairs <= 2 * plan.rows) {
+        for (; i + 32 <= length; i += 32) {
+            __m256i v = _mm256_loadu_si256((__m256i *) (source + i));
+            __m256i out = v;
+
+            for (int p = 0; p < plan.pairs; p++) {
+                out = _mm256_blendv_epi8(out, _mm256_set1_epi8(plan.to[p]),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(plan.from[p])));
+            }
+
+            _mm256_storeu_si256((__m256i *) (destination + i), out);
+        }
+    }
+
+    else if (plan.rows <= TRANSLATE_ROWS) {
+        for (int r = 0; r < plan.rows; r++) {
+            rows[r] = _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((__m128i *) (map + plan.row[r] * 16)));
+        }
+
+        for (; i + 32 <= length; i += 32) {
+            __m256i v = _mm256_loadu_si256((__m256i *) (source + i));
+            __m256i low = _mm256_and_si256(v, nibble);
+            __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+            __m256i out = v;
+
+            for (int r = 0; r < plan.rows; r++) {
+                out = _mm256_blendv_epi8(out, _mm256_shuffle_epi8(rows[r], low),
+                        _mm256_cmpeq_epi8(high, _mm256_set1_epi8(plan.row[r])));
+            }
+
+            _mm256_storeu_si256((__m256i *) (destination + i), out);
+        }
+    }
+
+    translate_scalar(destination + i, source + i, length - i, map);
+}
+#endif
+
+
+/**
+ * @brief Copies the bytes of \a source that are not flagged in the delete
+ * map to \a destination, and returns how many were copied.
+ */
+static size_t delete_scalar(char *destination, char *source, size_t length,
+                            unsigned char *map) {
+    size_t out = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        destination[out] = source[i];
+        out += !map[(unsigned char) source[i]];
+    }
+
+    return out;
+}
+
+
+/*
+ * A small delete set is classified with one compare per character. A larger
+ * one is looked up in a bitmap: a shuffle on the low nibble picks the byte
+ * that holds the bits of that column, for the high nibbles 0-7 or 8-15, and
+ * a second shuffle on the high nibble picks the bit in it.
+ */
+#define DELETE_SPARSE   4
+#define SSE2_SPARSE     8
+
+struct delete_plan {
+    int count;
+    unsigned char chars[SSE2_SPARSE];
+    unsigned char low[16];
+    unsigned char high[16];
+};
+
+
+static void plan_delete(unsigned char *map, struct delete_plan *plan) {
+    uint64_t word;
+
+    memset(plan, 0, sizeof(struct delete_plan));
+
+    for (int c = 0; c < 256; c++) {
+        // Skip 8 bytes at a time, most of the map is zero.
+        if ((c & 7) == 0) {
+            memcpy(&word, map + c, sizeof(word));
+
+            if (word == 0) {
+                c += 7;
+                continue;
+            }
+        }
+
+        if (!map[c]) {
+            continue;
+        }
+
+        if (plan->count < SSE2_SPARSE) {
+            plan->chars[plan->count] = c;
+        }
+
+        plan->count++;
+
+        if (c < 128) {
+            plan->low[c & 15] |= 1 << (c >> 4);
+        }
+
+        else {
+            plan->high[c & 15] |= 1 << ((c >> 4) - 8);
+        }
+    }
+}
+
+
+#ifdef PL_X86
+/*
+ * The survivors of 8 bytes are packed to the front with a shuffle, and
+ * pack_table holds the shuffle for every mask of kept bytes.
+ */
+static unsigned char pack_table[256][8];
+
+
+static void init_pack_table(void) {
+    for (int mask = 0; mask < 256; mask++) {
+        int out = 0;
+
+        for (int i = 0; i < 8; i++) {
+            if (mask & (1 << i)) {
+                pack_table[mask][out++] = i;
+            }
+        }
+
+        while (out < 8) {
+            pack_table[mask][out++] = 0x80;
+        }
+    }
+}
+
+
+/*
+ * SSE2 can not shuffle, so it only finds the blocks where nothing is deleted
+ * and copies them whole.
+ */
+__attribute__((target("sse2")))
+static size_t delete_sse2(char *destination, char *source, size_t length,
+                          unsigned char *map) {
+    struct delete_plan plan;
+    __m128i chars[SSE2_SPARSE];
+    size_t i = 0, out = 0;
+
+    plan_delete(map, &plan);
+
+    for (int c = 0; c < plan.count && c < SSE2_SPARSE; c++) {
+        chars[c] = _mm_set1_epi8(plan.chars[c]);
+    }
+
+    for (; plan.count <= SSE2_SPARSE && i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) (source + i));
+        __m128i hit = _mm_setzero_si128();
+
+        for (int c = 0; c < plan.count; c++) {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, chars[c]));
+        }
+
+        if (_mm_movemask_epi8(hit) == 0) {
+            _mm_storeu_si128((__m128i *) (destination + out), v);
+            out += 16;
+        }
+
+        else {
+            out += delete_scalar(destination + out, source + i, 16, map);
+        }
+    }
+
+    return out + delete_scalar(destination + out, source + i, length - i, map);
+}
+
+
+__attribute__((target("avx2")))
+static unsigned int delete_mask_avx2(__m256i v, struct delete_plan *plan) {
+    __m256i hit = _mm256_setzero_si256();
+
+    if (plan->count <= DELETE_SPARSE) {
+        for (int c = 0; c < plan->count; c++) {
+            hit = _mm256_or_si256(hit,
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(plan->chars[c])));
+        }
+    }
+
+    else {
+        __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *) plan->low));
+        __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *) plan->high));
+        __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                        1, 2, 4, 8, 16, 32, 64, -128,
+                                        1, 2, 4, 8, 16, 32, 64, -128,
+                                        1, 2, 4, 8, 16, 32, 64, -128);
+        __m256i column = _mm256_and_si256(v, nibble);
+        __m256i row = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i set = _mm256_blendv_epi8(_mm256_shuffle_epi8(low, column),
+                                         _mm256_shuffle_epi8(high, column), v);
+        __m256i bit = _mm256_shuffle_epi8(bits, row);
+
+        hit = _mm256_cmpeq_epi8(_mm256_and_si256(set, bit), bit);
+    }
+
+    return (unsigned int) _mm256_movemask_epi8(hit);
+}
+
+
+__attribute__((target("avx2,popcnt")))
+static size_t delete_avx2(char *destination, char *source, size_t length,
+                          unsigned char *map) {
+    struct delete_plan plan;
+    size_t i = 0, out = 0;
+
+    plan_delete(map, &plan);
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i *) (source + i));
+        unsigned int keep = ~delete_mask_avx2(v, &plan);
+
+        if (keep == 0xffffffff) {
+            _mm256_storeu_si256((__m256i *) (destination + out), v);
+            out += 32;
+            continue;
+        }
+
+        // Every 8 byte store stays inside the 32 bytes that were read.
+        for (int g = 0; g < 32; g += 8) {
+            unsigned int bits = (keep >> g) & 0xff;
+            __m128i part = _mm_loadl_epi64((__m128i *) (source + i + g));
+
+            part = _mm_shuffle_epi8(part, _mm_loadl_epi64((__m128i *) pack_table[bits]));
+            _mm_storel_epi64((__m128i *) (destination + out), part);
+            out += __builtin_popcount(bits);
+        }
+    }
+
+    return out + delete_scalar(destination + out, source + i, length - i, map);
+}
+#endif
+
+
+/**
+ * @brief Returns the length of the run of bytes flagged in \a map at the
+ * start of the string, or at the end of it if \a from_end is set.
+ */
+static size_t strip_run_scalar(char *string, size_t length, unsigned char *map,
+                               int from_end) {
+    size_t run = 0;
+
+    if (from_end) {
+        while (run < length && map[(unsigned char) string[length - run - 1]]) {
+            run++;
+        }
+    }
+
+    else {
+        while (run < length && map[(unsigned char) string[run]]) {
+            run++;
+        }
+    }
+
+    return run;
+}
+
+
+#ifdef PL_X86
+/*
+ * The strip kernels classify a block with the same delete set compares as
+ * translate. The first kept byte of a block is the lowest clear bit of the
+ * mask when scanning forwards, and the highest clear bit when scanning
+ * backwards.
+ */
+__attribute__((target("sse2")))
+static size_t strip_run_sse2(char *string, size_t length, unsigned char *map,
+                             int from_end) {
+    struct delete_plan plan;
+    __m128i chars[SSE2_SPARSE];
+    size_t run = 0;
+
+    plan_delete(map, &plan);
+
+    for (int c = 0; c < plan.count && c < SSE2_SPARSE; c++) {
+        chars[c] = _mm_set1_epi8(plan.chars[c]);
+    }
+
+    for (; plan.count <= SSE2_SPARSE && run + 16 <= length; run += 16) {
+        char *block = from_end ? string + length - run - 16 : string + run;
+        __m128i v = _mm_loadu_si128((__m128i *) block);
+        __m128i hit = _mm_setzero_si128();
+
+        for (int c = 0; c < plan.count; c++) {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, chars[c]));
+        }
+
+        unsigned int kept = ~_mm_movemask_epi8(hit) & 0xffff;
+
+        if (kept != 0) {
+            return run + (from_end ? __builtin_clz(kept) - 16 : __builtin_ctz(kept));
+        }
+    }
+
+    if (from_end) {
+        return run + strip_run_scalar(string, length - run, map, 1);
+    }
+
+    return run + strip_run_scalar(string + run, length - run, map, 0);
+}
+
+
+__attribute__((target("avx2")))
+static size_t strip_run_avx2(char *string, size_t length, unsigned char *map,
+                             int from_end) {
+    struct delete_plan plan;
+    size_t run = 0;
+
+    plan_delete(map, &plan);
+
+    for (; run + 32 <= length; run += 32) {
+        char *block = from_end ? string + length - run - 32 : string + run;
+        unsigned int kept = ~delete_mask_avx2(
+                _mm256_loadu_si256((__m256i *) block), &plan);
+
+        if (kept != 0) {
+            return run + (from_end ? __builtin_clz(kept) : __builtin_ctz(kept));
+        }
+    }
+
+    if (from_end) {
+        return run + strip_run_scalar(string, length - run, map, 1);
+    }
+
+    return run + strip_run_scalar(string + run, length - run, map, 0);
+}
+#endif
+
+
+/**
+ * @brief Copies \a count bytes that are \a step bytes apart, starting at
+ * \a first, to \a destination. The step can be negative.
+ */
+static void gather_scalar(char *destination, char *first, size_t count,
+                          ptrdiff_t step) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        destination[i] = first[(ptrdiff_t) i * step];
+        destination[i + 1] = first[(ptrdiff_t) (i + 1) * step];
+        destination[i + 2] = first[(ptrdiff_t) (i + 2) * step];
+        destination[i + 3] = first[(ptrdiff_t) (i + 3) * step];
+    }
+
+    for (; i < count; i++) {
+        destination[i] = first[(ptrdiff_t) i * step];
+    }
+}
+
+
+#ifdef PL_X86
+/*
+ * The vector gathers handle the two common steps. A step of -1 reverses
+ * whole blocks, and a step of 2 keeps the low byte of every 16 bit word.
+ * Reading 2 bytes per output byte can go one byte past the last one that
+ * is used, so the step 2 loops stop a block early.
+ */
+__attribute__((target("sse2")))
+static void gather_sse2(char *destination, char *first, size_t count,
+                        ptrdiff_t step) {
+    size_t i = 0;
+
+    if (step == -1) {
+        for (; i + 16 <= count; i += 16) {
+            __m128i v = _mm_loadu_si128((__m128i *) (first - i - 15));
+
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            v = _mm_shufflelo_epi16(v, 0x1b);
+            v = _mm_shufflehi_epi16(v, 0x1b);
+            _mm_storeu_si128((__m128i *) (destination + i), _mm_shuffle_epi32(v, 0x4e));
+        }
+    }
+
+    else if (step == 2) {
+        __m128i low = _mm_set1_epi16(0xff);
+
+        for (; i + 17 <= count; i += 16) {
+            __m128i a = _mm_loadu_si128((__m128i *) (first + 2 * i));
+            __m128i b = _mm_loadu_si128((__m128i *) (first + 2 * i + 16));
+
+            _mm_storeu_si128((__m128i *) (destination + i),
+                             _mm_packus_epi16(_mm_and_si128(a, low),
+                                              _mm_and_si128(b, low)));
+        }
+    }
+
+    gather_scalar(destination + i, first + (ptrdiff_t) i * step, count - i, step);
+}
+
+
+__attribute__((target("avx2")))
+static void gather_avx2(char *destination, char *first, size_t count,
+                        ptrdiff_t step) {
+    size_t i = 0;
+
+    if (step == -1) {
+        __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0,
+                                           15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0);
+
+        for (; i + 32 <= count; i += 32) {
+            __m256i v = _mm256_loadu_si256((__m256i *) (first - i - 31));
+
+            v = _mm256_shuffle_epi8(v, reverse);
+            _mm256_storeu_si256((__m256i *) (destination + i),
+                                _mm256_permute4x64_epi64(v, 0x4e));
+        }
+    }
+
+    else if (step == 2) {
+        __m256i low = _mm256_set1_epi16(0xff);
+
+        for (; i + 33 <= count; i += 32) {
+            __m256i a = _mm256_loadu_si256((__m256i *) (first + 2 * i));
+            __m256i b = _mm256_loadu_si256((__m256i *) (first + 2 * i + 32));
+            __m256i packed = _mm256_packus_epi16(_mm256_and_si256(a, low),
+                                                 _mm256_and_si256(b, low));
+
+            _mm256_storeu_si256((__m256i *) (destination + i),
+                                _mm256_permute4x64_epi64(packed, 0xd8));
+        }
+    }
+
+    gather_scalar(destination + i, first + (ptrdiff_t) i * step, count - i, step);
+}
+#endif
+
+
+#ifdef PL_X86
+/*
+ * Set by detect_level when the CPU has the AVX-512 VBMI byte permutes, and
+ * the VBMI2 byte compress.
+ */
+static int cpu_vbmi = 0;
+static int cpu_vbmi2 = 0;
+
+
+/*
+ * The AVX-512 kernels use 64 byte blocks and compare straight into mask
+ * registers. The tails are left to the AVX2 kernels.
+ */
+__attribute__((target("avx512f,avx512bw")))
+static char *find_avx512(char *haystack, size_t length, char *needle,
+                         size_t needle_length) {
+    if (needle_length < 2 || needle_length > length) {
+        return find_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m512i first = _mm512_set1_epi8(needle[0]);
+    __m512i last = _mm512_set1_epi8(needle[needle_length - 1]);
+    size_t i = 0;
+
+    for (; i + needle_length - 1 + 64 <= length; i += 64) {
+        __m512i block_first = _mm512_loadu_si512(haystack + i);
+        __m512i block_last = _mm512_loadu_si512(haystack + i + needle_length - 1);
+        unsigned long long mask = _mm512_cmpeq_epi8_mask(first, block_first) &
+                                  _mm512_cmpeq_epi8_mask(last, block_last);
+
+        while (mask != 0) {
+            int bit = __builtin_ctzll(mask);
+
+            if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return find_avx2(haystack + i, length - i, needle, needle_length);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static char *rchr_avx512(char *haystack, size_t length, char c) {
+    __m512i target = _mm512_set1_epi8(c);
+
+    for (; length >= 64; length -= 64) {
+        __m512i block = _mm512_loadu_si512(haystack + length - 64);
+        unsigned long long mask = _mm512_cmpeq_epi8_mask(target, block);
+
+        if (mask != 0) {
+            return haystack + length - 64 + 63 - __builtin_clzll(mask);
+        }
+    }
+
+    return rchr_avx2(haystack, length, c);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static char *rfind_avx512(char *haystack, size_t length, char *needle,
+                          size_t needle_length) {
+    if (needle_length == 1) {
+        return rchr_avx512(haystack, length, needle[0]);
+    }
+
+    if (needle_length < 2 || needle_length > length) {
+        return rfind_scalar(haystack, length, needle, needle_length);
+    }
+
+    __m512i first = _mm512_set1_epi8(needle[0]);
+    __m512i last = _mm512_set1_epi8(needle[needle_length - 1]);
+    size_t end = length - needle_length + 1;
+
+    for (; end >= 64; end -= 64) {
+        size_t i = end - 64;
+        __m512i block_first = _mm512_loadu_si512(haystack + i);
+        __m512i block_last = _mm512_loadu_si512(haystack + i + needle_length - 1);
+        unsigned long long mask = _mm512_cmpeq_epi8_mask(first, block_first) &
+                                  _mm512_cmpeq_epi8_mask(last, block_last);
+
+        while (mask != 0) {
+            int bit = 63 - __builtin_clzll(mask);
+
+            if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2)) {
+                return haystack + i + bit;
+            }
+
+            mask &= ~(1ULL << bit);
+        }
+    }
+
+    return rfind_avx2(haystack, end + needle_length - 1, needle, needle_length);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t ascii_prefix_avx512(char *string, size_t length) {
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        unsigned long long mask = _mm512_movepi8_mask(_mm512_loadu_si512(string + i));
+
+        if (mask != 0) {
+            return i + __builtin_ctzll(mask);
+        }
+    }
+
+    return i + ascii_prefix_avx2(string + i, length - i);
+}
+
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static size_t utf8_count_avx512(char *string, size_t length) {
+    __m512i limit = _mm512_set1_epi8(-64);
+    size_t i = 0, continuations = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        __m512i block = _mm512_loadu_si512(string + i);
+
+        continuations += __builtin_popcountll(_mm512_cmpgt_epi8_mask(limit, block));
+    }
+
+    return i - continuations + utf8_count_avx2(string + i, length - i);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static void case_avx512(char *destination, char *source, size_t length,
+                        char lo1, char hi1, char lo2, char hi2) {
+    __m512i flip = _mm512_set1_epi8(0x20);
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        __m512i v = _mm512_loadu_si512(source + i);
+        __mmask64 in = (_mm512_cmpge_epi8_mask(v, _mm512_set1_epi8(lo1)) &
+                        _mm512_cmple_epi8_mask(v, _mm512_set1_epi8(hi1))) |
+                       (_mm512_cmpge_epi8_mask(v, _mm512_set1_epi8(lo2)) &
+                        _mm512_cmple_epi8_mask(v, _mm512_set1_epi8(hi2)));
+
+        _mm512_storeu_si512(destination + i,
+                            _mm512_mask_blend_epi8(in, v, _mm512_xor_si512(v, flip)));
+    }
+
+    case_avx2(destination + i, source + i, length - i, lo1, hi1, lo2, hi2);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static unsigned long long ws_mask_avx512(char *block) {
+    __m512i v = _mm512_loadu_si512(block);
+
+    return _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(' ')) |
+           (_mm512_cmpge_epi8_mask(v, _mm512_set1_epi8('\t')) &
+            _mm512_cmple_epi8_mask(v, _mm512_set1_epi8('\r')));
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static void csv_mask_avx512(char *block, char delim, char quote,
+                            unsigned long long *masks) {
+    __m512i v = _mm512_loadu_si512(block);
+
+    masks[0] = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(quote));
+    masks[1] = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(delim));
+    masks[2] = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n'));
+}
+
+/*
+ * With VBMI the whole map fits in four registers, and two permutes look up
+ * 64 bytes in it whatever the map looks like.
+ */
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static void translate_vbmi(char *destination, char *source, size_t length,
+                           unsigned char *map) {
+    __m512i t0 = _mm512_loadu_si512(map), t1 = _mm512_loadu_si512(map + 64);
+    __m512i t2 = _mm512_loadu_si512(map + 128), t3 = _mm512_loadu_si512(map + 192);
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        __m512i v = _mm512_loadu_si512(source + i);
+        __m512i low = _mm512_permutex2var_epi8(t0, v, t1);
+        __m512i high = _mm512_permutex2var_epi8(t2, v, t3);
+
+        _mm512_storeu_si512(destination + i,
+                            _mm512_mask_blend_epi8(_mm512_movepi8_mask(v), low, high));
+    }
+
+    translate_scalar(destination + i, source + i, length - i, map);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static void translate_avx512(char *destination, char *source, size_t length,
+                             unsigned char *map) {
+    __m512i nibble = _mm512_set1_epi8(0x0f), rows[16];
+    struct translate_plan plan;
+    size_t i = 0;
+
+    if (cpu_vbmi) {
+        translate_vbmi(destination, source, length, map);
+
+        return;
+    }
+
+    plan_translate(map, &plan);
+
+    for (int r = 0; r < plan.rows; r++) {
+        rows[r] = _mm512_broadcast_i32x4(
+                _mm_loadu_si128((__m128i *) (map + plan.row[r] * 16)));
+    }
+
+    for (; i + 64 <= length; i += 64) {
+        __m512i v = _mm512_loadu_si512(source + i);
+        __m512i out = v;
+
+        if (plan.pairs <= TRANSLATE_SPARSE || plan.pairs <= 2 * plan.rows) {
+            for (int p = 0; p < plan.pairs; p++) {
+                out = _mm512_mask_mov_epi8(out,
+                        _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(plan.from[p])),
+                        _mm512_set1_epi8(plan.to[p]));
+            }
+        }
+
+        else {
+            __m512i low = _mm512_and_si512(v, nibble);
+            __m512i high = _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble);
+
+            for (int r = 0; r < plan.rows; r++) {
+                out = _mm512_mask_shuffle_epi8(out,
+                        _mm512_cmpeq_epi8_mask(high, _mm512_set1_epi8(plan.row[r])),
+                        rows[r], low);
+            }
+        }
+
+        _mm512_storeu_si512(destination + i, out);
+    }
+
+    translate_scalar(destination + i, source + i, length - i, map);
+}
+
+/*
+ * With VBMI2 the kept bytes are packed with one compress, and the flags are
+ * looked up in the delete map itself with two permutes.
+ */
+__attribute__((target("avx512f,avx512bw,avx512vbmi,avx512vbmi2,popcnt")))
+static size_t delete_vbmi2(char *destination, char *source, size_t length,
+                           unsigned char *map) {
+    __m512i t0 = _mm512_loadu_si512(map), t1 = _mm512_loadu_si512(map + 64);
+    __m512i t2 = _mm512_loadu_si512(map + 128), t3 = _mm512_loadu_si512(map + 192);
+    size_t i = 0, out = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        __m512i v = _mm512_loadu_si512(source + i);
+        __m512i flags = _mm512_mask_blend_epi8(_mm512_movepi8_mask(v),
+                                               _mm512_permutex2var_epi8(t0, v, t1),
+                                               _mm512_permutex2var_epi8(t2, v, t3));
+        __mmask64 keep = _mm512_testn_epi8_mask(flags, flags);
+
+        _mm512_storeu_si512(destination + out, _mm512_maskz_compress_epi8(keep, v));
+        out += __builtin_popcountll(keep);
+    }
+
+    return out + delete_scalar(destination + out, source + i, length - i, map);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t delete_avx512(char *destination, char *source, size_t length,
+                            unsigned char *map) {
+    if (cpu_vbmi2) {
+        return delete_vbmi2(destination, source, length, map);
+    }
+
+    return delete_avx2(destination, source, length, map);
+}
+
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static size_t strip_run_vbmi(char *string, size_t length, unsigned char *map,
+                             int from_end) {
+    __m512i t0 = _mm512_loadu_si512(map), t1 = _mm512_loadu_si512(map + 64);
+    __m512i t2 = _mm512_loadu_si512(map + 128), t3 = _mm512_loadu_si512(map + 192);
+    size_t run = 0;
+
+    for (; run + 64 <= length; run += 64) {
+        char *block = from_end ? string + length - run - 64 : string + run;
+        __m512i v = _mm512_loadu_si512(block);
+        __m512i flags = _mm512_mask_blend_epi8(_mm512_movepi8_mask(v),
+                                               _mm512_permutex2var_epi8(t0, v, t1),
+                                               _mm512_permutex2var_epi8(t2, v, t3));
+        unsigned long long kept = _mm512_testn_epi8_mask(flags, flags);
+
+        if (kept != 0) {
+            return run + (from_end ? __builtin_clzll(kept) : __builtin_ctzll(kept));
+        }
+    }
+
+    if (from_end) {
+        return run + strip_run_scalar(string, length - run, map, 1);
+    }
+
+    return run + strip_run_scalar(string + run, length - run, map, 0);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t strip_run_avx512(char *string, size_t length, unsigned char *map,
+                               int from_end) {
+    if (cpu_vbmi) {
+        return strip_run_vbmi(string, length, map, from_end);
+    }
+
+    return strip_run_avx2(string, length, map, from_end);
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static void gather_avx512(char *destination, char *first, size_t count,
+                          ptrdiff_t step) {
+    size_t i = 0;
+
+    if (step == -1) {
+        __m512i reverse = _mm512_broadcast_i32x4(_mm_setr_epi8(15, 14, 13, 12, 11, 10,
+                                                               9, 8, 7, 6, 5, 4,
+                                                               3, 2, 1, 0));
+        __m512i lanes = _mm512_setr_epi64(6, 7, 4, 5, 2, 3, 0, 1);
+
+        for (; i + 64 <= count; i += 64) {
+            __m512i v = _mm512_loadu_si512(first - i - 63);
+
+            v = _mm512_shuffle_epi8(v, reverse);
+            _mm512_storeu_si512(destination + i, _mm512_permutexvar_epi64(lanes, v));
+        }
+    }
+
+    // Truncating the 16 bit words keeps their low bytes, the even ones.
+    else if (step == 2) {
+        for (; i + 33 <= count; i += 32) {
+            __m512i v = _mm512_loadu_si512(first + 2 * i);
+
+            _mm256_storeu_si256((__m256i *) (destination + i), _mm512_cvtepi16_epi8(v));
+        }
+    }
+
+    gather_avx2(destination + i, first + (ptrdiff_t) i * step, count - i, step);
+}
+
+#endif
+
+
+/**
+ * @brief One set of kernels for every instruction set level. A level that
+ * has no kernel of its own for an operation uses the one from the level
+ * below it.
+ */
+struct kernel_set {
+    char *name;
+    char *(*find)(char *, size_t, char *, size_t);
+    char *(*rfind)(char *, size_t, char *, size_t);
+    size_t (*ascii_prefix)(char *, size_t);
+    size_t (*utf8_count)(char *, size_t);
+    void (*convert_case)(char *, char *, size_t, char, char, char, char);
+    char *(*find_ci)(char *, size_t, char *, size_t);
+    unsigned long long (*ws_mask)(char *);
+    void (*csv_mask)(char *, char, char, unsigned long long *);
+    unsigned long long (*prefix_xor)(unsigned long long);
+    void (*translate)(char *, char *, size_t, unsigned char *);
+    size_t (*delete_chars)(char *, char *, size_t, unsigned char *);
+    size_t (*strip_run)(char *, size_t, unsigned char *, int);
+    void (*gather)(char *, char *, size_t, ptrdiff_t);
+};
+
+
+static struct kernel_set kernel_sets[] = {
+    {"scalar", find_scalar, rfind_scalar, ascii_prefix_scalar,
+     utf8_count_scalar, case_scalar, find_ci_scalar,
+     ws_mask_scalar, csv_mask_scalar, prefix_xor_scalar, translate_scalar,
+     delete_scalar, strip_run_scalar, gather_scalar},
+#ifdef PL_X86
+    {"sse2", find_sse2, rfind_sse2, ascii_prefix_sse2,
+     utf8_count_sse2, case_sse2, find_ci_sse2,
+     ws_mask_sse2, csv_mask_sse2, prefix_xor_scalar, translate_sse2,
+     delete_sse2, strip_run_sse2, gather_sse2},
+    {"avx2", find_avx2, rfind_avx2, ascii_prefix_avx2,
+     utf8_count_avx2, case_avx2, find_ci_avx2,
+     ws_mask_avx2, csv_mask_avx2, prefix_xor_clmul, translate_avx2,
+     delete_avx2, strip_run_avx2, gather_avx2},
+    {"avx512", find_avx512, rfind_avx512, ascii_prefix_avx512,
+     utf8_count_avx512, case_avx512, find_ci_avx2,
+     ws_mask_avx512, csv_mask_avx512, prefix_xor_clmul,
+     translate_avx512, delete_avx512, strip_run_avx512, gather_avx512},
+#endif
+};
+
+
+#define KERNEL_SET_COUNT ((int) (sizeof(kernel_sets) / sizeof(kernel_sets[0])))
+
+
+static char *find_resolve(char *, size_t, char *, size_t);
+static char *rfind_resolve(char *, size_t, char *, size_t);
+static size_t ascii_prefix_resolve(char *, size_t);
+static size_t utf8_count_resolve(char *, size_t);
+static void case_resolve(char *, char *, size_t, char, char, char, char);
+static char *find_ci_resolve(char *, size_t, char *, size_t);
+static unsigned long long ws_mask_resolve(char *);
+static void csv_mask_resolve(char *, char, char, unsigned long long *);
+static unsigned long long prefix_xor_resolve(unsigned long long);
+static void translate_resolve(char *, char *, size_t, unsigned char *);
+static size_t delete_resolve(char *, char *, size_t, unsigned char *);
+static size_t strip_run_resolve(char *, size_t, unsigned char *, int);
+static void gather_resolve(char *, char *, size_t, ptrdiff_t);
+
+/*
+ * The kernels are called through these pointers. They start out pointing at
+ * resolvers, so a call made before the dispatch has been set up still binds
+ * the kernels first.
+ */
+static char *(*find_kernel)(char *, size_t, char *, size_t) = find_resolve;
+static char *(*rfind_kernel)(char *, size_t, char *, size_t) = rfind_resolve;
+static size_t (*ascii_prefix_kernel)(char *, size_t) = ascii_prefix_resolve;
+static size_t (*utf8_count_kernel)(char *, size_t) = utf8_count_resolve;
+static void (*case_kernel)(char *, char *, size_t, char, char, char, char) = case_resolve;
+static char *(*find_ci_kernel)(char *, size_t, char *, size_t) = find_ci_resolve;
+static unsigned long long (*ws_mask_kernel)(char *) = ws_mask_resolve;
+static void (*csv_mask_kernel)(char *, char, char, unsigned long long *) = csv_mask_resolve;
+static unsigned long long (*prefix_xor_kernel)(unsigned long long) = prefix_xor_resolve;
+static void (*translate_kernel)(char *, char *, size_t, unsigned char *) = translate_resolve;
+static size_t (*delete_kernel)(char *, char *, size_t, unsigned char *) = delete_resolve;
+static size_t (*strip_run_kernel)(char *, size_t, unsigned char *, int) = strip_run_resolve;
+static void (*gather_kernel)(char *, char *, size_t, ptrdiff_t) = gather_resolve;
+
+static int kernel_level = -1;
+static int best_level = -1;
+
+
+/**
+ * @brief Returns the highest kernel set level the running CPU supports.
+ */
+static int detect_level(void) {
+#ifdef PL_X86
+    __builtin_cpu_init();
+
+    int avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")
+               && __builtin_cpu_supports("pclmul");
+
+    if (avx2 && __builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw")) {
+        cpu_vbmi = __builtin_cpu_supports("avx512vbmi") != 0;
+        cpu_vbmi2 = cpu_vbmi && __builtin_cpu_supports("avx512vbmi2");
+
+        return 3;
+    }
+
+    if (avx2) {
+        return 2;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return 1;
+    }
+#endif
+
+    return 0;
+}
+
+
+/**
+ * @brief Returns the level of a kernel set by name, or \b -1 if there is no
+ * set with that name in this build.
+ */
+static int find_level(char *name) {
+    for (int i = 0; i < KERNEL_SET_COUNT; i++) {
+        if (!strcmp(kernel_sets[i].name, name)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+static void bind_kernels(int level) {
+    struct kernel_set *set = &kernel_sets[level];
+
+    find_kernel = set->find;
+    rfind_kernel = set->rfind;
+    ascii_prefix_kernel = set->ascii_prefix;
+    utf8_count_kernel = set->utf8_count;
+    case_kernel = set->convert_case;
+    find_ci_kernel = set->find_ci;
+    ws_mask_kernel = set->ws_mask;
+    csv_mask_kernel = set->csv_mask;
+    prefix_xor_kernel = set->prefix_xor;
+    translate_kernel = set->translate;
+    delete_kernel = set->delete_chars;
+    strip_run_kernel = set->strip_run;
+    gather_kernel = set->gather;
+    kernel_level = level;
+}
+
+
+/**
+ * @brief Detects the CPU features once when the library is loaded, and binds
+ * every kernel to the best set the CPU supports. The \b PLSTR_ISA environment
+ * variable can pin a lower set, a set the CPU does not support is ignored.
+ */
+__attribute__((constructor))
+static void dispatch_init(void) {
+    if (kernel_level != -1) {
+        return;
+    }
+
+    best_level = detect_level();
+
+#ifdef PL_X86
+    init_pack_table();
+#endif
+
+    int level = best_level;
+    char *isa = getenv("PLSTR_ISA");
+
+    if (isa != NULL) {
+        int wanted = find_level(isa);
+
+        if (wanted != -1 && wanted <= best_level) {
+            level = wanted;
+        }
+    }
+
+    bind_kernels(level);
+}
+
+
+static char *find_resolve(char *haystack, size_t length, char *needle,
+                          size_t needle_length) {
+    dispatch_init();
+
+    return find_kernel(haystack, length, needle, needle_length);
+}
+
+
+static char *rfind_resolve(char *haystack, size_t length, char *needle,
+                           size_t needle_length) {
+    dispatch_init();
+
+    return rfind_kernel(haystack, length, needle, needle_length);
+}
+
+
+static size_t ascii_prefix_resolve(char *string, size_t length) {
+    dispatch_init();
+
+    return ascii_prefix_kernel(string, length);
+}
+
+
+static size_t utf8_count_resolve(char *string, size_t length) {
+    dispatch_init();
+
+    return utf8_count_kernel(string, length);
+}
+
+
+static void case_resolve(char *destination, char *source, size_t length,
+                         char lo1, char hi1, char lo2, char hi2) {
+    dispatch_init();
+
+    case_kernel(destination, source, length, lo1, hi1, lo2, hi2);
+}
+
+
+static char *find_ci_resolve(char *haystack, size_t length, char *needle,
+                             size_t needle_length) {
+    dispatch_init();
+
+    return find_ci_kernel(haystack, length, needle, needle_length);
+}
+
+
+static unsigned long long ws_mask_resolve(char *block) {
+    dispatch_init();
+
+    return ws_mask_kernel(block);
+}
+
+
+static void csv_mask_resolve(char *block, char delim, char quote,
+                             unsigned long long *masks) {
+    dispatch_init();
+
+    csv_mask_kernel(block, delim, quote, masks);
+}
+
+
+static unsigned long long prefix_xor_resolve(unsigned long long bits) {
+    dispatch_init();
+
+    return prefix_xor_kernel(bits);
+}
+
+
+static void translate_resolve(char *destination, char *source, size_t length,
+                              unsigned char *map) {
+    dispatch_init();
+
+    translate_kernel(destination, source, length, map);
+}
+
+
+static size_t delete_resolve(char *destination, char *source, size_t length,
+                             unsigned char *map) {
+    dispatch_init();
+
+    return delete_kernel(destination, source, length, map);
+}
+
+
+static size_t strip_run_resolve(char *string, size_t length, unsigned char *map,
+                                int from_end) {
+    dispatch_init();
+
+    return strip_run_kernel(string, length, map, from_end);
+}
+
+
+static void gather_resolve(char *destination, char *first, size_t count,
+                           ptrdiff_t step) {
+    dispatch_init();
+
+    gather_kernel(destination, first, count, step);
+}
+
+
+/**
+ * @brief Pins the kernels to an instruction set, which is useful to compare
+ * the kernels against each other. The same names are accepted by the
+ * \b PLSTR_ISA environment variable, which is read once when the library is
+ * loaded.
+ *
+ * The kernels are not switched atomically, so call this function before any
+ * other threads use the library.
+ *
+ * @param name One of \a "scalar", \a "sse2", \a "avx2" or \a "avx512". Pass
+ * \b NULL to go back to the best set the CPU supports.
+ *
+ * @return Returns \b 0 if the kernels were switched. If the name is unknown or
+ * the CPU does not support the instruction set \b -1 is returned, and the
+ * kernels are left as they were.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    if (pl_set_isa("scalar") == 0) {
+        printf("pinned: %s\n", pl_get_isa());
+    }
+
+    if (pl_set_isa("mmx") == -1) {
+        printf("mmx is not a kernel set\n");
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+pinned: scalar
+mmx is not a kernel set
+\endcode
+ */
+int pl_set_isa(char *name) {
+    dispatch_init();
+
+    if (name == NULL) {
+        bind_kernels(best_level);
+
+        return 0;
+    }
+
+    int level = find_level(name);
+
+    if (level == -1 || level > best_level) {
+        return -1;
+    }
+
+    bind_kernels(level);
+
+    return 0;
+}
+
+
+/**
+ * @brief Returns the name of the instruction set the kernels are bound to.
+ *
+ * @return Returns one of \a "scalar", \a "sse2", \a "avx2" or \a "avx512". The
+ * string is static and must not be freed.
+ */
+char *pl_get_isa(void) {
+    dispatch_init();
+
+    return kernel_sets[kernel_level].name;
+}
+
+
+/**
+ * @brief What a cached pattern was compiled into.
+ */
+enum pattern_kind {
+    PATTERN_SEARCH,
+    PATTERN_DELETE,
+    PATTERN_SWAP
+};
+
+
+/**
+ * @brief A compiled pattern. The key is the pattern bytes, a search keeps the
+ * skip table of the Horspool search, and translate keeps its 256 byte map.
+ */
+struct pattern_entry {
+    char *key;
+    size_t key_length;
+    enum pattern_kind kind;
+    unsigned long long used;
+    union {
+        size_t skip[256];
+        unsigned char map[256];
+    } u;
+};
+
+
+struct pattern_cache {
+    struct pattern_entry *entries;
+    int capacity;
+    int count;
+    unsigned long long clock;
+};
+
+
+/*
+ * Every thread has its own cache, so the cache needs no locking. It is NULL
+ * until the thread calls pl_cache_enable.
+ */
+static PL_THREAD_LOCAL struct pattern_cache *pattern_cache = NULL;
+
+
+/**
+ * @brief Looks up a pattern in the cache of the calling thread, the key is
+ * the two parts after each other. If the pattern is not cached the least
+ * recently used entry is taken over and \a fresh is set, and the caller needs
+ * to compile the pattern into it. Returns \b NULL if the cache is not enabled
+ * or the key can not be stored.
+ */
+static struct pattern_entry *cache_get(enum pattern_kind kind, char *key,
+                                       size_t key_length, char *key2,
+                                       size_t key2_length, int *fresh) {
+    struct pattern_cache *cache = pattern_cache;
+
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    size_t length = key_length + key2_length;
+    struct pattern_entry *victim = NULL;
+
+    for (int i = 0; i < cache->count; i++) {
+        struct pattern_entry *entry = &cache->entries[i];
+
+        if (entry->kind == kind && entry->key_length == length &&
+            !memcmp(entry->key, key, key_length) &&
+            (key2_length == 0 ||
+             !memcmp(entry->key + key_length, key2, key2_length))) {
+            entry->used = ++cache->clock;
+            *fresh = 0;
+
+            return entry;
+        }
+
+        if (victim == NULL || entry->used < victim->used) {
+            victim = entry;
+        }
+    }
+
+    // Use a free entry before evicting one.
+    if (cache->count < cache->capacity) {
+        victim = &cache->entries[cache->count];
+        victim->key = NULL;
+    }
+
+    char *tmp = (char *) realloc(victim->key, length == 0 ? 1 : length);
+    if (tmp == NULL) {
+        return NULL;
+    }
+
+    if (victim == &cache->entries[cache->count]) {
+        cache->count++;
+    }
+
+    memcpy(tmp, key, key_length);
+    if (key2_length > 0) {
+        memcpy(tmp + key_length, key2, key2_length);
+    }
+
+    victim->key = tmp;
+    victim->key_length = length;
+    victim->kind = kind;
+    victim->used = ++cache->clock;
+    *fresh = 1;
+
+    return victim;
+}
+
+
+/**
+ * @brief Turns on a cache of compiled patterns for the calling thread. While
+ * it is on \ref pl_count, \ref pl_split and \ref pl_translate, and their
+ * \a _n versions, look up their pattern in the cache, and only compile it
+ * when it is not there. When the cache is full the least recently used
+ * pattern is dropped.
+ *
+ * The scalar kernels search with a Horspool skip table that is kept in the
+ * cache. The vector kernels have no setup of their own, so for them only the
+ * translate tables are reused.
+ *
+ * Every thread has its own cache, call \ref pl_cache_disable before the
+ * thread exits to free it. Calling this function again clears the cache.
+ *
+ * @param capacity The number of patterns to keep, it has to be at least 1.
+ *
+ * @return Returns \b 0 if the cache is enabled. If the function fails \b -1
+ * is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+
+
+int main() {
+    char *lines[] = {
+        "ERROR disk full", "INFO started", "ERROR timeout, ERROR retry"
+    };
+    int total = 0;
+
+    if (pl_cache_enable(16) == -1) {
+        return 1;
+    }
+
+    // The pattern is compiled on the first call, and reused after that.
+    for (int i = 0; i < 3; i++) {
+        total += pl_count(lines[i], "ERROR");
+    }
+
+    printf("errors: %d\n", total);
+
+    pl_cache_disable();
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+errors: 3
+\endcode
+ */
+int pl_cache_enable(int capacity) {
+    if (capacity < 1) {
+        return -1;
+    }
+
+    struct pattern_cache *cache = (struct pattern_cache *) malloc(
+            sizeof(struct pattern_cache));
+    if (cache == NULL) {
+        return -1;
+    }
+
+    cache->entries = (struct pattern_entry *) malloc(
+            capacity * sizeof(struct pattern_entry));
+    if (cache->entries == NULL) {
+        free(cache);
+
+        return -1;
+    }
+
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->clock = 0;
+
+    pl_cache_disable();
+    pattern_cache = cache;
+
+    return 0;
+}
+
+
+/**
+ * @brief Turns off the pattern cache of the calling thread, and frees it.
+ */
+void pl_cache_disable(void) {
+    struct pattern_cache *cache = pattern_cache;
+
+    if (cache == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < cache->count; i++) {
+        free(cache->entries[i].key);
+    }
+
+    free(cache->entries);
+    free(cache);
+    pattern_cache = NULL;
+}
+
+
+/**
+ * @brief Horspool search with a skip table made by \ref compile_skip.
+ */
+static char *find_horspool(char *haystack, size_t length, char *needle,
+                           size_t needle_length, size_t *skip) {
+    if (needle_length > length) {
+        return NULL;
+    }
+
+    char last = needle[needle_length - 1];
+
+    for (size_t i = 0; i + needle_length <= length;) {
+        char c = haystack[i + needle_length - 1];
+
+        if (c == last && !memcmp(haystack + i, needle, needle_length - 1)) {
+            return haystack + i;
+        }
+
+        i += skip[(unsigned char) c];
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Fills the skip table of the Horspool search, the distance from the
+ * last occurence of every byte in the needle to the end of the needle.
+ */
+static void compile_skip(size_t *skip, char *needle, size_t needle_length) {
+    for (int i = 0; i < 256; i++) {
+        skip[i] = needle_length;
+    }
+
+    for (size_t i = 0; i + 1 < needle_length; i++) {
+        skip[(unsigned char) needle[i]] = needle_length - 1 - i;
+    }
+}
+
+
+/**
+ * @brief Returns the cached skip table for a needle, compiling it on a miss.
+ * Returns \b NULL when the search should use the dispatched kernel, which is
+ * when the cache is off, the needle is a single byte or a vector kernel is
+ * bound.
+ */
+static size_t *cached_skip(char *needle, size_t needle_length) {
+    int fresh;
+
+    if (pattern_cache == NULL || needle_length < 2) {
+        return NULL;
+    }
+
+    dispatch_init();
+
+    if (kernel_level != 0) {
+        return NULL;
+    }
+
+    struct pattern_entry *entry = cache_get(PATTERN_SEARCH, needle,
+                                            needle_length, NULL, 0, &fresh);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    if (fresh) {
+        compile_skip(entry->u.skip, needle, needle_length);
+    }
+
+    return entry->u.skip;
+}
+
+
+/**
+ * @brief Searches with the cached skip table if there is one, and with the
+ * dispatched kernel if not.
+ */
+static char *find_pattern(char *haystack, size_t length, char *needle,
+                          size_t needle_length, size_t *skip) {
+    if (skip != NULL) {
+        return find_horspool(haystack, length, needle, needle_length, skip);
+    }
+
+    return find_kernel(haystack, length, needle, needle_length);
+}
+
+
+/**
+ * @brief This function copies a string into a buffer. If the \a destination
+ * argument is \b NULL a new buffer is allocated, and if it is not \b NULL the
+ * string passed in \a source is copied into the destination buffer.
+ *
+ * If the \a source parameter is \b NULL you will need to free the returned
+ * buffer after use.
+ *
+ * @param source This is string you want to copy into the buffer.
+ *
+ * @param destination This is the optional \a destination buffer, if \b NULL is
+ * passed a new buffer is allocated and the \a source is copied into it. If it
+ * is not \b NULL the source will be copied into the destination buffer.
+ *
+ * @return If successful a pointer to buffer is returned. If the function fails
+ * \b NULL is returned.
+ *
+ * \b Example
+ *
+ * \code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "This is a short string.";
+    char *copied_str, *pre_alloc;
+
+    copied_str = pl_cpy(the_string, NULL);
+    if (copied_str != NULL) {
+        printf("copied_str: %s\n", copied_str);
+    }
+
+    pre_alloc = (char *) calloc(strlen(the_string) + 1, sizeof(char));
+    if (pre_alloc == NULL) {
+        return 0;
+    }
+
+    if(pl_cpy(the_string, pre_alloc) != NULL) {
+        printf("pre_alloc: %s\n", pre_alloc);
+    }
+
+    free(copied_str);
+    free(pre_alloc);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+copied_str: This is a short string.
+pre_alloc: This is a short string.
+\endcode
+ */
+char *pl_cpy(char *source, char *destination) {
+    char *ret_val = destination;
+    if (source == NULL) {
+        goto error_exit;
+    }
+
+    size_t length = strlen(source);
+
+    if (destination == NULL) {
+        ret_val = (char *) malloc(length + 1);
+        if (ret_val == NULL) {
+            goto error_exit;
+        }
+    }
+
+    memcpy(ret_val, source, length + 1);
+
+    return ret_val;
+
+error_exit:
+    return NULL;
+}
+
+
+/**
+ * @brief Bounded version of \ref pl_cpy. Copies at most \a capacity - 1
+ * bytes of the source with a single memcpy, and always NUL terminates the
+ * destination. The source is given with its length, so it is never scanned
+ * and can contain NUL bytes.
+ *
+ * @param destination The buffer to copy into.
+ *
+ * @param capacity The size of the destination buffer, including the room for
+ * the NUL terminator.
+ *
+ * @param source The string you want to copy.
+ *
+ * @param source_length The length of the source.
+ *
+ * @param out_length Optional, set to the number of bytes that were copied.
+ *
+ * @return Returns \b 0 if the whole source was copied, and \b 1 if it was
+ * truncated to fit. If the function fails \b -1 is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "This is a short string.";
+    char buffer[10];
+    size_t length;
+
+    if (pl_cpy_n(buffer, sizeof(buffer), the_string, strlen(the_string), &length) == 1) {
+        printf("truncated to %d bytes: %s\n", (int) length, buffer);
+    }
+
+    if (pl_cpy_n(buffer, sizeof(buffer), the_string, 4, &length) == 0) {
+        printf("copied %d bytes: %s\n", (int) length, buffer);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+truncated to 9 bytes: This is a
+copied 4 bytes: This
+\endcode
+ */
+int pl_cpy_n(char *destination, size_t capacity, char *source,
+             size_t source_length, size_t *out_length) {
+    if (destination == NULL || source == NULL || capacity == 0) {
+        return -1;
+    }
+
+    size_t length = source_length < capacity ? source_length : capacity - 1;
+
+    memcpy(destination, source, length);
+    destination[length] = '\0';
+
+    if (out_length != NULL) {
+        *out_length = length;
+    }
+
+    return length < source_length;
+}
+
+
+/**
+ * @brief A block of arena memory. Strings are handed out from \a data until
+ * \a used reaches \a size.
+ */
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+
+struct pl_arena {
+    size_t block_size;
+    struct arena_block *head;
+    struct arena_block *first;
+};
+
+
+static struct arena_block *arena_block_new(size_t size) {
+    if (size > SIZE_MAX - sizeof(struct arena_block)) {
+        return NULL;
+    }
+
+    struct arena_block *block = (struct arena_block *) malloc(
+            sizeof(struct arena_block) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+
+/**
+ * @brief Creates an arena that strings can be duplicated into with
+ * \ref pl_dup_into_arena. The strings are carved out of large blocks, so
+ * duplicating one costs no malloc call most of the time, and all of them are
+ * released at once with \ref pl_arena_reset or \ref pl_arena_free.
+ *
+ * @param block_size The size of the blocks the arena allocates, \b 0 uses
+ * 64 KB.
+ *
+ * @return Returns a pointer to the arena, which you need to free with
+ * \ref pl_arena_free. If the function fails \b NULL is returned.
+ */
+pl_arena *pl_arena_new(size_t block_size) {
+    pl_arena *arena = (pl_arena *) malloc(sizeof(pl_arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->block_size = block_size == 0 ? 64 * 1024 : block_size;
+    arena->head = arena_block_new(arena->block_size);
+    if (arena->head == NULL) {
+        free(arena);
+
+        return NULL;
+    }
+
+    arena->first = arena->head;
+
+    return arena;
+}
+
+
+/**
+ * @brief Releases every string in the arena at once. The first block is
+ * kept, so an arena that is reset for every record does not call malloc
+ * again as long as the strings of a record fit in it.
+ *
+ * @param arena The arena you want to reset.
+ */
+void pl_arena_reset(pl_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    struct arena_block *block = arena->head;
+
+    while (block != NULL) {
+        struct arena_block *next = block->next;
+
+        if (block != arena->first) {
+            free(block);
+        }
+
+        block = next;
+    }
+
+    arena->first->next = NULL;
+    arena->first->used = 0;
+    arena->head = arena->first;
+}
+
+
+/**
+ * @brief Frees an arena and every string in it.
+ *
+ * @param arena The arena you want to free.
+ */
+void pl_arena_free(pl_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    struct arena_block *block = arena->head;
+
+    while (block != NULL) {
+        struct arena_block *next = block->next;
+
+        free(block);
+        block = next;
+    }
+
+    free(arena);
+}
+
+
+/**
+ * @brief Duplicates a string into an arena with a single memcpy. The copy is
+ * NUL terminated, and lives until the arena is reset or freed, so it must
+ * not be freed on its own.
+ *
+ * A string larger than a quarter of a block gets a block of its own, so it
+ * does not waste the rest of the current one.
+ *
+ * @param arena The arena to copy into.
+ *
+ * @param source The string you want to copy.
+ *
+ * @param length The length of the string.
+ *
+ * @return Returns a pointer to the copy. If the function fails \b NULL is
+ * returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char *records[] = {"id=1 name=ada", "id=2 name=grace"};
+    pl_arena *arena = pl_arena_new(0);
+    pl_span parts[3];
+    char *key, *value;
+
+    if (arena == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        pl_rpartition(records[i], "=", parts);
+
+        key = pl_dup_into_arena(arena, records[i], parts[0].length);
+        value = pl_dup_into_arena(arena, parts[2].ptr, parts[2].length);
+
+        if (key != NULL && value != NULL) {
+            printf("%s -> %s\n", key, value);
+        }
+
+        pl_arena_reset(arena);
+    }
+
+    pl_arena_free(arena);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+id=1 name -> ada
+id=2 name -> grace
+\endcode
+ */
+char *pl_dup_into_arena(pl_arena *arena, char *source, size_t length) {
+    struct arena_block *block;
+
+    if (arena == NULL || source == NULL ||
+        length > SIZE_MAX - sizeof(struct arena_block) - 1) {
+        return NULL;
+    }
+
+    block = arena->head;
+
+    if (block->size - block->used < length + 1) {
+        block = arena_block_new(length + 1 > arena->block_size / 4 ?
+                                length + 1 : arena->block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+
+        // A string with a block of its own goes behind the current block.
+        if (block->size != arena->block_size) {
+            block->next = arena->head->next;
+            arena->head->next = block;
+        }
+
+        else {
+            block->next = arena->head;
+            arena->head = block;
+        }
+    }
+
+    char *ret_val = block->data + block->used;
+
+    memcpy(ret_val, source, length);
+    ret_val[length] = '\0';
+    block->used += length + 1;
+
+    return ret_val;
+}
+
+
+/**
+ * @brief This function handles the offset and limit logic for the pl_slice
+ * functions. Negative values are offsetted from the end of the string. Returns
+ * \b -1 if there is nothing to slice, or if the offset or the limit is
+ * outside of the string.
+ */
+static int slice_bounds(size_t length, ptrdiff_t offset, ptrdiff_t limit,
+                        size_t *begin, size_t *end) {
+    if (length == 0) {
+        return -1;
+    }
+
+    // Get the right limit and offset if they are negative.
+    if (limit < 0) {
+        limit += length;
+    }
+
+    if (offset < 0) {
+        offset += length;
+    }
+
+    /*
+     * Exit if limit is less than offset or if they are equal, there is no
+     * characters to slice. Also exit if the limit or offset points to
+     * somewhere outside of the string.
+     */
+    if (offset < 0 || limit <= offset || (size_t) limit > length) {
+        return -1;
+    }
+
+    *begin = offset;
+    *end = limit;
+
+    return 0;
+}
+
+
+/**
+ * @brief This function slices an string using an offset and a limit and returns a
+ * substring. The original string is not manipulated in any way. The function
+ * supports the use of both a negative offset and limit. When using a negative
+ * value it is offsetted from the end of the string.
+ *
+ * You need to free the returned buffer after use.
+ *
+ * @param source The string you want to slice.
+ *
+ * @param offset The offset you want to slice from.
+ *
+ * @param limit The limit you want to slice too.
+ *
+ * @return The function returns a pointer to an allocated buffer containing the
+ * substring if successful. In cases where the limit is smaller than the
+ * offset, or if they are equal a \b NULL pointer is returned. The returned
+ * \b NULL pointer can also be returned if the call to calloc fails, or if the
+ * offset or limit is outside the range of the string.
+ *
+\b Example
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "subdermatoglyphic";
+    char *sliced;
+
+    sliced = pl_slice(the_string, 3, 10);
+    if (sliced != NULL) {
+        printf("the_string: %s\nsliced 3, 10: %s\n", the_string, sliced);
+        free(sliced);
+    }
+
+    sliced = pl_slice(the_string, 0, -10);
+    if (sliced != NULL) {
+        printf("sliced 0,-10: %s\n", sliced);
+        free(sliced);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+the_string: subdermatoglyphic
+sliced 3, 10: dermato
+sliced 0,-10: subderm
+\endcode
+ */
+char *pl_slice(char *source, int offset, int limit) {
+    if (source == NULL) {
+        return NULL;
+    }
+
+    return pl_slice_n(source, strlen(source), offset, limit, NULL);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_slice. The string is given as a
+ * pointer and a length, so it does not need to be NUL terminated and can
+ * contain NUL bytes.
+ *
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param source The string you want to slice.
+ *
+ * @param length The length of the string.
+ *
+ * @param offset The offset you want to slice from.
+ *
+ * @param limit The limit you want to slice too.
+ *
+ * @param out_length Optional, set to the length of the returned string.
+ *
+ * @return Returns a pointer to the substring. \b NULL is returned in the same
+ * cases as for \ref pl_slice.
+ */
+char *pl_slice_n(char *source, size_t length, ptrdiff_t offset,
+                 ptrdiff_t limit, size_t *out_length) {
+    if (source == NULL) {
+        return NULL;
+    }
+
+    size_t begin, end;
+
+    if (slice_bounds(length, offset, limit, &begin, &end) == -1) {
+        return NULL;
+    }
+
+    char *tmp = (char *) malloc((end - begin) + 1);
+    if (tmp == NULL) {
+        return NULL;
+    }
+
+    memcpy(tmp, source + begin, end - begin);
+    tmp[end - begin] = '\0';
+
+    if (out_length != NULL) {
+        *out_length = end - begin;
+    }
+
+    return tmp;
+}
+
+
+/**
+ * @brief Zero copy version of \ref pl_slice_n. The view points into the
+ * source, so it is only valid as long as the source is, and it is not NUL
+ * terminated.
+ *
+ * @param source The string you want to slice.
+ *
+ * @param length The length of the string.
+ *
+ * @param offset The offset you want to slice from.
+ *
+ * @param limit The limit you want to slice too.
+ *
+ * @param view Set to the part of the string between the offset and the limit.
+ *
+ * @return Returns \b 0 if the view was set. \b -1 is returned in the same
+ * cases \ref pl_slice returns \b NULL, and the view is left as it was.
+ */
+int pl_slice_view(char *source, size_t length, ptrdiff_t offset,
+                  ptrdiff_t limit, pl_span *view) {
+    size_t begin, end;
+
+    if (source == NULL || view == NULL ||
+        slice_bounds(length, offset, limit, &begin, &end) == -1) {
+        return -1;
+    }
+
+    view->ptr = source + begin;
+    view->length = end - begin;
+
+    return 0;
+}
+
+
+/**
+ * @brief Clamps the start and stop of an extended slice to the string like
+ * Python does, and returns the number of bytes in the slice.
+ */
+static size_t slice_indices(size_t length, ptrdiff_t *start, ptrdiff_t *stop,
+                            ptrdiff_t step) {
+    ptrdiff_t len = (ptrdiff_t) length;
+    ptrdiff_t lower = step < 0 ? -1 : 0, upper = step < 0 ? len - 1 : len;
+    ptrdiff_t *bounds[2] = {start, stop};
+
+    for (int i = 0; i < 2; i++) {
+        if (*bounds[i] == PL_SLICE_NONE) {
+            *bounds[i] = (i == 0) == (step < 0) ? upper : lower;
+        }
+
+        else if (*bounds[i] < 0) {
+            *bounds[i] = *bounds[i] < -len ? lower : *bounds[i] + len;
+        }
+
+        else if (*bounds[i] > upper) {
+            *bounds[i] = upper;
+        }
+    }
+
+    if (step < 0) {
+        return *start > *stop ? (size_t) ((*start - *stop - 1) / -step + 1) : 0;
+    }
+
+    return *stop > *start ? (size_t) ((*stop - *start - 1) / step + 1) : 0;
+}
+
+
+/**
+ * @brief Slices a string like Python's extended slicing, \a source[start:stop:step].
+ * Unlike \ref pl_slice, the start and stop are clamped to the string instead
+ * of failing, and a negative step walks the string backwards, so a step of
+ * \b -1 reverses it. Pass \b PL_SLICE_NONE for a start or stop that is left
+ * out in Python.
+ *
+ * A step of 1 is a single memcpy, and the steps -1 and 2 have vector kernels.
+ *
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param source The string you want to slice.
+ *
+ * @param length The length of the string.
+ *
+ * @param start The index of the first byte, negative values count from the
+ * end of the string.
+ *
+ * @param stop The index to stop before, negative values count from the end
+ * of the string.
+ *
+ * @param step The distance between the bytes, it can not be \b 0.
+ *
+ * @param out_length Optional, set to the length of the returned string.
+ *
+ * @return Returns a pointer to the slice, which is an empty string if the
+ * slice is empty. If the function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "subdermatoglyphic";
+    size_t length = strlen(the_string);
+    char *sliced;
+
+    sliced = pl_slice_ex(the_string, length, PL_SLICE_NONE, PL_SLICE_NONE, -1, NULL);
+    if (sliced != NULL) {
+        printf("[::-1]: %s\n", sliced);
+        free(sliced);
+    }
+
+    sliced = pl_slice_ex(the_string, length, 1, PL_SLICE_NONE, 2, NULL);
+    if (sliced != NULL) {
+        printf("[1::2]: %s\n", sliced);
+        free(sliced);
+    }
+
+    sliced = pl_slice_ex(the_string, length, -3, 2, -3, NULL);
+    if (sliced != NULL) {
+        printf("[-3:2:-3]: %s\n", sliced);
+        free(sliced);
+    }
+
+    sliced = pl_slice_ex(the_string, length, 3, 100, 1, NULL);
+    if (sliced != NULL) {
+        printf("[3:100]: %s\n", sliced);
+        free(sliced);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+[::-1]: cihpylgotamredbus
+[1::2]: udraolpi
+[-3:2:-3]: hltr
+[3:100]: dermatoglyphic
+\endcode
+ */
+char *pl_slice_ex(char *source, size_t length, ptrdiff_t start, ptrdiff_t stop,
+                  ptrdiff_t step, size_t *out_length) {
+    if (source == NULL || step == 0 || step == PL_SLICE_NONE ||
+        length > PTRDIFF_MAX) {
+        return NULL;
+    }
+
+    size_t count = slice_indices(length, &start, &stop, step);
+
+    char *tmp = (char *) malloc(count + 1);
+    if (tmp == NULL) {
+        return NULL;
+    }
+
+    if (step == 1) {
+        memcpy(tmp, source + start, count);
+    }
+
+    else if (count > 0) {
+        gather_kernel(tmp, source + start, count, step);
+    }
+
+    tmp[count] = '\0';
+
+    if (out_length != NULL) {
+        *out_length = count;
+    }
+
+    return tmp;
+}
+
+
+/**
+ * @brief This function creates a new buffer that is the size of the two
+ * arguments, and both arguments are copied into it. The resulting string
+ * is \a destination+source.
+ *
+ * You need to free the returned buffer after use.
+ *
+ * @param destination The first string you want to concatenation to.
+ *
+ * @param source The string you want concatenation destination with.
+ *
+ * @return Returns a pointer to the new buffer of the concatenation strings.
+ * If the function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char foo[] = "foo";
+    char bar[] = "bar";
+    char *concatenated = NULL;
+
+    concatenated = pl_cat(foo, bar);
+    if (concatenated != NULL) {
+        printf("foo:%s\nbar:%s\nconcatenated:%s\n", foo, bar, concatenated);
+    }
+
+    free(concatenated);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code
+foo:foo
+bar:bar
+concatenated:foobar
+\endcode
+ */
+char *pl_cat(char *destination, char *source) {
+    if (destination == NULL || source == NULL) {
+        return NULL;
+    }
+
+    return pl_cat_n(destination, strlen(destination), source, strlen(source),
+                    NULL);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_cat, both strings are given as a
+ * pointer and a length.
+ *
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param destination The first string you want to concatenation to.
+ *
+ * @param destination_length The length of the first string.
+ *
+ * @param source The string you want concatenation destination with.
+ *
+ * @param source_length The length of the second string.
+ *
+ * @param out_length Optional, set to the length of the returned string.
+ *
+ * @return Returns a pointer to the new buffer of the concatenation strings.
+ * If the function fails \b NULL is returned.
+ */
+char *pl_cat_n(char *destination, size_t destination_length, char *source,
+               size_t source_length, size_t *out_length) {
+    if (destination == NULL || source == NULL) {
+        return NULL;
+    }
+
+    char *ret_val = (char *) malloc(destination_length + source_length + 1);
+    if (ret_val == NULL) {
+        return NULL;
+    }
+
+    memcpy(ret_val, destination, destination_length);
+    memcpy(ret_val + destination_length, source, source_length);
+    ret_val[destination_length + source_length] = '\0';
+
+    if (out_length != NULL) {
+        *out_length = destination_length + source_length;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief This function splits the string using a delimiter, and puts the
+ * results in array of strings. The function differs from the behaviour of
+ * strtok, if the delimiter is longer than a single character it splits the
+ * string where where the delimiter is found. If the string is
+ * \a "fooasdbarasdmagic" and the delimiter is \a "asd" the result will be
+ * ["foo", "bar", "magic"]. If the delimiter is not found, or it is empty string
+ * NULL is returned instead. The original string is not modified.
+ *
+ * You need to free the returned buffer after use, remember to iterate over the
+ * returned buffer and free every element in it before you free the returned
+ * buffer.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param delim The delimiter you want to use.
+ *
+ * @param size This will be set to the size of the returned array.
+ *
+ * @return Returns an array of strings with the different sub strings if
+ * successful. The size argument is set to the size of the returned array.
+ * If the function fails \b NULL is returned.
+ *
+\b Example
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "This is a short string.";
+    char **splitted;
+    int size;
+
+    splitted = pl_split(the_string, " ", &size);
+
+    if (splitted != NULL) {
+        int i;
+
+        printf("The size is %d\n", size);
+        for (i = 0; i < size; i++) {
+            printf("splitted[%d] = %s\n", i, splitted[i]);
+        }
+
+        for (i = 0; i < size; i++) {
+            free(splitted[i]);
+        }
+
+        free(splitted);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+The size is 5
+splitted[0] = This
+splitted[1] = is
+splitted[2] = a
+splitted[3] = short
+splitted[4] = string.
+\endcode
+ */
+char **pl_split(char *string, char *delim, int *size) {
+    if (string == NULL || delim == NULL || size == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    char **ret_val = pl_split_n(string, strlen(string), delim, strlen(delim),
+                                &count, NULL);
+
+    if (ret_val != NULL) {
+        *size = (int) count;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_split. The string and the delimiter
+ * are given as a pointer and a length, and the length of every token can be
+ * returned as well, so tokens with NUL bytes can be told apart.
+ *
+ * You need to free every element of the returned array, the array itself and
+ * the lengths array if it was requested.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param length The length of the string.
+ *
+ * @param delim The delimiter you want to use.
+ *
+ * @param delim_length The length of the delimiter.
+ *
+ * @param size This will be set to the size of the returned array.
+ *
+ * @param lengths Optional, if not \b NULL it is set to an allocated array with
+ * the length of every token.
+ *
+ * @return Returns an array of NUL terminated tokens. If the delimiter is not
+ * found, or if the function fails \b NULL is returned.
+ */
+char **pl_split_n(char *string, size_t length, char *delim,
+                  size_t delim_length, size_t *size, size_t **lengths) {
+    char **tmp = NULL;
+    size_t *tmp_lengths = NULL;
+
+    if (string == NULL || length == 0 || delim == NULL || delim_length == 0
+        || size == NULL) {
+        return NULL;
+    }
+
+    // Count the number of occurences of the sub str.
+    char *pch = string, *end = string + length;
+    size_t *skip = cached_skip(delim, delim_length);
+    size_t delims = 0;
+
+    while ((pch = find_pattern(pch, end - pch, delim, delim_length, skip)) != NULL) {
+        pch += delim_length;
+        delims++;
+    }
+
+    if (delims == 0) {
+        return NULL;
+    }
+
+    tmp = (char **) calloc(delims + 1, sizeof(char *));
+    if (tmp == NULL) {
+        return NULL;
+    }
+
+    if (lengths != NULL) {
+        tmp_lengths = (size_t *) calloc(delims + 1, sizeof(size_t));
+        if (tmp_lengths == NULL) {
+            goto error_exit;
+        }
+    }
+
+    char *offset = string;
+    for (size_t i = 0; i <= delims; i++) {
+        pch = i < delims ? find_pattern(offset, end - offset, delim, delim_length,
+                                        skip) : end;
+
+        char *sub_str = (char *) malloc((pch - offset) + 1);
+        if (sub_str == NULL) {
+            goto error_exit;
+        }
+
+        memcpy(sub_str, offset, pch - offset);
+        sub_str[pch - offset] = '\0';
+
+        if (tmp_lengths != NULL) {
+            tmp_lengths[i] = pch - offset;
+        }
+
+        tmp[i] = sub_str;
+        offset = pch + delim_length;
+    }
+
+    if (lengths != NULL) {
+        *lengths = tmp_lengths;
+    }
+
+    *size = delims + 1;
+
+    return tmp;
+
+error_exit:
+    for (size_t i = 0; i < (delims + 1); i++) {
+        free(tmp[i]);
+    }
+
+    free(tmp);
+    free(tmp_lengths);
+
+    return NULL;
+}
+
+
+/**
+ * @brief Prepares an iterator over the tokens of a string, use
+ * \ref pl_split_iter_next to get the tokens one at a time. Nothing is counted
+ * or allocated, every call to next only scans up to the next delimiter, so
+ * stopping early only costs the bytes that were looked at.
+ *
+ * Unlike \ref pl_split a string without the delimiter gives one token, and an
+ * empty string gives one empty token, like Python's split. The string must
+ * not change while it is iterated.
+ *
+ * @param iter The iterator you want to prepare.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param delim The delimiter you want to use, it can not be empty.
+ *
+ * @return Returns \b 0 if the iterator is ready. If the function fails \b -1
+ * is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+
+
+int main() {
+    char line[] = "GET /index.html HTTP/1.1 200 5120 0.004 curl/8.0";
+    pl_split_iter iter;
+    pl_span token;
+
+    if (pl_split_iter_init(&iter, line, " ") == -1) {
+        return 1;
+    }
+
+    // Only the method and the path are needed, the rest is never scanned.
+    for (int i = 0; i < 2 && pl_split_iter_next(&iter, &token) == 1; i++) {
+        printf("%.*s\n", (int) token.length, token.ptr);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+GET
+/index.html
+\endcode
+ */
+int pl_split_iter_init(pl_split_iter *iter, char *string, char *delim) {
+    if (iter == NULL || string == NULL || delim == NULL || *delim == '\0') {
+        return -1;
+    }
+
+    iter->next = string;
+    iter->end = NULL;
+    iter->delim = delim;
+    iter->delim_length = strlen(delim);
+    iter->done = 0;
+
+    return 0;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_split_iter_init, the string and the
+ * delimiter are given as a pointer and a length.
+ *
+ * @param iter The iterator you want to prepare.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param length The length of the string.
+ *
+ * @param delim The delimiter you want to use.
+ *
+ * @param delim_length The length of the delimiter, it can not be \b 0.
+ *
+ * @return Returns \b 0 if the iterator is ready. If the function fails \b -1
+ * is returned.
+ */
+int pl_split_iter_init_n(pl_split_iter *iter, char *string, size_t length,
+                         char *delim, size_t delim_length) {
+    if (iter == NULL || string == NULL || delim == NULL || delim_length == 0) {
+        return -1;
+    }
+
+    iter->next = string;
+    iter->end = string + length;
+    iter->delim = delim;
+    iter->delim_length = delim_length;
+    iter->done = 0;
+
+    return 0;
+}
+
+
+/**
+ * @brief Gets the next token from an iterator prepared with
+ * \ref pl_split_iter_init. The token is a view into the string, it is not
+ * NUL terminated and should not be freed.
+ *
+ * @param iter The iterator.
+ *
+ * @param token Set to the next token.
+ *
+ * @return Returns \b 1 if a token was returned, and \b 0 when there are no
+ * more tokens. If the function fails \b -1 is returned.
+ */
+int pl_split_iter_next(pl_split_iter *iter, pl_span *token) {
+    if (iter == NULL || token == NULL) {
+        return -1;
+    }
+
+    if (iter->done) {
+        return 0;
+    }
+
+    char *pch;
+
+    // Without a known end strstr stops at the delimiter, so the rest of the
+    // string is never measured until the last token.
+    if (iter->end == NULL) {
+        pch = strstr(iter->next, iter->delim);
+    }
+
+    else {
+        pch = find_kernel(iter->next, iter->end - iter->next, iter->delim,
+                          iter->delim_length);
+    }
+
+    token->ptr = iter->next;
+
+    if (pch == NULL) {
+        token->length = iter->end == NULL ? strlen(iter->next)
+                                          : (size_t) (iter->end - iter->next);
+        iter->done = 1;
+    }
+
+    else {
+        token->length = pch - iter->next;
+        iter->next = pch + iter->delim_length;
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief Splits a string from the right, like Python's rsplit. At most
+ * \a maxsplit splits are made, starting at the end of the string, and what is
+ * left of the string becomes the first token. The tokens are returned in the
+ * order they appear in the string.
+ *
+ * The delimiters are found with a reverse search, so with a small
+ * \a maxsplit only the end of the string is searched and copied.
+ *
+ * You need to free every element of the returned array, and the array.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param delim The delimiter you want to use.
+ *
+ * @param maxsplit The maximum number of splits, or a negative number to split
+ * on every delimiter.
+ *
+ * @param size This will be set to the size of the returned array.
+ *
+ * @return Returns an array of tokens. If the delimiter is not found, or if the
+ * function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char path[] = "/var/log/nginx/access.log";
+    char **ret_val;
+    int size = 0;
+
+    ret_val = pl_rsplit(path, "/", 1, &size);
+    if (ret_val == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < size; i++) {
+        printf("%s\n", ret_val[i]);
+        free(ret_val[i]);
+    }
+
+    free(ret_val);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+/var/log/nginx
+access.log
+\endcode
+ */
+char **pl_rsplit(char *string, char *delim, int maxsplit, int *size) {
+    if (string == NULL || delim == NULL || size == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    char **ret_val = pl_rsplit_n(string, strlen(string), delim, strlen(delim),
+                                 maxsplit, &count, NULL);
+
+    if (ret_val != NULL) {
+        *size = (int) count;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_rsplit. The string and the delimiter
+ * are given as a pointer and a length, and the length of every token can be
+ * returned as well.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param length The length of the string.
+ *
+ * @param delim The delimiter you want to use.
+ *
+ * @param delim_length The length of the delimiter.
+ *
+ * @param maxsplit The maximum number of splits, or a negative number to split
+ * on every delimiter.
+ *
+ * @param size This will be set to the size of the returned array.
+ *
+ * @param lengths Optional, if not \b NULL it is set to an allocated array with
+ * the length of every token.
+ *
+ * @return Returns an array of NUL terminated tokens. If the delimiter is not
+ * found, or if the function fails \b NULL is returned.
+ */
+char **pl_rsplit_n(char *string, size_t length, char *delim,
+                   size_t delim_length, ptrdiff_t maxsplit, size_t *size,
+                   size_t **lengths) {
+    size_t stack_offsets[32];
+    size_t *offsets = stack_offsets, capacity = 32, count = 0;
+    size_t *tmp_lengths = NULL;
+    char **ret_val = NULL;
+
+    if (string == NULL || length == 0 || delim == NULL || delim_length == 0
+        || size == NULL) {
+        return NULL;
+    }
+
+    // Find the delimiters from the end, offsets[0] is the last one.
+    char *pch;
+    size_t end = length;
+
+    while ((maxsplit < 0 || count < (size_t) maxsplit) &&
+           (pch = rfind_kernel(string, end, delim, delim_length)) != NULL) {
+        if (count == capacity) {
+            size_t *tmp = (size_t *) malloc(capacity * 2 * sizeof(size_t));
+            if (tmp == NULL) {
+                goto exit;
+            }
+
+            memcpy(tmp, offsets, count * sizeof(size_t));
+            if (offsets != stack_offsets) {
+                free(offsets);
+            }
+
+            offsets = tmp;
+            capacity *= 2;
+        }
+
+        offsets[count++] = pch - string;
+        end = pch - string;
+    }
+
+    if (count == 0 && maxsplit != 0) {
+        goto exit;
+    }
+
+    ret_val = (char **) calloc(count + 1, sizeof(char *));
+    if (ret_val == NULL) {
+        goto exit;
+    }
+
+    if (lengths != NULL) {
+        tmp_lengths = (size_t *) calloc(count + 1, sizeof(size_t));
+        if (tmp_lengths == NULL) {
+            goto error_exit;
+        }
+    }
+
+    size_t begin = 0;
+    for (size_t i = 0; i <= count; i++) {
+        size_t stop = i < count ? offsets[count - 1 - i] : length;
+
+        char *sub_str = (char *) malloc((stop - begin) + 1);
+        if (sub_str == NULL) {
+            goto error_exit;
+        }
+
+        memcpy(sub_str, string + begin, stop - begin);
+        sub_str[stop - begin] = '\0';
+
+        if (tmp_lengths != NULL) {
+            tmp_lengths[i] = stop - begin;
+        }
+
+        ret_val[i] = sub_str;
+        begin = stop + delim_length;
+    }
+
+    if (lengths != NULL) {
+        *lengths = tmp_lengths;
+    }
+
+    *size = count + 1;
+
+    goto exit;
+
+error_exit:
+    for (size_t i = 0; i <= count; i++) {
+        free(ret_val[i]);
+    }
+
+    free(ret_val);
+    free(tmp_lengths);
+    ret_val = NULL;
+
+exit:
+    if (offsets != stack_offsets) {
+        free(offsets);
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Where the whitespace split writes its tokens. Either \a spans is
+ * filled up to \a capacity, or the tokens are copied to \a text and
+ * \a tokens points at them.
+ */
+struct ws_sink {
+    pl_span *spans;
+    size_t capacity;
+    char **tokens;
+    char *text;
+};
+
+
+static void ws_emit(struct ws_sink *sink, size_t index, char *start,
+                    size_t length) {
+    if (sink->tokens != NULL) {
+        memcpy(sink->text, start, length);
+        sink->text[length] = '\0';
+        sink->tokens[index] = sink->text;
+        sink->text += length + 1;
+    }
+
+    else if (index < sink->capacity) {
+        sink->spans[index].ptr = start;
+        sink->spans[index].length = length;
+    }
+}
+
+
+/**
+ * @brief Finds the runs of non whitespace in a buffer, 64 bytes at a time.
+ * The whitespace of a block is classified into a bit mask, and the tokens
+ * start and end where the mask changes, so a long run of whitespace costs the
+ * same as a single separator. Returns the number of tokens, and if \a sink is
+ * not \b NULL the tokens are written to it. \a letters is set to the number
+ * of bytes in the tokens.
+ */
+static size_t ws_tokens(char *string, size_t length, struct ws_sink *sink,
+                        size_t *letters) {
+    char pad[64];
+    size_t count = 0, whitespace = 0;
+    char *open = NULL;
+    unsigned long long carry = 1;
+
+    for (size_t base = 0; base < length; base += 64) {
+        char *block = string + base;
+        size_t block_length = length - base < 64 ? length - base : 64;
+
+        // The tail is padded with spaces, which closes a token at the end.
+        if (block_length < 64) {
+            memset(pad, ' ', sizeof(pad));
+            memcpy(pad, block, block_length);
+            block = pad;
+        }
+
+        unsigned long long ws = ws_mask_kernel(block);
+        unsigned long long prev = (ws << 1) | carry;
+        unsigned long long starts = ~ws & prev;
+        unsigned long long ends = ws & ~prev;
+
+        carry = ws >> 63;
+        whitespace += __builtin_popcountll(ws);
+
+        if (sink == NULL) {
+            count += __builtin_popcountll(starts);
+            continue;
+        }
+
+        for (unsigned long long edges = starts | ends; edges != 0;
+             edges &= edges - 1) {
+            int bit = __builtin_ctzll(edges);
+
+            if (starts & (1ULL << bit)) {
+                open = string + base + bit;
+            }
+
+            else {
+                ws_emit(sink, count, open, string + base + bit - open);
+                count++;
+                open = NULL;
+            }
+        }
+    }
+
+    // Only a buffer that fills its last block can end inside a token.
+    if (sink != NULL && open != NULL) {
+        ws_emit(sink, count, open, string + length - open);
+        count++;
+    }
+
+    if (letters != NULL) {
+        *letters = length - (whitespace - (-length & 63));
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief Splits a string on runs of whitespace, like Python's split without a
+ * separator. Whitespace at the start and the end is ignored, so no empty
+ * tokens are returned. Whitespace is the same as for \ref pl_strip.
+ *
+ * The whitespace is found with vector compares 64 bytes at a time, so runs
+ * of spaces and tabs cost no more than single separators.
+ *
+ * The array and the tokens are stored in a single allocation, so only the
+ * returned pointer needs to be freed. The array ends with a \b NULL pointer.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param size This will be set to the number of tokens.
+ *
+ * @return Returns an array of tokens. A string that is empty or only
+ * whitespace gives an array with no tokens. If the function fails \b NULL is
+ * returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char line[] = "  eth0     1500   \t 9001  UP\n";
+    char **ret_val;
+    int size = 0;
+
+    ret_val = pl_split_ws(line, &size);
+    if (ret_val == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < size; i++) {
+        printf("[%s]\n", ret_val[i]);
+    }
+
+    free(ret_val);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+[eth0]
+[1500]
+[9001]
+[UP]
+\endcode
+ */
+char **pl_split_ws(char *string, int *size) {
+    if (string == NULL || size == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    char **ret_val = pl_split_ws_n(string, strlen(string), &count);
+
+    if (ret_val != NULL) {
+        *size = (int) count;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_split_ws, the string is given as a
+ * pointer and a length. NUL bytes are not whitespace.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param length The length of the string.
+ *
+ * @param size This will be set to the number of tokens.
+ *
+ * @return Returns an array of tokens in a single allocation. If the function
+ * fails \b NULL is returned.
+ */
+char **pl_split_ws_n(char *string, size_t length, size_t *size) {
+    if (string == NULL || size == NULL) {
+        return NULL;
+    }
+
+    size_t letters = 0;
+    size_t count = ws_tokens(string, length, NULL, &letters);
+
+    char **ret_val = (char **) malloc((count + 1) * sizeof(char *) + letters +
+                                      count);
+    if (ret_val == NULL) {
+        return NULL;
+    }
+
+    struct ws_sink sink = {NULL, 0, ret_val, (char *) (ret_val + count + 1)};
+    ws_tokens(string, length, &sink, NULL);
+
+    ret_val[count] = NULL;
+    *size = count;
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Splits a string on runs of whitespace like \ref pl_split_ws, but
+ * returns the tokens as views into the string, so nothing is allocated or
+ * copied.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param length The length of the string.
+ *
+ * @param spans Array the tokens are written to, can be \b NULL if
+ * \a capacity is \b 0.
+ *
+ * @param capacity The number of tokens there is room for in \a spans.
+ *
+ * @return Returns the number of tokens in the string, which can be more than
+ * \a capacity, then only the first \a capacity tokens are written. If the
+ * function fails \b -1 is returned.
+ */
+ptrdiff_t pl_split_ws_spans(char *string, size_t length, pl_span *spans,
+                            size_t capacity) {
+    if (string == NULL || (spans == NULL && capacity != 0)) {
+        return -1;
+    }
+
+    struct ws_sink sink = {spans, capacity, NULL, NULL};
+
+    return ws_tokens(string, length, &sink, NULL);
+}
+
+
+/**
+ * @brief Sets the three parts of a partition, the separator starts at
+ * \a pch, or \a pch is \b NULL if it was not found.
+ */
+static void set_parts(pl_span *parts, char *string, size_t length, char *pch,
+                      size_t sep_length, int reverse) {
+    if (pch == NULL) {
+        // The whole string goes in the head, or in the tail from the right.
+        parts[reverse ? 2 : 0].ptr = string;
+        parts[reverse ? 2 : 0].length = length;
+        parts[reverse ? 0 : 2].ptr = string + (reverse ? 0 : length);
+        parts[reverse ? 0 : 2].length = 0;
+        parts[1].ptr = string + (reverse ? 0 : length);
+        parts[1].length = 0;
+
+        return;
+    }
+
+    parts[0].ptr = string;
+    parts[0].length = pch - string;
+    parts[1].ptr = pch;
+    parts[1].length = sep_length;
+    parts[2].ptr = pch + sep_length;
+    parts[2].length = length - (pch - string) - sep_length;
+}
+
+
+/**
+ * @brief Partitions a NUL terminated string on the first separator. The
+ * separator is found with strstr and only the tail is measured, so the string
+ * is read once.
+ */
+static int partition_string(char *string, char *sep, size_t sep_length,
+                            pl_span *parts) {
+    char *pch = strstr(string, sep);
+
+    if (pch == NULL) {
+        set_parts(parts, string, strlen(string), NULL, sep_length, 0);
+
+        return 0;
+    }
+
+    size_t length = (pch - string) + sep_length + strlen(pch + sep_length);
+    set_parts(parts, string, length, pch, sep_length, 0);
+
+    return 1;
+}
+
+
+/**
+ * @brief Splits a string in three at the first occurence of the separator,
+ * like Python's partition. The parts are the text before the separator, the
+ * separator, and the text after it. If the separator is not found the whole
+ * string is the first part, and the other two are empty.
+ *
+ * The parts are views into the string, nothing is allocated or copied.
+ *
+ * @param string The string you want to partition.
+ *
+ * @param sep The separator, it can not be empty.
+ *
+ * @param parts Array of three spans the parts are written to.
+ *
+ * @return Returns \b 1 if the separator was found and \b 0 if it was not. If
+ * the function fails \b -1 is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+
+
+int main() {
+    char *lines[] = {"host=db01.example", "port=5432", "readonly"};
+    pl_span parts[3 * 3];
+
+    if (pl_partition_many(lines, 3, "=", parts) == -1) {
+        return 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        pl_span *kv = parts + 3 * i;
+
+        printf("key: %.*s value: %.*s\n", (int) kv[0].length, kv[0].ptr,
+               (int) kv[2].length, kv[2].ptr);
+    }
+
+    pl_partition("db01.example:5432", ":", parts);
+    printf("host: %.*s\n", (int) parts[0].length, parts[0].ptr);
+
+    pl_rpartition("/usr/local/bin/env", "/", parts);
+    printf("name: %.*s\n", (int) parts[2].length, parts[2].ptr);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+key: host value: db01.example
+key: port value: 5432
+key: readonly value: 
+host: db01.example
+name: env
+\endcode
+ */
+int pl_partition(char *string, char *sep, pl_span *parts) {
+    if (string == NULL || sep == NULL || *sep == '\0' || parts == NULL) {
+        return -1;
+    }
+
+    return partition_string(string, sep, strlen(sep), parts);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_partition, the string and the
+ * separator are given as a pointer and a length.
+ *
+ * @param string The string you want to partition.
+ *
+ * @param length The length of the string.
+ *
+ * @param sep The separator.
+ *
+ * @param sep_length The length of the separator, it can not be \b 0.
+ *
+ * @param parts Array of three spans the parts are written to.
+ *
+ * @return Returns \b 1 if the separator was found and \b 0 if it was not. If
+ * the function fails \b -1 is returned.
+ */
+int pl_partition_n(char *string, size_t length, char *sep, size_t sep_length,
+                   pl_span *parts) {
+    if (string == NULL || sep == NULL || sep_length == 0 || parts == NULL) {
+        return -1;
+    }
+
+    char *pch = find_kernel(string, length, sep, sep_length);
+    set_parts(parts, string, length, pch, sep_length, 0);
+
+    return pch != NULL;
+}
+
+
+/**
+ * @brief Splits a string in three at the last occurence of the separator,
+ * like Python's rpartition. If the separator is not found the whole string is
+ * the last part, and the other two are empty. Works like \ref pl_partition
+ * otherwise.
+ *
+ * @param string The string you want to partition.
+ *
+ * @param sep The separator, it can not be empty.
+ *
+ * @param parts Array of three spans the parts are written to.
+ *
+ * @return Returns \b 1 if the separator was found and \b 0 if it was not. If
+ * the function fails \b -1 is returned.
+ */
+int pl_rpartition(char *string, char *sep, pl_span *parts) {
+    if (string == NULL || sep == NULL) {
+        return -1;
+    }
+
+    return pl_rpartition_n(string, strlen(string), sep, strlen(sep), parts);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_rpartition, the string and the
+ * separator are given as a pointer and a length.
+ *
+ * @param string The string you want to partition.
+ *
+ * @param length The length of the string.
+ *
+ * @param sep The separator.
+ *
+ * @param sep_length The length of the separator, it can not be \b 0.
+ *
+ * @param parts Array of three spans the parts are written to.
+ *
+ * @return Returns \b 1 if the separator was found and \b 0 if it was not. If
+ * the function fails \b -1 is returned.
+ */
+int pl_rpartition_n(char *string, size_t length, char *sep, size_t sep_length,
+                    pl_span *parts) {
+    if (string == NULL || sep == NULL || sep_length == 0 || parts == NULL) {
+        return -1;
+    }
+
+    char *pch = rfind_kernel(string, length, sep, sep_length);
+    set_parts(parts, string, length, pch, sep_length, 1);
+
+    return pch != NULL;
+}
+
+
+/**
+ * @brief Partitions many strings on the same separator, like calling
+ * \ref pl_partition for every string. The separator is measured once, and
+ * nothing is allocated, so the parts array can be reused for every batch.
+ *
+ * @param strings The strings you want to partition.
+ *
+ * @param count The number of strings.
+ *
+ * @param sep The separator, it can not be empty.
+ *
+ * @param parts Array with room for three spans per string, the parts of
+ * string i are written from index 3 * i.
+ *
+ * @return Returns the number of strings the separator was found in. If the
+ * function fails \b -1 is returned.
+ */
+ptrdiff_t pl_partition_many(char **strings, size_t count, char *sep,
+                            pl_span *parts) {
+    if (strings == NULL || sep == NULL || *sep == '\0' || parts == NULL) {
+        return -1;
+    }
+
+    size_t sep_length = strlen(sep);
+    ptrdiff_t found = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (strings[i] == NULL) {
+            return -1;
+        }
+
+        found += partition_string(strings[i], sep, sep_length, parts + 3 * i);
+    }
+
+    return found;
+}
+
+
+/**
+ * @brief A field of the row being read, as offsets into the buffer.
+ */
+struct csv_field {
+    size_t start;
+    size_t end;
+};
+
+
+struct pl_csv_reader {
+    char delim;
+    char quote;
+    pl_csv_row_fn callback;
+    void *arg;
+    struct csv_field *fields;
+    pl_span *spans;
+    size_t field_capacity;
+    char *scratch;
+    size_t scratch_capacity;
+    char *carry;
+    size_t carry_length;
+    size_t carry_capacity;
+    unsigned long long carry_quote;
+};
+
+
+/**
+ * @brief Creates a streaming CSV reader. The data is given to it in chunks
+ * with \ref pl_csv_reader_feed, and the callback is called once for every
+ * row with the fields of the row. A row can be split over any number of
+ * chunks.
+ *
+ * A field that starts with the quote character can contain the delimiter and
+ * newlines, and two quotes in a row inside it are read as one quote. A
+ * carriage return before a newline is dropped, and empty lines are skipped.
+ *
+ * The quotes, delimiters and newlines are found with vector compares 64 bytes
+ * at a time, and the bytes inside quotes are found from a prefix xor of the
+ * quote mask, so the data is classified in one pass without a branch per
+ * byte.
+ *
+ * @param delim The field delimiter, it can not be NUL or a newline.
+ *
+ * @param quote The quote character, it can not be the delimiter.
+ *
+ * @param callback Called with the fields of every row and \a arg. The fields
+ * are only valid during the call. It returns \b 0 to keep reading, anything
+ * else stops the reader.
+ *
+ * @param arg Passed to the callback.
+ *
+ * @return Returns a pointer to the reader, which you need to free with
+ * \ref pl_csv_reader_free. If the function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <string.h>
+
+
+static int print_row(pl_span *fields, size_t count, void *arg) {
+    for (size_t i = 0; i < count; i++) {
+        printf("%s[%.*s]", i ? " " : "", (int) fields[i].length, fields[i].ptr);
+    }
+
+    printf("\n");
+
+    return 0;
+}
+
+
+int main() {
+    char *chunks[] = {
+        "id,name,comment\r\n1,Ada,\"likes \"\"commas\"\", a",
+        "nd\nnewlines\"\n2,Bob,plain\n3,Eve,\"no newline at the end\""
+    };
+    pl_csv_reader *reader;
+
+    reader = pl_csv_reader_new(',', '"', print_row, NULL);
+    if (reader == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        pl_csv_reader_feed(reader, chunks[i], strlen(chunks[i]));
+    }
+
+    pl_csv_reader_finish(reader);
+    pl_csv_reader_free(reader);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+[id] [name] [comment]
+[1] [Ada] [likes "commas", and
+newlines]
+[2] [Bob] [plain]
+[3] [Eve] [no newline at the end]
+\endcode
+ */
+pl_csv_reader *pl_csv_reader_new(char delim, char quote,
+                                 pl_csv_row_fn callback, void *arg) {
+    if (callback == NULL || delim == '\0' || delim == '\n' || quote == delim) {
+        return NULL;
+    }
+
+    pl_csv_reader *reader = (pl_csv_reader *) calloc(1, sizeof(pl_csv_reader));
+    if (reader == NULL) {
+        return NULL;
+    }
+
+    reader->delim = delim;
+    reader->quote = quote;
+    reader->callback = callback;
+    reader->arg = arg;
+
+    return reader;
+}
+
+
+/**
+ * @brief Frees a reader created with \ref pl_csv_reader_new. A row that was
+ * not finished is dropped.
+ *
+ * @param reader The reader you want to free.
+ */
+void pl_csv_reader_free(pl_csv_reader *reader) {
+    if (reader == NULL) {
+        return;
+    }
+
+    free(reader->fields);
+    free(reader->spans);
+    free(reader->scratch);
+    free(reader->carry);
+    free(reader);
+}
+
+
+/**
+ * @brief Finds the delimiters and newlines that are not inside quotes in the
+ * 64 byte block at \a base. \a in_quote is all ones if the block starts
+ * inside quotes, and is updated for the next block.
+ */
+static void csv_block(pl_csv_reader *reader, char *buf, size_t length,
+                      size_t base, unsigned long long *in_quote,
+                      unsigned long long *delims,
+                      unsigned long long *newlines) {
+    char pad[64];
+    char *block = buf + base;
+    unsigned long long masks[3], valid = ~0ULL;
+
+    if (length - base < 64) {
+        memset(pad, 0, sizeof(pad));
+        memcpy(pad, block, length - base);
+        block = pad;
+        valid = (1ULL << (length - base)) - 1;
+    }
+
+    csv_mask_kernel(block, reader->delim, reader->quote, masks);
+
+    unsigned long long inside = prefix_xor_kernel(masks[0] & valid) ^ *in_quote;
+
+    *in_quote = (unsigned long long) ((long long) inside >> 63);
+    *delims = masks[1] & valid & ~inside;
+    *newlines = masks[2] & valid & ~inside;
+}
+
+
+/**
+ * @brief Grows a buffer to hold at least \a needed bytes. Returns \b -1 if it
+ * can not be grown.
+ */
+static int csv_reserve(char **buffer, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = *capacity ? *capacity : 256;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    char *tmp = (char *) realloc(*buffer, new_capacity);
+    if (tmp == NULL) {
+        return -1;
+    }
+
+    *buffer = tmp;
+    *capacity = new_capacity;
+
+    return 0;
+}
+
+
+static int csv_add_field(pl_csv_reader *reader, size_t index, size_t start,
+                         size_t end) {
+    if (index == reader->field_capacity) {
+        size_t capacity = reader->field_capacity ? reader->field_capacity * 2 : 16;
+
+        struct csv_field *fields = (struct csv_field *) realloc(
+                reader->fields, capacity * sizeof(struct csv_field));
+        if (fields == NULL) {
+            return -1;
+        }
+
+        reader->fields = fields;
+
+        pl_span *spans = (pl_span *) realloc(reader->spans,
+                                             capacity * sizeof(pl_span));
+        if (spans == NULL) {
+            return -1;
+        }
+
+        reader->spans = spans;
+        reader->field_capacity = capacity;
+    }
+
+    reader->fields[index].start = start;
+    reader->fields[index].end = end;
+
+    return 0;
+}
+
+
+/**
+ * @brief Turns the fields of a finished row into spans, and calls the
+ * callback. Unquoted fields point into the buffer, quoted fields are
+ * unescaped into the scratch buffer. Returns the value of the callback, or
+ * \b -1 if the scratch buffer can not be grown.
+ */
+static int csv_emit_row(pl_csv_reader *reader, char *buf, size_t row_start,
+                        size_t count) {
+    struct csv_field *fields = reader->fields;
+    char quote = reader->quote;
+
+    if (fields[count - 1].end > fields[count - 1].start &&
+        buf[fields[count - 1].end - 1] == '\r') {
+        fields[count - 1].end--;
+    }
+
+    if (count == 1 && fields[0].end == fields[0].start) {
+        return 0;
+    }
+
+    if (csv_reserve(&reader->scratch, &reader->scratch_capacity,
+                    fields[count - 1].end - row_start) == -1) {
+        return -1;
+    }
+
+    char *out = reader->scratch;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t start = fields[i].start, end = fields[i].end;
+
+        if (start == end || buf[start] != quote) {
+            reader->spans[i].ptr = buf + start;
+            reader->spans[i].length = end - start;
+            continue;
+        }
+
+        int inside = 0;
+        reader->spans[i].ptr = out;
+
+        for (size_t x = start; x < end; x++) {
+            if (buf[x] != quote) {
+                *out++ = buf[x];
+            }
+
+            else if (inside && x + 1 < end && buf[x + 1] == quote) {
+                *out++ = quote;
+                x++;
+            }
+
+            else {
+                inside = !inside;
+            }
+        }
+
+        reader->spans[i].length = out - reader->spans[i].ptr;
+    }
+
+    return reader->callback(reader->spans, count, reader->arg);
+}
+
+
+/**
+ * @brief Reads the rows of a buffer that starts at the start of a row. Every
+ * row that ends with a newline is given to the callback, and if \a final is
+ * set the rest of the buffer is a row too. \a consumed is set to the offset
+ * after the last row, and \a in_quote to the quote state at the end.
+ * Returns \b 0, \b 1 if the callback stopped the reader or \b -1 on failure.
+ */
+static int csv_rows(pl_csv_reader *reader, char *buf, size_t length,
+                    int final, size_t *consumed, unsigned long long *in_quote) {
+    size_t row_start = 0, field_start = 0, count = 0;
+    unsigned long long quote_state = 0, delims, newlines;
+    int status = 0;
+
+    for (size_t base = 0; base < length && status == 0; base += 64) {
+        csv_block(reader, buf, length, base, &quote_state, &delims, &newlines);
+
+        for (unsigned long long edges = delims | newlines; edges != 0;
+             edges &= edges - 1) {
+            int bit = __builtin_ctzll(edges);
+            size_t pos = base + bit;
+
+            if (csv_add_field(reader, count++, field_start, pos) == -1) {
+                return -1;
+            }
+
+            field_start = pos + 1;
+
+            if (newlines & (1ULL << bit)) {
+                status = csv_emit_row(reader, buf, row_start, count);
+                row_start = pos + 1;
+                count = 0;
+
+                if (status != 0) {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (status == 0 && final && row_start < length) {
+        if (csv_add_field(reader, count++, field_start, length) == -1) {
+            return -1;
+        }
+
+        status = csv_emit_row(reader, buf, row_start, count);
+        row_start = length;
+    }
+
+    *consumed = row_start;
+    *in_quote = quote_state;
+
+    if (status != 0) {
+        return status == -1 ? -1 : 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Appends bytes to the unfinished row kept between chunks.
+ */
+static int csv_carry(pl_csv_reader *reader, char *data, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+
+    if (csv_reserve(&reader->carry, &reader->carry_capacity,
+                    reader->carry_length + length) == -1) {
+        return -1;
+    }
+
+    memcpy(reader->carry + reader->carry_length, data, length);
+    reader->carry_length += length;
+
+    return 0;
+}
+
+
+/**
+ * @brief Gives the next chunk of data to a reader. Every row that is
+ * finished in the chunk is passed to the callback, and the unfinished row at
+ * the end is kept until the next chunk. The chunk does not need to be NUL
+ * terminated, and it is not used after the call.
+ *
+ * @param reader The reader.
+ *
+ * @param chunk The data.
+ *
+ * @param length The length of the data.
+ *
+ * @return Returns \b 0 when the chunk has been read, or \b 1 if the callback
+ * stopped the reader, then the rest of the data is dropped. If the function
+ * fails \b -1 is returned.
+ */
+int pl_csv_reader_feed(pl_csv_reader *reader, char *chunk, size_t length) {
+    size_t consumed = 0;
+    int status;
+
+    if (reader == NULL || (chunk == NULL && length != 0)) {
+        return -1;
+    }
+
+    // Finish the row from the last chunk first, it ends at the first newline
+    // that is not inside quotes.
+    if (reader->carry_length > 0) {
+        unsigned long long in_quote = reader->carry_quote, delims, newlines = 0;
+        size_t base;
+
+        for (base = 0; base < length; base += 64) {
+            csv_block(reader, chunk, length, base, &in_quote, &delims,
+                      &newlines);
+
+            if (newlines != 0) {
+                break;
+            }
+        }
+
+        if (newlines == 0) {
+            reader->carry_quote = in_quote;
+
+            return csv_carry(reader, chunk, length);
+        }
+
+        size_t row_end = base + __builtin_ctzll(newlines) + 1;
+
+        if (csv_carry(reader, chunk, row_end) == -1) {
+            return -1;
+        }
+
+        status = csv_rows(reader, reader->carry, reader->carry_length, 0,
+                          &consumed, &in_quote);
+        reader->carry_length = 0;
+        reader->carry_quote = 0;
+
+        if (status != 0) {
+            return status;
+        }
+
+        chunk += row_end;
+        length -= row_end;
+    }
+
+    status = csv_rows(reader, chunk, length, 0, &consumed,
+                      &reader->carry_quote);
+    if (status != 0) {
+        reader->carry_quote = 0;
+
+        return status;
+    }
+
+    return csv_carry(reader, chunk + consumed, length - consumed);
+}
+
+
+/**
+ * @brief Tells a reader there is no more data, so a last row without a
+ * newline at the end is passed to the callback. The reader can be fed again
+ * after this.
+ *
+ * @param reader The reader.
+ *
+ * @return Returns \b 0, or \b 1 if the callback stopped the reader. If the
+ * function fails \b -1 is returned.
+ */
+int pl_csv_reader_finish(pl_csv_reader *reader) {
+    size_t consumed;
+    unsigned long long in_quote;
+
+    if (reader == NULL) {
+        return -1;
+    }
+
+    if (reader->carry_length == 0) {
+        return 0;
+    }
+
+    int status = csv_rows(reader, reader->carry, reader->carry_length, 1,
+                          &consumed, &in_quote);
+
+    reader->carry_length = 0;
+    reader->carry_quote = 0;
+
+    return status;
+}
+
+
+struct pl_kv_filter {
+    size_t mask;
+    pl_span *slots;
+    char *keys;
+};
+
+
+/**
+ * @brief FNV-1a hash of a key.
+ */
+static size_t kv_hash(char *key, size_t length) {
+    size_t hash = (size_t) 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) key[i];
+        hash *= (size_t) 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief Returns the slot of a key in the filter, which is either the slot
+ * holding the key or the empty slot where it would go.
+ */
+static pl_span *kv_slot(pl_kv_filter *filter, char *key, size_t length) {
+    size_t i = kv_hash(key, length) & filter->mask;
+
+    while (filter->slots[i].ptr != NULL) {
+        pl_span *slot = &filter->slots[i];
+
+        if (slot->length == length && !memcmp(slot->ptr, key, length)) {
+            return slot;
+        }
+
+        i = (i + 1) & filter->mask;
+    }
+
+    return &filter->slots[i];
+}
+
+
+/**
+ * @brief Creates a set of keys for \ref pl_kv_parse, only pairs with one of
+ * these keys are returned. The keys are copied, and are looked up in a hash
+ * table with open addressing.
+ *
+ * @param keys The keys you want to keep.
+ *
+ * @param count The number of keys.
+ *
+ * @return Returns a pointer to the filter, which you need to free with
+ * \ref pl_kv_filter_free. If the function fails \b NULL is returned.
+ */
+pl_kv_filter *pl_kv_filter_new(char **keys, int count) {
+    if (keys == NULL || count < 1) {
+        return NULL;
+    }
+
+    size_t key_bytes = 0, size = 16;
+
+    for (int i = 0; i < count; i++) {
+        if (keys[i] == NULL) {
+            return NULL;
+        }
+
+        key_bytes += strlen(keys[i]) + 1;
+    }
+
+    // Keep the table at most half full.
+    while (size < (size_t) count * 2) {
+        size *= 2;
+    }
+
+    pl_kv_filter *filter = (pl_kv_filter *) malloc(sizeof(pl_kv_filter));
+    if (filter == NULL) {
+        return NULL;
+    }
+
+    filter->mask = size - 1;
+    filter->slots = (pl_span *) calloc(size, sizeof(pl_span));
+    filter->keys = (char *) malloc(key_bytes);
+
+    if (filter->slots == NULL || filter->keys == NULL) {
+        pl_kv_filter_free(filter);
+
+        return NULL;
+    }
+
+    char *pch = filter->keys;
+
+    for (int i = 0; i < count; i++) {
+        size_t length = strlen(keys[i]);
+        pl_span *slot = kv_slot(filter, keys[i], length);
+
+        if (slot->ptr == NULL) {
+            memcpy(pch, keys[i], length + 1);
+            slot->ptr = pch;
+            slot->length = length;
+            pch += length + 1;
+        }
+    }
+
+    return filter;
+}
+
+
+/**
+ * @brief Frees a filter created with \ref pl_kv_filter_new.
+ *
+ * @param filter The filter you want to free.
+ */
+void pl_kv_filter_free(pl_kv_filter *filter) {
+    if (filter == NULL) {
+        return;
+    }
+
+    free(filter->slots);
+    free(filter->keys);
+    free(filter);
+}
+
+
+/**
+ * @brief Parses the key=value pairs of a line, like
+ * <a>'k1=v1 k2="v 2" k3=v3'</a>. The line is walked once and the keys and
+ * values are returned as views into it, so nothing is allocated or copied.
+ *
+ * Pairs are separated by one or more \a pair_sep, and the key ends at the
+ * first \a kv_sep. A value that starts with the quote character runs to the
+ * closing quote and can contain the separators, a backslash in it escapes
+ * the next character. The quotes are not part of the value, and escapes are
+ * left as they are. Words without a \a kv_sep are skipped.
+ *
+ * @param line The line you want to parse.
+ *
+ * @param pair_sep The separator between pairs, often a space.
+ *
+ * @param kv_sep The separator between a key and its value, often '='.
+ *
+ * @param quote The quote character, or NUL if values are never quoted.
+ *
+ * @param filter Optional, if set only pairs with a key in the filter are
+ * returned, the others are skipped without being stored.
+ *
+ * @param pairs Array the pairs are written to.
+ *
+ * @param capacity The number of pairs there is room for.
+ *
+ * @return Returns the number of pairs in the line, which can be more than
+ * \a capacity, then only the first \a capacity pairs are written. If the
+ * function fails \b -1 is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+
+
+int main() {
+    char line[] = "ts=1700000000 method=GET path=\"/a b\" status=200 ua=\"x\\\"y\"";
+    char *wanted[] = {"path", "status", "ua"};
+    pl_kv_filter *filter;
+    pl_kv_pair pairs[8];
+    ptrdiff_t count;
+
+    filter = pl_kv_filter_new(wanted, 3);
+    if (filter == NULL) {
+        return 1;
+    }
+
+    count = pl_kv_parse(line, ' ', '=', '"', filter, pairs, 8);
+
+    for (ptrdiff_t i = 0; i < count; i++) {
+        printf("%.*s -> %.*s\n", (int) pairs[i].key.length, pairs[i].key.ptr,
+               (int) pairs[i].value.length, pairs[i].value.ptr);
+    }
+
+    pl_kv_filter_free(filter);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+path -> /a b
+status -> 200
+ua -> x\"y
+\endcode
+ */
+ptrdiff_t pl_kv_parse(char *line, char pair_sep, char kv_sep, char quote,
+                      pl_kv_filter *filter, pl_kv_pair *pairs,
+                      size_t capacity) {
+    if (line == NULL) {
+        return -1;
+    }
+
+    return pl_kv_parse_n(line, strlen(line), pair_sep, kv_sep, quote, filter,
+                         pairs, capacity);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_kv_parse, the line is given as a
+ * pointer and a length.
+ *
+ * @return Returns the number of pairs in the line. If the function fails
+ * \b -1 is returned.
+ */
+ptrdiff_t pl_kv_parse_n(char *line, size_t length, char pair_sep, char kv_sep,
+                        char quote, pl_kv_filter *filter, pl_kv_pair *pairs,
+                        size_t capacity) {
+    if (line == NULL || (pairs == NULL && capacity != 0) || pair_sep == kv_sep) {
+        return -1;
+    }
+
+    char *pch = line, *end = line + length;
+    size_t count = 0;
+
+    while (pch < end) {
+        while (pch < end && *pch == pair_sep) {
+            pch++;
+        }
+
+        char *key = pch;
+
+        while (pch < end && *pch != pair_sep && *pch != kv_sep) {
+            pch++;
+        }
+
+        if (pch == end || *pch == pair_sep) {
+            continue;
+        }
+
+        size_t key_length = pch - key;
+        char *value = ++pch;
+        size_t value_length;
+
+        if (quote != '\0' && pch < end && *pch == quote) {
+            value = ++pch;
+
+            while (pch < end && *pch != quote) {
+                pch += (*pch == '\\' && pch + 1 < end) ? 2 : 1;
+            }
+
+            value_length = pch - value;
+
+            // Step over the closing quote.
+            if (pch < end) {
+                pch++;
+            }
+        }
+
+        else {
+            while (pch < end && *pch != pair_sep) {
+                pch++;
+            }
+
+            value_length = pch - value;
+        }
+
+        if (filter != NULL && kv_slot(filter, key, key_length)->ptr == NULL) {
+            continue;
+        }
+
+        if (count < capacity) {
+            pairs[count].key.ptr = key;
+            pairs[count].key.length = key_length;
+            pairs[count].value.ptr = value;
+            pairs[count].value.length = value_length;
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief Returns \b 1 if all 8 bytes of a little endian word are ASCII
+ * digits.
+ */
+static int swar_is_digits(unsigned long long word) {
+    return ((word & 0xF0F0F0F0F0F0F0F0ULL) |
+            (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+
+/**
+ * @brief Converts 8 ASCII digits in a little endian word to their value, by
+ * combining pairs of digits, then pairs of pairs, with three multiplies.
+ */
+static unsigned long long swar_digits(unsigned long long word) {
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+
+    return (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+}
+
+
+/**
+ * @brief Parses the digits of an unsigned number. Runs of 8 digits are
+ * converted at once on little endian machines. Returns \b -1 if there are no
+ * digits, a byte is not a digit or the value does not fit in 64 bits.
+ */
+static int parse_digits(char *string, size_t length, uint64_t *value) {
+    uint64_t result = 0;
+    size_t i = 0;
+
+    if (length == 0) {
+        return -1;
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= length; i += 8) {
+        unsigned long long word;
+        memcpy(&word, string + i, 8);
+
+        if (!swar_is_digits(word)) {
+            break;
+        }
+
+        if (__builtin_mul_overflow(result, (uint64_t) 100000000, &result) ||
+            __builtin_add_overflow(result, (uint64_t) swar_digits(word), &result)) {
+            return -1;
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        unsigned int digit = (unsigned char) string[i] - '0';
+
+        if (digit > 9) {
+            return -1;
+        }
+
+        if (__builtin_mul_overflow(result, (uint64_t) 10, &result) ||
+            __builtin_add_overflow(result, (uint64_t) digit, &result)) {
+            return -1;
+        }
+    }
+
+    *value = result;
+
+    return 0;
+}
+
+
+/**
+ * @brief Parses an unsigned decimal integer. The whole span has to be the
+ * number, an optional '+' followed by digits, whitespace is not skipped and
+ * the locale is not used.
+ *
+ * @param span The text of the number, for example a token from
+ * \ref pl_split_iter_next.
+ *
+ * @param value Set to the number.
+ *
+ * @return Returns \b 0 if the span is a number that fits in 64 bits. If it is
+ * not \b -1 is returned.
+ */
+int pl_parse_u64(pl_span span, uint64_t *value) {
+    if (span.ptr == NULL || value == NULL) {
+        return -1;
+    }
+
+    if (span.length > 0 && span.ptr[0] == '+') {
+        span.ptr++;
+        span.length--;
+    }
+
+    return parse_digits(span.ptr, span.length, value);
+}
+
+
+/**
+ * @brief Parses a signed decimal integer, works like \ref pl_parse_u64 but
+ * the number can start with '-'.
+ *
+ * @param span The text of the number.
+ *
+ * @param value Set to the number.
+ *
+ * @return Returns \b 0 if the span is a number that fits in 64 bits. If it is
+ * not \b -1 is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+
+int main() {
+    int64_t values[8];
+    double price;
+    ptrdiff_t count;
+    pl_span span = {"-9223372036854775808", 20};
+
+    count = pl_split_to_i64("17,-4,+250,1000000000000", ",", values, 8);
+    for (ptrdiff_t i = 0; i < count; i++) {
+        printf("%" PRId64 "\n", values[i]);
+    }
+
+    if (pl_parse_i64(span, &values[0]) == 0) {
+        printf("min: %" PRId64 "\n", values[0]);
+    }
+
+    span.ptr = "1.25e2";
+    span.length = 6;
+    if (pl_parse_f64(span, &price) == 0) {
+        printf("price: %.2f\n", price);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+17
+-4
+250
+1000000000000
+min: -9223372036854775808
+price: 125.00
+\endcode
+ */
+int pl_parse_i64(pl_span span, int64_t *value) {
+    uint64_t magnitude;
+    int negative = 0;
+
+    if (span.ptr == NULL || value == NULL) {
+        return -1;
+    }
+
+    if (span.length > 0 && (span.ptr[0] == '-' || span.ptr[0] == '+')) {
+        negative = span.ptr[0] == '-';
+        span.ptr++;
+        span.length--;
+    }
+
+    if (parse_digits(span.ptr, span.length, &magnitude) == -1) {
+        return -1;
+    }
+
+    if (magnitude > (uint64_t) INT64_MAX + negative) {
+        return -1;
+    }
+
+    *value = negative ? (int64_t) (0 - magnitude) : (int64_t) magnitude;
+
+    return 0;
+}
+
+
+/**
+ * @brief Parses a float with strtod, after changing the '.' to the decimal
+ * point of the current locale. The span has already been checked.
+ */
+static int parse_f64_strtod(pl_span span, double *value) {
+    char local[128], *buffer = local, *end;
+    char *point = localeconv()->decimal_point;
+    size_t point_length = strlen(point);
+    size_t needed = span.length + point_length + 1;
+
+    if (needed > sizeof(local)) {
+        buffer = (char *) malloc(needed);
+        if (buffer == NULL) {
+            return -1;
+        }
+    }
+
+    char *out = buffer;
+    for (size_t i = 0; i < span.length; i++) {
+        if (span.ptr[i] == '.') {
+            memcpy(out, point, point_length);
+            out += point_length;
+        }
+
+        else {
+            *out++ = span.ptr[i];
+        }
+    }
+
+    *out = '\0';
+    *value = strtod(buffer, &end);
+
+    int ret_val = end == out ? 0 : -1;
+
+    if (buffer != local) {
+        free(buffer);
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Parses a decimal floating point number, like
+ * <a>'-12.5e-3'</a>, 'inf' or 'nan'. The decimal point is always '.', so
+ * the result does not depend on the locale, and the whole span has to be the
+ * number.
+ *
+ * When the digits fit in a double and the power of ten is small the result
+ * is computed with one exact multiply or divide, which is correctly rounded
+ * (Clinger's fast path). Other numbers are given to strtod.
+ *
+ * @param span The text of the number.
+ *
+ * @param value Set to the number.
+ *
+ * @return Returns \b 0 if the span is a number. If it is not \b -1 is
+ * returned.
+ */
+int pl_parse_f64(pl_span span, double *value) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    char *pch, *end;
+    uint64_t mantissa = 0;
+    int negative = 0, digits = 0, significant = 0;
+    long exponent = 0;
+
+    if (span.ptr == NULL || value == NULL || span.length == 0) {
+        return -1;
+    }
+
+    pch = span.ptr;
+    end = span.ptr + span.length;
+
+    if (*pch == '-' || *pch == '+') {
+        negative = *pch == '-';
+        pch++;
+    }
+
+    size_t rest = end - pch;
+
+    if ((rest == 3 && equal_ci(pch, "inf", 3)) ||
+        (rest == 8 && equal_ci(pch, "infinity", 8))) {
+        *value = negative ? -INFINITY : INFINITY;
+
+        return 0;
+    }
+
+    if (rest == 3 && equal_ci(pch, "nan", 3)) {
+        *value = negative ? -NAN : NAN;
+
+        return 0;
+    }
+
+    for (int fraction = 0; pch < end; pch++) {
+        if (*pch == '.' && !fraction) {
+            fraction = 1;
+            continue;
+        }
+
+        if (*pch < '0' || *pch > '9') {
+            break;
+        }
+
+        digits++;
+
+        // Leading zeros are not significant.
+        if (significant == 0 && *pch == '0') {
+            exponent -= fraction;
+            continue;
+        }
+
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (*pch - '0');
+            exponent -= fraction;
+        }
+
+        else {
+            exponent += !fraction;
+        }
+
+        significant++;
+    }
+
+    if (digits == 0) {
+        return -1;
+    }
+
+    if (pch < end && (*pch == 'e' || *pch == 'E')) {
+        int exp_negative = 0;
+        long exp_value = 0;
+
+        pch++;
+
+        if (pch < end && (*pch == '-' || *pch == '+')) {
+            exp_negative = *pch == '-';
+            pch++;
+        }
+
+        if (pch == end) {
+            return -1;
+        }
+
+        for (; pch < end && *pch >= '0' && *pch <= '9'; pch++) {
+            if (exp_value < 100000) {
+                exp_value = exp_value * 10 + (*pch - '0');
+            }
+        }
+
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    if (pch != end) {
+        return -1;
+    }
+
+    // Exact when the mantissa and the power of ten are both exact doubles.
+    if (significant <= 19 && mantissa <= (1ULL << 53) &&
+        exponent >= -22 && exponent <= 22) {
+        double result = (double) mantissa;
+
+        if (exponent < 0) {
+            result /= powers[-exponent];
+        }
+
+        else {
+            result *= powers[exponent];
+        }
+
+        *value = negative ? -result : result;
+
+        return 0;
+    }
+
+    if (mantissa == 0 && significant == 0) {
+        *value = negative ? -0.0 : 0.0;
+
+        return 0;
+    }
+
+    return parse_f64_strtod(span, value);
+}
+
+
+/**
+ * @brief Parses a delimited line of integers straight into an array, like
+ * splitting the line and calling \ref pl_parse_i64 on every token, but no
+ * tokens are created.
+ *
+ * @param line The line you want to parse.
+ *
+ * @param delim The delimiter between the numbers.
+ *
+ * @param values Array the numbers are written to.
+ *
+ * @param capacity The number of values there is room for.
+ *
+ * @return Returns the number of fields in the line, which can be more than
+ * \a capacity, then only the first \a capacity numbers are written. If a field
+ * is not a number, or if the function fails \b -1 is returned.
+ */
+ptrdiff_t pl_split_to_i64(char *line, char *delim, int64_t *values,
+                          size_t capacity) {
+    if (line == NULL || delim == NULL) {
+        return -1;
+    }
+
+    return pl_split_to_i64_n(line, strlen(line), delim, strlen(delim), values,
+                             capacity);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_split_to_i64, the line and the
+ * delimiter are given as a pointer and a length.
+ *
+ * @return Returns the number of fields in the line. If a field is not a
+ * number, or if the function fails \b -1 is returned.
+ */
+ptrdiff_t pl_split_to_i64_n(char *line, size_t length, char *delim,
+                            size_t delim_length, int64_t *values,
+                            size_t capacity) {
+    if (line == NULL || length == 0 || delim == NULL || delim_length == 0 ||
+        (values == NULL && capacity != 0)) {
+        return -1;
+    }
+
+    char *pch = line, *end = line + length;
+    size_t count = 0;
+
+    for (;;) {
+        char *next = find_kernel(pch, end - pch, delim, delim_length);
+        pl_span field = {pch, (next == NULL ? end : next) - pch};
+        int64_t value;
+
+        if (pl_parse_i64(field, &value) == -1) {
+            return -1;
+        }
+
+        if (count < capacity) {
+            values[count] = value;
+        }
+
+        count++;
+
+        if (next == NULL) {
+            break;
+        }
+
+        pch = next + delim_length;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief Checks if the string starts with a prefix. Does not modify the string.
+ *
+ * @param string The string you want to check.
+ *
+ * @param prefix The substring you want to check if the string starts with.
+ *
+ * @return Returns \b 1 if the string starts with the prefix, returns \b 0 if it
+ * does not. If the function fails \b -1 is returned.
+ *
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "http://google.com";
+    int ret_val;
+
+    ret_val = pl_startswith(the_string, "http://");
+    if (ret_val) {
+        printf("the_string, does indeed start with http://\n");
+    }
+
+    ret_val = pl_startswith(the_string, "ftp://");
+    if (!ret_val) {
+        printf("And it does not start with ftp://\n");
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+the_string, does indeed start with http://
+And it does not start with ftp://
+\endcode
+ */
+int pl_startswith(char *string, char *prefix) {
+    if (string == NULL || prefix == NULL) {
+        return -1;
+    }
+
+    if (*string == '\0' || *prefix == '\0') {
+        return -1;
+    }
+
+    /*
+     * Compare in place, the terminator of string never equals a character of
+     * the prefix so a short string stops the loop on its own.
+     */
+    while (*prefix != '\0') {
+        if (*string != *prefix) {
+            return 0;
+        }
+
+        string++;
+        prefix++;
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_startswith, both strings are given as
+ * a pointer and a length.
+ *
+ * @param string The string you want to check.
+ *
+ * @param length The length of the string.
+ *
+ * @param prefix The substring you want to check if the string starts with.
+ *
+ * @param prefix_length The length of the prefix.
+ *
+ * @return Returns \b 1 if the string starts with the prefix, returns \b 0 if it
+ * does not. If the function fails \b -1 is returned.
+ */
+int pl_startswith_n(char *string, size_t length, char *prefix,
+                    size_t prefix_length) {
+    if (string == NULL || prefix == NULL || length == 0 || prefix_length == 0) {
+        return -1;
+    }
+
+    if (prefix_length > length) {
+        return 0;
+    }
+
+    return !memcmp(string, prefix, prefix_length);
+}
+
+
+/**
+ * @brief Checks if a strings ends with a postfix. The function does not alter
+ * the string.
+ *
+ * @param string The string you want to check if ends with the postfix.
+ *
+ * @param postfix The substring you want to check if the string ends with.
+ *
+ * @return The function returns \b 1 if the string ends with the postfix. If the
+ * string does not end with the postfix \b 0 is returned. If the function fails
+ * \b -1 is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "http://google.com";
+    int ret_val;
+
+    ret_val = pl_endswith(the_string, ".com");
+    if (ret_val) {
+            printf("the_string, does indeed end with .com\n");
+    }
+
+    ret_val = pl_endswith(the_string, ".net");
+    if (!ret_val) {
+            printf("And it does not end with .net\n");
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+the_string, does indeed end with .com
+And it does not end with .net
+\endcode
+ */
+int pl_endswith(char *string, char *postfix) {
+    if (string == NULL || postfix == NULL) {
+        return -1;
+    }
+
+    return pl_endswith_n(string, strlen(string), postfix, strlen(postfix));
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_endswith, both strings are given as a
+ * pointer and a length.
+ *
+ * @param string The string you want to check if ends with the postfix.
+ *
+ * @param length The length of the string.
+ *
+ * @param postfix The substring you want to check if the string ends with.
+ *
+ * @param postfix_length The length of the postfix.
+ *
+ * @return The function returns \b 1 if the string ends with the postfix. If the
+ * string does not end with the postfix \b 0 is returned. If the function fails
+ * \b -1 is returned.
+ */
+int pl_endswith_n(char *string, size_t length, char *postfix,
+                  size_t postfix_length) {
+    if (string == NULL || postfix == NULL || length == 0 || postfix_length == 0) {
+        return -1;
+    }
+
+    // A postfix longer than the string would compare before the buffer.
+    if (postfix_length > length) {
+        return 0;
+    }
+
+    return !memcmp(string + length - postfix_length, postfix, postfix_length);
+}
+
+
+/**
+ * @brief Checks if the string starts with any of the prefixes in an array,
+ * like passing a tuple to Python's startswith. The prefixes are tested in
+ * order, and no memory is allocated.
+ *
+ * @param string The string you want to check.
+ *
+ * @param prefixes Array of prefixes to test. Entries that are \b NULL or empty
+ * never match.
+ *
+ * @param count The number of prefixes in the array.
+ *
+ * @return Returns \b 1 if the string starts with one of the prefixes, \b 0 if
+ * it does not. If the function fails \b -1 is returned.
+ */
+int pl_startswith_any(char *string, char **prefixes, int count) {
+    if (string == NULL || prefixes == NULL || count <= 0 || *string == '\0') {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (prefixes[i] != NULL && pl_startswith(string, prefixes[i]) == 1) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Checks if the string ends with any of the postfixes in an array,
+ * like passing a tuple to Python's endswith. The string length is only
+ * computed once for all of the postfixes.
+ *
+ * @param string The string you want to check.
+ *
+ * @param postfixes Array of postfixes to test. Entries that are \b NULL or
+ * empty never match.
+ *
+ * @param count The number of postfixes in the array.
+ *
+ * @return Returns \b 1 if the string ends with one of the postfixes, \b 0 if
+ * it does not. If the function fails \b -1 is returned.
+ */
+int pl_endswith_any(char *string, char **postfixes, int count) {
+    if (string == NULL || postfixes == NULL || count <= 0 || *string == '\0') {
+        return -1;
+    }
+
+    size_t string_length = strlen(string);
+
+    for (int i = 0; i < count; i++) {
+        if (postfixes[i] == NULL) {
+            continue;
+        }
+
+        size_t postfix_length = strlen(postfixes[i]);
+
+        if (postfix_length == 0 || postfix_length > string_length) {
+            continue;
+        }
+
+        if (!memcmp(string + string_length - postfix_length, postfixes[i],
+                    postfix_length)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_startswith_any. The string is given as
+ * a pointer and a length, and the prefixes as an array of spans.
+ *
+ * @param string The string you want to check.
+ *
+ * @param length The length of the string.
+ *
+ * @param prefixes Array of prefixes to test. Entries that are \b NULL or empty
+ * never match.
+ *
+ * @param count The number of prefixes in the array.
+ *
+ * @return Returns \b 1 if the string starts with one of the prefixes, \b 0 if
+ * it does not. If the function fails \b -1 is returned.
+ */
+int pl_startswith_any_n(char *string, size_t length, pl_span *prefixes,
+                        size_t count) {
+    if (string == NULL || prefixes == NULL || count == 0 || length == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (prefixes[i].ptr == NULL || prefixes[i].length == 0 ||
+            prefixes[i].length > length) {
+            continue;
+        }
+
+        if (!memcmp(string, prefixes[i].ptr, prefixes[i].length)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_endswith_any. The string is given as a
+ * pointer and a length, and the postfixes as an array of spans.
+ *
+ * @param string The string you want to check.
+ *
+ * @param length The length of the string.
+ *
+ * @param postfixes Array of postfixes to test. Entries that are \b NULL or
+ * empty never match.
+ *
+ * @param count The number of postfixes in the array.
+ *
+ * @return Returns \b 1 if the string ends with one of the postfixes, \b 0 if
+ * it does not. If the function fails \b -1 is returned.
+ */
+int pl_endswith_any_n(char *string, size_t length, pl_span *postfixes,
+                      size_t count) {
+    if (string == NULL || postfixes == NULL || count == 0 || length == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t postfix_length = postfixes[i].length;
+
+        if (postfixes[i].ptr == NULL || postfix_length == 0 ||
+            postfix_length > length) {
+            continue;
+        }
+
+        if (!memcmp(string + length - postfix_length, postfixes[i].ptr,
+                    postfix_length)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief A node in the affix trie. The children of a node are kept in a
+ * linked list through the sibling index, the first level is found through the
+ * dense root table of the set instead.
+ */
+struct affix_node {
+    int child;
+    int sibling;
+    int match;
+    unsigned char byte;
+};
+
+
+struct pl_affixset {
+    int mode;
+    int root[256];
+    struct affix_node *nodes;
+    int node_count;
+    int node_capacity;
+};
+
+
+/**
+ * @brief Appends a new node to the trie and returns its index, or \b -1 if
+ * the node array could not be grown.
+ */
+static int affix_new_node(pl_affixset *set, unsigned char byte, int sibling) {
+    if (set->node_count == set->node_capacity) {
+        int capacity = set->node_capacity ? set->node_capacity * 2 : 64;
+        struct affix_node *tmp = (struct affix_node *) realloc(set->nodes,
+                capacity * sizeof(struct affix_node));
+        if (tmp == NULL) {
+            return -1;
+        }
+
+        set->nodes = tmp;
+        set->node_capacity = capacity;
+    }
+
+    struct affix_node *node = &set->nodes[set->node_count];
+    node->child = -1;
+    node->sibling = sibling;
+    node->match = -1;
+    node->byte = byte;
+
+    return set->node_count++;
+}
+
+
+/**
+ * @brief Finds the child of a node for a byte, \b -1 if there is none.
+ */
+static int affix_find_child(pl_affixset *set, int node, unsigned char byte) {
+    int child = set->nodes[node].child;
+
+    while (child != -1 && set->nodes[child].byte != byte) {
+        child = set->nodes[child].sibling;
+    }
+
+    return child;
+}
+
+
+/**
+ * @brief Inserts a single affix into the trie, suffixes are inserted with the
+ * last character first so they can be matched from the end of a string.
+ */
+static int affix_insert(pl_affixset *set, char *affix, int index) {
+    int length = strlen(affix);
+    int step = 1, pos = 0;
+
+    if (set->mode == PL_SUFFIX) {
+        step = -1;
+        pos = length - 1;
+    }
+
+    unsigned char byte = (unsigned char) affix[pos];
+    int node = set->root[byte];
+    if (node == -1) {
+        node = affix_new_node(set, byte, -1);
+        if (node == -1) {
+            return -1;
+        }
+
+        set->root[byte] = node;
+    }
+
+    for (int i = 1; i < length; i++) {
+        pos += step;
+        byte = (unsigned char) affix[pos];
+
+        int child = affix_find_child(set, node, byte);
+        if (child == -1) {
+            child = affix_new_node(set, byte, set->nodes[node].child);
+            if (child == -1) {
+                return -1;
+            }
+
+            set->nodes[node].child = child;
+        }
+
+        node = child;
+    }
+
+    // Duplicates keep the first index they were given.
+    if (set->nodes[node].match == -1) {
+        set->nodes[node].match = index;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Compiles a set of prefixes or suffixes into a trie, so a string can
+ * be tested against all of them in a single pass with
+ * \ref pl_affixset_match instead of calling \ref pl_startswith or
+ * \ref pl_endswith once for every affix.
+ *
+ * The first byte of a string is looked up in a dense table, and the rest of
+ * the affix is followed through the trie, so the cost of a match depends on
+ * the length of the longest matching affix and not on the number of affixes.
+ *
+ * You need to free the returned set with \ref pl_affixset_free after use.
+ *
+ * @param affixes Array of prefixes or suffixes. None of them can be \b NULL or
+ * empty.
+ *
+ * @param count The number of affixes in the array.
+ *
+ * @param mode \b PL_PREFIX to match the start of strings, or \b PL_SUFFIX to
+ * match the end of strings.
+ *
+ * @return Returns a pointer to the compiled set. If the function fails \b NULL
+ * is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char *extensions[] = {".c", ".h", ".tar.gz", ".gz"};
+    char *files[] = {"plstr.c", "release.tar.gz", "notes.txt"};
+    pl_affixset *set;
+
+    set = pl_affixset_new(extensions, 4, PL_SUFFIX);
+    if (set == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        int idx = pl_affixset_match(set, files[i]);
+
+        if (idx >= 0) {
+            printf("%s: %s\n", files[i], extensions[idx]);
+        }
+
+        else {
+            printf("%s: no match\n", files[i]);
+        }
+    }
+
+    pl_affixset_free(set);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+plstr.c: .c
+release.tar.gz: .tar.gz
+notes.txt: no match
+\endcode
+ */
+pl_affixset *pl_affixset_new(char **affixes, int count, int mode) {
+    pl_affixset *set = NULL;
+
+    if (affixes == NULL || count <= 0 ||
+        (mode != PL_PREFIX && mode != PL_SUFFIX)) {
+        goto error_exit;
+    }
+
+    set = (pl_affixset *) calloc(1, sizeof(pl_affixset));
+    if (set == NULL) {
+        goto error_exit;
+    }
+
+    set->mode = mode;
+    for (int i = 0; i < 256; i++) {
+        set->root[i] = -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (affixes[i] == NULL || affixes[i][0] == '\0') {
+            goto error_exit;
+        }
+
+        if (affix_insert(set, affixes[i], i) == -1) {
+            goto error_exit;
+        }
+    }
+
+    return set;
+
+error_exit:
+    pl_affixset_free(set);
+
+    return NULL;
+}
+
+
+/**
+ * @brief Matches a string against a compiled affix set. When several affixes
+ * match, the longest one wins, so \a ".tar.gz" is preferred over \a ".gz".
+ * No memory is allocated.
+ *
+ * @param set The set created with \ref pl_affixset_new.
+ *
+ * @param string The string you want to check.
+ *
+ * @return Returns the index in the original array of the longest matching
+ * affix. If none of the affixes match \b -1 is returned, and if the function
+ * fails \b -2 is returned.
+ */
+int pl_affixset_match(pl_affixset *set, char *string) {
+    if (set == NULL || string == NULL) {
+        return -2;
+    }
+
+    if (*string == '\0') {
+        return -1;
+    }
+
+    int best = -1;
+
+    if (set->mode == PL_PREFIX) {
+        int node = set->root[(unsigned char) string[0]];
+
+        for (int i = 1; node != -1; i++) {
+            if (set->nodes[node].match != -1) {
+                best = set->nodes[node].match;
+            }
+
+            if (string[i] == '\0') {
+                break;
+            }
+
+            node = affix_find_child(set, node, (unsigned char) string[i]);
+        }
+
+        return best;
+    }
+
+    int i = strlen(string) - 1;
+    int node = set->root[(unsigned char) string[i]];
+
+    while (node != -1) {
+        if (set->nodes[node].match != -1) {
+            best = set->nodes[node].match;
+        }
+
+        if (i == 0) {
+            break;
+        }
+
+        i--;
+        node = affix_find_child(set, node, (unsigned char) string[i]);
+    }
+
+    return best;
+}
+
+
+/**
+ * @brief Frees an affix set created with \ref pl_affixset_new. Passing \b NULL
+ * is allowed.
+ */
+void pl_affixset_free(pl_affixset *set) {
+    if (set == NULL) {
+        return;
+    }
+
+    free(set->nodes);
+    free(set);
+}
+
+
+/**
+ * @brief The whitespace characters pl_strip removes by default.
+ */
+static unsigned char strip_whitespace[256] = {
+    ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1, [' '] = 1
+};
+
+#define STRIP_SCALAR    32
+
+
+/**
+ * @brief This function handles the logic for the pl_strip functions. It finds
+ * the part of the string that is left after stripping, as the offset of the
+ * first kept character and one past the last kept character. If every
+ * character is stripped both are set to the same offset. If \a chars is empty
+ * whitespace is stripped.
+ *
+ * Each end is checked a byte at a time first. Only when an end has more than
+ * STRIP_SCALAR bytes to strip, like padded fixed width records, the rest of
+ * it is left to the vector kernel.
+ */
+static void strip_bounds(char *string, size_t length, char *chars,
+                         size_t chars_length, size_t *begin, size_t *end) {
+    unsigned char local_map[256], *map = strip_whitespace;
+    size_t offset, limit, window;
+
+    if (chars_length > 0) {
+        memset(local_map, 0, sizeof(local_map));
+        for (size_t i = 0; i < chars_length; i++) {
+            local_map[(unsigned char) chars[i]] = 1;
+        }
+
+        map = local_map;
+    }
+
+    offset = strip_run_scalar(string, length < STRIP_SCALAR ? length : STRIP_SCALAR,
+                              map, 0);
+    if (offset == STRIP_SCALAR) {
+        offset += strip_run_kernel(string + offset, length - offset, map, 0);
+    }
+
+    window = length - offset < STRIP_SCALAR ? length - offset : STRIP_SCALAR;
+
+    limit = length - strip_run_scalar(string + length - window, window, map, 1);
+    if (length - limit == STRIP_SCALAR) {
+        limit -= strip_run_kernel(string + offset, limit - offset, map, 1);
+    }
+
+    *begin = offset;
+    *end = limit;
+}
+
+
+/**
+ * @brief This function strips characters from a string. The default behaviour
+ * if chars is \b NULL or empty string is to strip whitespace characters from
+ * either end of the string. The characters removed is '\\n \\r \\t \\v \\f' and
+ * the space character. If the chars parameter contains characters those
+ * characters are removed from either side of the string.
+ *
+ * You need to free the returned buffer after use.
+ *
+ * @param string The string you want to split.
+ *
+ * @param chars The characters you want to strip from the string. If the
+ * parameter is empty or \b NULL whitespace is removed from either side.
+ *
+ * @return The function returns a pointer to the string with the characters
+ * removed. If the function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char whitespace[] = "   lots of space   ";
+    char cool_nick[] = "xxxxTheDude99xxxx";
+    char *ret_val = NULL;
+
+    ret_val = pl_strip(whitespace, NULL);
+    if (ret_val != NULL) {
+        printf("Original: %s\nStriped: %s\n", whitespace, ret_val);
+        free(ret_val);
+    }
+
+    ret_val = pl_strip(cool_nick, "x");
+    if (ret_val != NULL) {
+        printf("Striped: %s\n", ret_val);
+        free(ret_val);
+    }
+
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+Original:    lots of space
+Striped: lots of space
+Striped: TheDude99
+\endcode
+ */
+char *pl_strip(char *string, char *chars) {
+    if (string == NULL) {
+        return NULL;
+    }
+
+    return pl_strip_n(string, strlen(string), chars,
+                      chars == NULL ? 0 : strlen(chars), NULL);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_strip, the string and the characters
+ * to strip are given as a pointer and a length, so NUL can be stripped too.
+ *
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param string The string you want to strip.
+ *
+ * @param length The length of the string.
+ *
+ * @param chars The characters you want to strip from the string. If the
+ * length is \b 0 whitespace is removed from either side.
+ *
+ * @param chars_length The number of characters in \a chars.
+ *
+ * @param out_length Optional, set to the length of the returned string.
+ *
+ * @return The function returns a pointer to the string with the characters
+ * removed. If the function fails \b NULL is returned.
+ */
+char *pl_strip_n(char *string, size_t length, char *chars,
+                 size_t chars_length, size_t *out_length) {
+    if (string == NULL || length == 0 || (chars == NULL && chars_length != 0)) {
+        return NULL;
+    }
+
+    size_t begin, end;
+    strip_bounds(string, length, chars, chars_length, &begin, &end);
+
+    char *ret_val = (char *) malloc(end - begin + 1);
+    if (ret_val == NULL) {
+        return NULL;
+    }
+
+    memcpy(ret_val, string + begin, end - begin);
+    ret_val[end - begin] = '\0';
+
+    if (out_length != NULL) {
+        *out_length = end - begin;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Strips a string like \ref pl_strip_n, but returns the stripped part
+ * as a view into the string, so nothing is allocated or copied.
+ *
+ * @param string The string you want to strip.
+ *
+ * @param length The length of the string.
+ *
+ * @param chars The characters you want to strip, if \a chars_length is \b 0
+ * whitespace is stripped.
+ *
+ * @param chars_length The number of characters in \a chars.
+ *
+ * @param view Set to the part of the string that is left.
+ *
+ * @return Returns \b 0 if the string was stripped. If the function fails
+ * \b -1 is returned.
+ */
+int pl_strip_view(char *string, size_t length, char *chars,
+                  size_t chars_length, pl_span *view) {
+    if (string == NULL || view == NULL || (chars == NULL && chars_length != 0)) {
+        return -1;
+    }
+
+    size_t begin, end;
+    strip_bounds(string, length, chars, chars_length, &begin, &end);
+
+    view->ptr = string + begin;
+    view->length = end - begin;
+
+    return 0;
+}
+
+
+/**
+ * @brief This function handels the cases for pl_translate where there is no
+ * table. It should not be called directly, call pl_translate with the table
+ * parameter set as NULL instead. The output is written in one pass into
+ * \a out, which has room for the input and a NUL terminator, and its length
+ * is returned.
+ */
+static size_t translate_no_table(char *out, char *string, size_t string_length,
+                                 unsigned char *delete) {
+    size_t out_length;
+
+    if (string_length < 64) {
+        out_length = delete_scalar(out, string, string_length, delete);
+    }
+
+    else {
+        out_length = delete_kernel(out, string, string_length, delete);
+    }
+
+    out[out_length] = '\0';
+
+    return out_length;
+}
+
+
+/**
+ * @brief This function handels the logic for the pl_translate function in the
+ * cases where the table parameter is not empty. Do not call this function
+ * directly, call pl_translate instead.
+ */
+static size_t translate_with_table(char *out, char *string,
+                                   size_t string_length,
+                                   unsigned char *swap_table) {
+    // Short strings are not worth looking at the map for the vector kernels.
+    if (string_length < 64) {
+        translate_scalar(out, string, string_length, swap_table);
+    }
+
+    else {
+        translate_kernel(out, string, string_length, swap_table);
+    }
+
+    out[string_length] = '\0';
+
+    return string_length;
+}
+
+
+/**
+ * @brief Builds the 256 byte map used by translate. Without a table it flags
+ * the bytes to delete, with a table it maps every byte to its replacement.
+ */
+static void compile_translate(unsigned char *map, unsigned char *table,
+                              char *deletechars, size_t chars_length) {
+    for (int i = 0; i < 256; i++) {
+        map[i] = table == NULL ? 0 : i;
+    }
+
+    for (size_t i = 0; i < chars_length; i++) {
+        if (table == NULL) {
+            map[(unsigned char) deletechars[i]] = 1;
+        }
+
+        else {
+            map[table[i]] = deletechars[i];
+        }
+    }
+}
+
+
+/**
+ * @brief This function implements the behaviour of python string translate
+ * method. This function has two different behaviours. It either deletes
+ * characters from the string, or switches out the characters with the ones
+ * set in the table.
+ *
+ * If the table parameter, is \b NULL the characters passed in the deletechars
+ * parameter are removed from the string. If you pass it the string
+ * <a> 'read this short text'</a>, and deletechars is \a 'aeiou', the returned
+ * string is <a>'rd ths shrt txt'</a>.
+ *
+ * If the table parameter is not empty, every occurrence of one of the table
+ * characters is replaced with the character in deletechars at the same index.
+ * So if the same string is passed <a>'read this short text'</a>, and the table
+ * is \a 'xxxxx', and deletechars is \a 'aeiou' the returned string is
+ * <a>'rxxd thxs shxrt txxt'</a>. The length of the table and deletechars needs
+ * to be of the same length, or else the function will return \b NULL.
+ *
+ * You need to free the returned buffer after use.
+ *
+ * @param string The string you want to translate.
+ *
+ * @param table Optional parameter, if set it is used to swap the characters
+ * passed in the deletechars parameter. If not every occurrence of the characters
+ * passed in deletechars is removed from the string.
+ *
+ * @param deletechars The characters in the parameter is removed or swapped out
+ * from the string. If the table parameter is used this parameter and table
+ * needs to be of equal size.
+ *
+ * @return Returns a pointer to the new string with the deleted/swapped out
+ * characters. If the function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+int main() {
+    char the_string[] = "read this short text";
+    char *ret_val = NULL;
+
+    ret_val = pl_translate(the_string, NULL, "aeiou");
+    if (ret_val != NULL) {
+        printf("the_string: %s\nno table:%s\n", the_string, ret_val);
+        free(ret_val);
+    }
+
+    ret_val = pl_translate(the_string, "aeiou", "xxxxx");
+    if (ret_val != NULL) {
+        printf("with table: %s\n", ret_val);
+        free(ret_val);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+the_string: read this short text
+no table:rd ths shrt txt
+with table: rxxd thxs shxrt txxt
+\endcode
+ */
+char *pl_translate(char *string, unsigned char *table, char *deletechars) {
+    if (string == NULL || deletechars == NULL) {
+        return NULL;
+    }
+
+    size_t deletechars_length = strlen(deletechars);
+
+    // The table and the characters have to be of the same length.
+    if (table != NULL && strlen((char *) table) != deletechars_length) {
+        return NULL;
+    }
+
+    return pl_translate_n(string, strlen(string), table, deletechars,
+                          deletechars_length, NULL);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_translate. The string is given as a
+ * pointer and a length, and \a table and \a deletechars are both
+ * \a chars_length bytes long, so NUL can be deleted or swapped too.
+ *
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param string The string you want to translate.
+ *
+ * @param length The length of the string.
+ *
+ * @param table Optional, if set the characters in it are swapped with the
+ * character in \a deletechars at the same index.
+ *
+ * @param deletechars The characters that are removed or swapped in.
+ *
+ * @param chars_length The length of \a deletechars, and of \a table if it is
+ * set.
+ *
+ * @param out_length Optional, set to the length of the returned string.
+ *
+ * @return Returns a pointer to the new string with the deleted/swapped out
+ * characters. If the function fails \b NULL is returned.
+ */
+char *pl_translate_n(char *string, size_t length, unsigned char *table,
+                     char *deletechars, size_t chars_length,
+                     size_t *out_length) {
+    if (string == NULL || deletechars == NULL || length == 0 ||
+        chars_length == 0) {
+        return NULL;
+    }
+
+    char *ret_val = (char *) malloc(length + 1);
+    if (ret_val == NULL) {
+        return NULL;
+    }
+
+    ptrdiff_t ret_length = pl_translate_into(string, length, table, deletechars,
+                                             chars_length, ret_val);
+
+    if (out_length != NULL) {
+        *out_length = ret_length;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Version of \ref pl_translate_n that writes into a buffer of the
+ * caller, so translating many strings does not allocate. The result is never
+ * longer than the input, so a buffer of \a length + 1 bytes is always big
+ * enough.
+ *
+ * @param string The string you want to translate.
+ *
+ * @param length The length of the string.
+ *
+ * @param table Optional, if set the characters in it are swapped with the
+ * character in \a deletechars at the same index.
+ *
+ * @param deletechars The characters that are removed or swapped in.
+ *
+ * @param chars_length The length of \a deletechars, and of \a table if it is
+ * set.
+ *
+ * @param out The buffer the NUL terminated result is written to, it can not
+ * overlap the string.
+ *
+ * @return Returns the length of the result. If the function fails \b -1 is
+ * returned.
+ */
+ptrdiff_t pl_translate_into(char *string, size_t length, unsigned char *table,
+                            char *deletechars, size_t chars_length,
+                            char *out) {
+    unsigned char local_map[256], *map = local_map;
+    int fresh = 1;
+
+    if (string == NULL || deletechars == NULL || out == NULL ||
+        chars_length == 0) {
+        return -1;
+    }
+
+    struct pattern_entry *entry = cache_get(
+            table == NULL ? PATTERN_DELETE : PATTERN_SWAP, deletechars,
+            chars_length, (char *) table, table == NULL ? 0 : chars_length,
+            &fresh);
+    if (entry != NULL) {
+        map = entry->u.map;
+    }
+
+    if (fresh) {
+        compile_translate(map, table, deletechars, chars_length);
+    }
+
+    if (table == NULL) {
+        return translate_no_table(out, string, length, map);
+    }
+
+    return translate_with_table(out, string, length, map);
+}
+
+
+/**
+ * @brief This function splits up a string when a newline character is found.
+ *
+ * The function is very similar to the split function but the results are a bit
+ * different. It splits up a string whenever it finds the \a \\n or \a \\r character.
+ * If the keepends parameter is set the function will not remove the newline
+ * from the string.
+ *
+ * If the string <a>"first\nsecond\n\nfourth"</a> is passed the results will be:
+ * <a>["first", "second", "", "fourth"] </a>. If the keepends parameter is set
+ * the results of the same string would be:
+ * <a>["first\n", "second\n", "\n", "fourth\n"]</a>
+ *
+ * This function allocates memory, the returned pointer should be freed after
+ * use.
+ *
+ * @param the_string The string you want to split.
+ *
+ * @param keepends If set to \a 1 the newlines will be appended, if not the
+ * will be removed.
+ *
+ * @param size This parameter will be changed to the size of the returned
+ * string array.
+ *
+ * @return The function will return a array of strings if successful, if the
+ * function fails \b NULL will be returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char **ret_val = NULL;
+    int size = 0;
+
+    ret_val = pl_splitlines("first\nsecond\n\nfourth", 0, &size);
+    if (ret_val != NULL) {
+        int i;
+
+        for (i = 0; i < size; i++) {
+            printf("%d: %s ", i, ret_val[i]);
+            free(ret_val[i]);
+        }
+
+        free(ret_val);
+        printf("\n\n");
+    }
+
+    ret_val = pl_splitlines("first\nsecond\n\nfourth", 1, &size);
+    if (ret_val != NULL ) {
+        int i;
+
+        for (i = 0; i < size; i++) {
+            printf("%d: %s\n", i, ret_val[i]);
+            free(ret_val[i]);
+        }
+
+        printf("\n");
+        free(ret_val);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+0: first 1: second 2:  3: fourth
+
+0: first
+
+1: second
+
+2:
+
+3: fourth
+
+\endcode
+ */
+char **pl_splitlines(char *the_string, int keepends, int *size) {
+    if (the_string == NULL || size == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    char **ret_val = pl_splitlines_n(the_string, strlen(the_string), keepends,
+                                     &count, NULL);
+
+    if (ret_val != NULL) {
+        *size = (int) count;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_splitlines, the string is given as a
+ * pointer and a length, and the length of every line can be returned too.
+ *
+ * You need to free every element of the returned array, the array itself and
+ * the lengths array if it was requested.
+ *
+ * @param the_string The string you want to split.
+ *
+ * @param length The length of the string.
+ *
+ * @param keepends If set to \a 1 the newlines will be appended, if not the
+ * will be removed.
+ *
+ * @param size This parameter will be changed to the size of the returned
+ * string array.
+ *
+ * @param lengths Optional, if not \b NULL it is set to an allocated array with
+ * the length of every line.
+ *
+ * @return The function will return a array of strings if successful, if the
+ * function fails \b NULL will be returned.
+ */
+char **pl_splitlines_n(char *the_string, size_t length, int keepends,
+                       size_t *size, size_t **lengths) {
+    char **ret_val = NULL;
+    size_t *tmp_lengths = NULL;
+    char *pch = the_string;
+    size_t idx = 0;
+
+    if (the_string == NULL || length == 0 || size == NULL) {
+        return NULL;
+    }
+
+    // Count the number of lines.
+    size_t delims = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (the_string[i] == '\n' || the_string[i] == '\r') {
+            delims++;
+        }
+    }
+
+    // Nothing todo.
+    if (delims == 0) {
+        return NULL;
+    }
+
+    ret_val = (char **) calloc(delims + 1, sizeof(char *));
+    if (ret_val == NULL) {
+        return NULL;
+    }
+
+    if (lengths != NULL) {
+        tmp_lengths = (size_t *) calloc(delims + 1, sizeof(size_t));
+        if (tmp_lengths == NULL) {
+            goto error_exit;
+        }
+    }
+
+    for (size_t i = 0; i <= length; i++) {
+        if (i < length && the_string[i] != '\n' && the_string[i] != '\r') {
+            continue;
+        }
+
+        size_t len = (the_string + i) - pch;
+
+        if (keepends && i < length) {
+            len++;
+        }
+
+        char *tmp = (char *) malloc(len + 1);
+        if (tmp == NULL) {
+            goto error_exit;
+        }
+
+        memcpy(tmp, pch, len);
+        tmp[len] = '\0';
+
+        if (tmp_lengths != NULL) {
+            tmp_lengths[idx] = len;
+        }
+
+        pch = the_string + i + 1;
+        ret_val[idx] = tmp;
+        idx++;
+    }
+
+    if (lengths != NULL) {
+        *lengths = tmp_lengths;
+    }
+
+    *size = delims + 1;
+
+    return ret_val;
+
+error_exit:
+    for (size_t i = 0; i < idx; i++) {
+        free(ret_val[i]);
+    }
+
+    free(ret_val);
+    free(tmp_lengths);
+
+    return NULL;
+}
+
+
+/**
+ * @brief Counts the number of occurences of a word in a string. The word can
+ * does not need to be a word in the english langauge sense, just any form of
+ * sub string can be counted.
+ *
+ * @param the_string The string you wnat to search.
+ *
+ * @param word The sub string you want to search the string for.
+ *
+ * @return Returns the number of occurences of the sub string. If the function
+ * fails \b -1 is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    int ret_val = 0;
+
+    ret_val = pl_count("one three three seven", "three");
+    if (ret_val != -1) {
+        printf("The word 'three' was found %d times.\n", ret_val);
+    }
+
+    ret_val = pl_count("What do you get if you multiply six by nine?", "42");
+    if (ret_val == 0) {
+        printf("Apparantly not 42. I always knew something was wrong with the universe.\n");
+    }
+
+    return 0;
+}
+\endcode
+ * \b Output
+\code{.unparsed}
+The word 'three' was found 2 times.
+Apparantly not 42. I always knew something was wrong with the universe.
+\endcode
+ */
+int pl_count(char * the_string, char *word) {
+    if (the_string == NULL || word == NULL) {
+        return -1;
+    }
+
+    return (int) pl_count_n(the_string, strlen(the_string), word, strlen(word));
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_count, the string and the word are
+ * given as a pointer and a length.
+ *
+ * @param the_string The string you wnat to search.
+ *
+ * @param length The length of the string.
+ *
+ * @param word The sub string you want to search the string for.
+ *
+ * @param word_length The length of the sub string.
+ *
+ * @return Returns the number of occurences of the sub string. If the function
+ * fails \b -1 is returned.
+ */
+ptrdiff_t pl_count_n(char *the_string, size_t length, char *word,
+                     size_t word_length) {
+    if (the_string == NULL || word == NULL || length == 0 || word_length == 0) {
+        return -1;
+    }
+
+    char *pch = the_string, *end = the_string + length;
+    size_t *skip = cached_skip(word, word_length);
+    ptrdiff_t count = 0;
+
+    while ((pch = find_pattern(pch, end - pch, word, word_length, skip)) != NULL) {
+        pch += word_length;
+        count++;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief Resolves Python style start and end arguments against the length of
+ * a string. Negative values count from the end of the string, and both values
+ * are clamped to the string.
+ */
+static void adjust_indices(ptrdiff_t *start, ptrdiff_t *end, ptrdiff_t length) {
+    if (*end > length) {
+        *end = length;
+    }
+
+    else if (*end < 0) {
+        *end += length;
+        if (*end < 0) {
+            *end = 0;
+        }
+    }
+
+    if (*start < 0) {
+        *start += length;
+        if (*start < 0) {
+            *start = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Shared implementation of the find family. Searches for the sub
+ * string inside string[start:end], either from the left or from the right.
+ * Returns the offset, \b -1 if not found or \b -2 if the arguments are bad.
+ */
+static ptrdiff_t find_in_range(char *string, size_t length, char *sub,
+                               size_t sub_length, ptrdiff_t start,
+                               ptrdiff_t end, int reverse) {
+    if (string == NULL || sub == NULL) {
+        return -2;
+    }
+
+    adjust_indices(&start, &end, length);
+
+    if (start > (ptrdiff_t) length || end < start ||
+        (size_t) (end - start) < sub_length) {
+        return -1;
+    }
+
+    char *pch;
+    if (reverse) {
+        pch = rfind_kernel(string + start, end - start, sub, sub_length);
+    }
+
+    else {
+        pch = find_kernel(string + start, end - start, sub, sub_length);
+    }
+
+    if (pch == NULL) {
+        return -1;
+    }
+
+    return pch - string;
+}
+
+
+/**
+ * @brief Calls find_in_range for two NUL terminated strings.
+ */
+static ptrdiff_t find_in_string(char *string, char *sub, ptrdiff_t start,
+                                ptrdiff_t end, int reverse) {
+    if (string == NULL || sub == NULL) {
+        return -2;
+    }
+
+    return find_in_range(string, strlen(string), sub, strlen(sub), start, end,
+                         reverse);
+}
+
+
+/**
+ * @brief Returns the lowest offset in the string where the sub string is
+ * found, within the slice string[start:end]. This works like Python's find,
+ * negative \a start and \a end values count from the end of the string, and
+ * values outside of the string are clamped. Pass \b PL_END as \a end to search
+ * to the end of the string. An empty sub string is found at \a start.
+ *
+ * The search does not allocate memory. The candidate positions are found by
+ * comparing the first and the last byte of the sub string against a whole
+ * block of the string at once with SSE2 or AVX2 when the CPU supports it.
+ *
+ * @param string The string you want to search.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @param start The offset where the search starts.
+ *
+ * @param end The offset where the search ends.
+ *
+ * @return Returns the offset of the sub string from the start of the string.
+ * If the sub string is not found, or if the function fails \b -1 is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char the_string[] = "spam, eggs, and ham";
+
+    printf("find: %d\n", pl_find(the_string, "am", 0, PL_END));
+    printf("find from 4: %d\n", pl_find(the_string, "am", 4, PL_END));
+    printf("rfind: %d\n", pl_rfind(the_string, ", ", 0, PL_END));
+    printf("rfind in [0:-9]: %d\n", pl_rfind(the_string, ", ", 0, -9));
+    printf("contains: %d\n", pl_contains(the_string, "eggs"));
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+find: 2
+find from 4: 17
+rfind: 10
+rfind in [0:-9]: 4
+contains: 1
+\endcode
+ */
+int pl_find(char *string, char *sub, int start, int end) {
+    ptrdiff_t ret_val = find_in_string(string, sub, start, end, 0);
+
+    return ret_val < 0 ? -1 : (int) ret_val;
+}
+
+
+/**
+ * @brief Returns the highest offset in the string where the sub string is
+ * found, within the slice string[start:end]. The arguments work the same way
+ * as for \ref pl_find, but the string is searched from the end.
+ *
+ * @param string The string you want to search.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @param start The offset where the search stops.
+ *
+ * @param end The offset where the search starts, searching backwards.
+ *
+ * @return Returns the offset of the last occurence of the sub string. If the
+ * sub string is not found, or if the function fails \b -1 is returned.
+ */
+int pl_rfind(char *string, char *sub, int start, int end) {
+    ptrdiff_t ret_val = find_in_string(string, sub, start, end, 1);
+
+    return ret_val < 0 ? -1 : (int) ret_val;
+}
+
+
+/**
+ * @brief Like \ref pl_find, but a failure is reported differently from a sub
+ * string that is not found. Python raises an exception in this case, the C
+ * version returns \b -1.
+ *
+ * @param string The string you want to search.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @param start The offset where the search starts.
+ *
+ * @param end The offset where the search ends.
+ *
+ * @return Returns the offset of the sub string. If the sub string is not found
+ * \b -1 is returned, and if the function fails \b -2 is returned.
+ */
+int pl_index(char *string, char *sub, int start, int end) {
+    return (int) find_in_string(string, sub, start, end, 0);
+}
+
+
+/**
+ * @brief Like \ref pl_rfind, but a failure is reported differently from a
+ * sub string that is not found.
+ *
+ * @param string The string you want to search.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @param start The offset where the search stops.
+ *
+ * @param end The offset where the search starts, searching backwards.
+ *
+ * @return Returns the offset of the last occurence of the sub string. If the
+ * sub string is not found \b -1 is returned, and if the function fails \b -2
+ * is returned.
+ */
+int pl_rindex(char *string, char *sub, int start, int end) {
+    return (int) find_in_string(string, sub, start, end, 1);
+}
+
+
+/**
+ * @brief Checks if the sub string is found anywhere in the string, like
+ * Python's \a in operator. An empty sub string is always found.
+ *
+ * @param string The string you want to search.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @return Returns \b 1 if the sub string is found, and \b 0 if it is not. If
+ * the function fails \b -1 is returned.
+ */
+int pl_contains(char *string, char *sub) {
+    ptrdiff_t ret_val = find_in_string(string, sub, 0, PL_END, 0);
+
+    if (ret_val == -2) {
+        return -1;
+    }
+
+    return ret_val >= 0;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_find. The strings are given as a
+ * pointer and a length, and the offsets are not limited to the range of an
+ * int.
+ *
+ * @param string The string you want to search.
+ *
+ * @param length The length of the string.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @param sub_length The length of the sub string.
+ *
+ * @param start The offset where the search starts.
+ *
+ * @param end The offset where the search ends, \b PL_END_N searches to the end
+ * of the string.
+ *
+ * @return Returns the offset of the sub string from the start of the string.
+ * If the sub string is not found, or if the function fails \b -1 is returned.
+ */
+ptrdiff_t pl_find_n(char *string, size_t length, char *sub, size_t sub_length,
+                    ptrdiff_t start, ptrdiff_t end) {
+    ptrdiff_t ret_val = find_in_range(string, length, sub, sub_length, start,
+                                      end, 0);
+
+    return ret_val < 0 ? -1 : ret_val;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_rfind, the arguments are the same as
+ * for \ref pl_find_n.
+ *
+ * @return Returns the offset of the last occurence of the sub string. If the
+ * sub string is not found, or if the function fails \b -1 is returned.
+ */
+ptrdiff_t pl_rfind_n(char *string, size_t length, char *sub,
+                     size_t sub_length, ptrdiff_t start, ptrdiff_t end) {
+    ptrdiff_t ret_val = find_in_range(string, length, sub, sub_length, start,
+                                      end, 1);
+
+    return ret_val < 0 ? -1 : ret_val;
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_index, the arguments are the same as
+ * for \ref pl_find_n.
+ *
+ * @return Returns the offset of the sub string. If the sub string is not found
+ * \b -1 is returned, and if the function fails \b -2 is returned.
+ */
+ptrdiff_t pl_index_n(char *string, size_t length, char *sub,
+                     size_t sub_length, ptrdiff_t start, ptrdiff_t end) {
+    return find_in_range(string, length, sub, sub_length, start, end, 0);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_rindex, the arguments are the same as
+ * for \ref pl_find_n.
+ *
+ * @return Returns the offset of the last occurence of the sub string. If the
+ * sub string is not found \b -1 is returned, and if the function fails \b -2
+ * is returned.
+ */
+ptrdiff_t pl_rindex_n(char *string, size_t length, char *sub,
+                      size_t sub_length, ptrdiff_t start, ptrdiff_t end) {
+    return find_in_range(string, length, sub, sub_length, start, end, 1);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_contains.
+ *
+ * @param string The string you want to search.
+ *
+ * @param length The length of the string.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @param sub_length The length of the sub string.
+ *
+ * @return Returns \b 1 if the sub string is found, and \b 0 if it is not. If
+ * the function fails \b -1 is returned.
+ */
+int pl_contains_n(char *string, size_t length, char *sub, size_t sub_length) {
+    ptrdiff_t ret_val = find_in_range(string, length, sub, sub_length, 0,
+                                      PL_END_N, 0);
+
+    if (ret_val == -2) {
+        return -1;
+    }
+
+    return ret_val >= 0;
+}
+
+
+static size_t next_column(size_t position, int tabsize) {
+    if (tabsize == 0) {
+        return 0;
+    }
+
+    return tabsize - (position % tabsize);
+}
+
+
+/**
+ * @brief This function replaces tabs with spaces.
+ *
+ * The tabs are replaced with spaces ' ' up to the next column. The column width
+ * is specified by the \a tabsize parameter, and the number of spaces inserted 
+ * for each tab is the number of spaces needed to reach the next multiple of 
+ * tabsize. The returned string is allocated on the heap, remember to free this
+ * resource after use. NULL is returned in the follwoing cases: The passed string
+ * points to NULL. \a tabsize has a negative value. Or the string has a length of
+ * zero.
+ *
+ * @param the_string The string with tabs.
+ *
+ * @param tabsize The width of the column.
+ *
+ * @return The function returns a heap allocated buffer of the string with tabs
+ * replaced. If the function fails \b NULL is returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char *ret_val;
+
+    ret_val = pl_expandtabs("tabs\tinstead\tof\tspace", 1);
+    if (ret_val != NULL) {
+        printf("tabs\tinstead\tof\tspace\n%s\n", ret_val);
+    }
+
+    free(ret_val);
+
+    return 0;
+}
+
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+tabs    instead of      space
+tabs instead of space
+\endcode
+ */
+char *pl_expandtabs(char *the_string, int tabsize) {
+    if (the_string == NULL) {
+        return NULL;
+    }
+
+    return pl_expandtabs_n(the_string, strlen(the_string), tabsize, NULL);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_expandtabs, the string is given as a
+ * pointer and a length.
+ *
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param the_string The string with tabs.
+ *
+ * @param length The length of the string.
+ *
+ * @param tabsize The width of the column.
+ *
+ * @param out_length Optional, set to the length of the returned string.
+ *
+ * @return The function returns a heap allocated buffer of the string with tabs
+ * replaced. If the function fails \b NULL is returned.
+ */
+char *pl_expandtabs_n(char *the_string, size_t length, int tabsize,
+                      size_t *out_length) {
+    char *ret_val = NULL;
+
+    if (the_string == NULL || tabsize < 0 || length == 0) {
+        return NULL;
+    }
+
+    // Follow the output column, the tabs before a tab change where it ends.
+    size_t ret_length = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (the_string[i] == '\t') {
+            ret_length += next_column(ret_length, tabsize);
+        }
+
+        else {
+            ret_length++;
+        }
+    }
+
+    ret_val = (char *) malloc(ret_length + 1);
+    if (ret_val == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0, idx = 0; i < length; i++) {
+        if (the_string[i] != '\t') {
+            ret_val[idx] = the_string[i];
+            idx++;
+        }
+
+        else {
+            size_t spaces = next_column(idx, tabsize);
+            memset(ret_val + idx, ' ', spaces);
+            idx += spaces;
+        }
+    }
+
+    ret_val[ret_length] = '\0';
+
+    if (out_length != NULL) {
+        *out_length = ret_length;
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief The compiled Aho-Corasick automaton. Bytes that appear in none of the
+ * patterns share a single class, so the transition table is dense but only
+ * has one column per distinct pattern byte.
+ */
+struct pl_multi_pattern {
+    int pattern_count;
+    int max_length;
+    int *lengths;
+    int *alias;
+    int state_count;
+    int class_count;
+    unsigned char classes[256];
+    int *delta;
+    int *output;
+    int *report;
+    int *report_link;
+    int *depth;
+};
+
+
+/**
+ * @brief A match of a pattern in an automaton, see \ref multi_matches.
+ */
+struct multi_match {
+    size_t offset;
+    int pattern;
+};
+
+
+/**
+ * @brief Compiles a set of patterns into an Aho-Corasick automaton, which is
+ * used by \ref pl_count_many and \ref pl_find_any to search for all of the
+ * patterns in a single pass over a string.
+ *
+ * The automaton is stored as a dense transition table, where the bytes are
+ * first mapped to equivalence classes. Every byte in the text costs one table
+ * lookup regardless of the number of patterns.
+ *
+ * You need to free the returned automaton with \ref pl_multi_pattern_free
+ * after use.
+ *
+ * @param patterns Array of the patterns to search for. None of them can be
+ * \b NULL or empty.
+ *
+ * @param count The number of patterns in the array.
+ *
+ * @return Returns a pointer to the compiled automaton. If the function fails
+ * \b NULL is returned.
+ */
+pl_multi_pattern *pl_multi_pattern_new(char **patterns, int count) {
+    pl_multi_pattern *mp = NULL;
+    int *queue = NULL, *fail = NULL;
+
+    if (patterns == NULL || count <= 0) {
+        goto error_exit;
+    }
+
+    mp = (pl_multi_pattern *) calloc(1, sizeof(pl_multi_pattern));
+    if (mp == NULL) {
+        goto error_exit;
+    }
+
+    mp->pattern_count = count;
+    mp->lengths = (int *) calloc(count, sizeof(int));
+    mp->alias = (int *) calloc(count, sizeof(int));
+    if (mp->lengths == NULL || mp->alias == NULL) {
+        goto error_exit;
+    }
+
+    // Number the bytes used by the patterns, everything else is class 0.
+    int total = 1;
+    mp->class_count = 1;
+    for (int i = 0; i < count; i++) {
+        if (patterns[i] == NULL || patterns[i][0] == '\0') {
+            goto error_exit;
+        }
+
+        mp->lengths[i] = strlen(patterns[i]);
+        total += mp->lengths[i];
+
+        if (mp->lengths[i] > mp->max_length) {
+            mp->max_length = mp->lengths[i];
+        }
+
+        for (int x = 0; x < mp->lengths[i]; x++) {
+            unsigned char byte = (unsigned char) patterns[i][x];
+
+            if (mp->classes[byte] == 0) {
+                mp->classes[byte] = mp->class_count++;
+            }
+        }
+    }
+
+    int classes = mp->class_count;
+
+    mp->delta = (int *) calloc((size_t) total * classes, sizeof(int));
+    mp->output = (int *) calloc(total, sizeof(int));
+    mp->report = (int *) calloc(total, sizeof(int));
+    mp->report_link = (int *) calloc(total, sizeof(int));
+    mp->depth = (int *) calloc(total, sizeof(int));
+    queue = (int *) calloc(total, sizeof(int));
+    fail = (int *) calloc(total, sizeof(int));
+    if (mp->delta == NULL || mp->output == NULL || mp->report == NULL ||
+        mp->report_link == NULL || mp->depth == NULL || queue == NULL ||
+        fail == NULL) {
+        goto error_exit;
+    }
+
+    for (int i = 0; i < total; i++) {
+        mp->output[i] = -1;
+    }
+
+    /*
+     * Build the trie. State 0 is the root, and as no edge can lead back to
+     * the root a zero entry in the table means there is no edge yet.
+     */
+    mp->state_count = 1;
+    for (int i = 0; i < count; i++) {
+        int state = 0;
+
+        for (int x = 0; x < mp->lengths[i]; x++) {
+            int *edge = &mp->delta[state * classes +
+                                   mp->classes[(unsigned char) patterns[i][x]]];
+
+            if (*edge == 0) {
+                *edge = mp->state_count++;
+                mp->depth[*edge] = x + 1;
+            }
+
+            state = *edge;
+        }
+
+        // Duplicated patterns are counted through the first copy.
+        if (mp->output[state] == -1) {
+            mp->output[state] = i;
+        }
+
+        mp->alias[i] = mp->output[state];
+    }
+
+    /*
+     * Breadth first over the trie, fill in the failure transitions so the
+     * table becomes a complete automaton. A state is always processed after
+     * the state its failure link points to, so that row is already complete.
+     */
+    int head = 0, tail = 0;
+    queue[tail++] = 0;
+    mp->report_link[0] = -1;
+    mp->report[0] = -1;
+
+    while (head < tail) {
+        int state = queue[head++];
+        int *row = &mp->delta[state * classes];
+
+        for (int c = 0; c < classes; c++) {
+            if (row[c] != 0) {
+                int child = row[c];
+
+                fail[child] = state == 0 ? 0 : mp->delta[fail[state] * classes + c];
+                queue[tail++] = child;
+            }
+
+            else if (state != 0) {
+                row[c] = mp->delta[fail[state] * classes + c];
+            }
+        }
+
+        if (state == 0) {
+            continue;
+        }
+
+        // The report chain lists every state whose pattern ends here.
+        int link = fail[state];
+        mp->report_link[state] = mp->output[link] != -1 ? link : mp->report_link[link];
+        mp->report[state] = mp->output[state] != -1 ? state : mp->report_link[state];
+    }
+
+    free(queue);
+    free(fail);
+
+    return mp;
+
+error_exit:
+    free(queue);
+    free(fail);
+    pl_multi_pattern_free(mp);
+
+    return NULL;
+}
+
+
+/**
+ * @brief Frees an automaton created with \ref pl_multi_pattern_new. Passing
+ * \b NULL is allowed.
+ */
+void pl_multi_pattern_free(pl_multi_pattern *mp) {
+    if (mp == NULL) {
+        return;
+    }
+
+    free(mp->lengths);
+    free(mp->alias);
+    free(mp->delta);
+    free(mp->output);
+    free(mp->report);
+    free(mp->report_link);
+    free(mp->depth);
+    free(mp);
+}
+
+
+/**
+ * @brief Runs the automaton over a buffer and counts the matches of every
+ * pattern. A match is only counted if it does not overlap the previous counted
+ * match of the same pattern, which gives the same counts as \ref pl_count.
+ */
+static int multi_count(pl_multi_pattern *mp, char *text, size_t length,
+                       int *counts) {
+    size_t *next_start = (size_t *) calloc(mp->pattern_count, sizeof(size_t));
+    if (next_start == NULL) {
+        return -1;
+    }
+
+    int total = 0, state = 0, classes = mp->class_count;
+
+    for (int i = 0; i < mp->pattern_count; i++) {
+        counts[i] = 0;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        state = mp->delta[state * classes + mp->classes[(unsigned char) text[i]]];
+
+        for (int q = mp->report[state]; q != -1; q = mp->report_link[q]) {
+            int p = mp->output[q];
+            size_t start = i + 1 - mp->lengths[p];
+
+            if (start >= next_start[p]) {
+                next_start[p] = i + 1;
+                counts[p]++;
+                total++;
+            }
+        }
+    }
+
+    for (int i = 0; i < mp->pattern_count; i++) {
+        if (mp->alias[i] != i) {
+            counts[i] = counts[mp->alias[i]];
+            total += counts[i];
+        }
+    }
+
+    free(next_start);
+
+    return total;
+}
+
+
+/**
+ * @brief Finds the leftmost match of any pattern at or after \a from. When
+ * several patterns start at the same offset the longest one is chosen.
+ * Returns the offset of the match, or \b -1 if there is none.
+ */
+static ptrdiff_t multi_find(pl_multi_pattern *mp, char *text, size_t length,
+                            size_t from, int *pattern) {
+    ptrdiff_t best = -1;
+    int best_pattern = -1, state = 0, classes = mp->class_count;
+
+    for (size_t i = from; i < length; i++) {
+        // No match that starts at or before the best one can end here.
+        if (best != -1 && i >= (size_t) best + mp->max_length) {
+            break;
+        }
+
+        state = mp->delta[state * classes + mp->classes[(unsigned char) text[i]]];
+
+        for (int q = mp->report[state]; q != -1; q = mp->report_link[q]) {
+            int p = mp->output[q];
+            ptrdiff_t start = i + 1 - mp->lengths[p];
+
+            if (best == -1 || start < best ||
+                (start == best && mp->lengths[p] > mp->lengths[best_pattern])) {
+                best = start;
+                best_pattern = p;
+            }
+        }
+    }
+
+    if (pattern != NULL) {
+        *pattern = best_pattern;
+    }
+
+    return best;
+}
+
+
+/**
+ * @brief Finds the leftmost longest matches that do not overlap, in a single
+ * pass of the automaton. The longest match that starts at every offset is kept
+ * in a ring of \a max_length + 1 slots, and an offset is settled once the depth
+ * of the current state shows that no match still in progress can start at or
+ * before it. Returns the number of matches, or \b -1 if the function fails.
+ */
+static ptrdiff_t multi_matches(pl_multi_pattern *mp, char *text, size_t length,
+                               struct multi_match **out) {
+    size_t window = (size_t) mp->max_length + 1;
+    struct multi_match *matches = NULL, *tmp;
+    size_t count = 0, capacity = 0, next = 0;
+    int state = 0, classes = mp->class_count;
+
+    int *longest = (int *) malloc(window * sizeof(int));
+    if (longest == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < window; i++) {
+        longest[i] = -1;
+    }
+
+    for (size_t i = 0; i <= length; i++) {
+        size_t frontier = length;
+
+        if (i < length) {
+            state = mp->delta[state * classes + mp->classes[(unsigned char) text[i]]];
+
+            for (int q = mp->report[state]; q != -1; q = mp->report_link[q]) {
+                int p = mp->output[q];
+                size_t start = i + 1 - mp->lengths[p];
+                int *slot = &longest[start % window];
+
+                // Matches inside an earlier match are not replaced.
+                if (start >= next && (*slot == -1 ||
+                                      mp->lengths[p] > mp->lengths[*slot])) {
+                    *slot = p;
+                }
+            }
+
+            frontier = i + 1 - mp->depth[state];
+        }
+
+        while (next < frontier) {
+            int p = longest[next % window];
+
+            if (p == -1) {
+                next++;
+                continue;
+            }
+
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                tmp = (struct multi_match *) realloc(matches,
+                        capacity * sizeof(struct multi_match));
+                if (tmp == NULL) {
+                    free(matches);
+                    free(longest);
+
+                    return -1;
+                }
+
+                matches = tmp;
+            }
+
+            matches[count].offset = next;
+            matches[count].pattern = p;
+            count++;
+
+            for (size_t end = next + mp->lengths[p]; next < end; next++) {
+                longest[next % window] = -1;
+            }
+        }
+    }
+
+    free(longest);
+    *out = matches;
+
+    return (ptrdiff_t) count;
+}
+
+
+/**
+ * @brief Counts the occurences of many patterns in a string in a single pass.
+ * The count for every pattern is the same as calling \ref pl_count once for
+ * each pattern, but the string is only read once, and the cost per byte does
+ * not depend on the number of patterns.
+ *
+ * @param mp The automaton created with \ref pl_multi_pattern_new.
+ *
+ * @param the_string The string you want to search.
+ *
+ * @param counts Array with room for one count per pattern, the count of
+ * every pattern is written to the same index the pattern had when the
+ * automaton was created.
+ *
+ * @return Returns the sum of all the counts. If the function fails \b -1 is
+ * returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char *keywords[] = {"ERROR", "WARN", "timeout"};
+    char log[] = "WARN slow\nERROR timeout\nERROR disk\n";
+    int counts[3];
+    pl_multi_pattern *mp;
+
+    mp = pl_multi_pattern_new(keywords, 3);
+    if (mp == NULL) {
+        return 1;
+    }
+
+    if (pl_count_many(mp, log, counts) != -1) {
+        for (int i = 0; i < 3; i++) {
+            printf("%s: %d\n", keywords[i], counts[i]);
+        }
+    }
+
+    pl_multi_pattern_free(mp);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+ERROR: 2
+WARN: 1
+timeout: 1
+\endcode
+ */
+int pl_count_many(pl_multi_pattern *mp, char *the_string, int *counts) {
+    if (mp == NULL || the_string == NULL || counts == NULL) {
+        return -1;
+    }
+
+    size_t length = strlen(the_string);
+
+    if (length == 0) {
+        return -1;
+    }
+
+    return multi_count(mp, the_string, length, counts);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_count_many, the string is given as a
+ * pointer and a length.
+ *
+ * @param mp The automaton created with \ref pl_multi_pattern_new.
+ *
+ * @param the_string The string you want to search.
+ *
+ * @param length The length of the string.
+ *
+ * @param counts Array with room for one count per pattern.
+ *
+ * @return Returns the sum of all the counts. If the function fails \b -1 is
+ * returned.
+ */
+int pl_count_many_n(pl_multi_pattern *mp, char *the_string, size_t length,
+                    int *counts) {
+    if (mp == NULL || the_string == NULL || counts == NULL || length == 0) {
+        return -1;
+    }
+
+    return multi_count(mp, the_string, length, counts);
+}
+
+
+/**
+ * @brief Finds the first match of any of the patterns in a string, in a single
+ * pass. The match that starts first is returned, and if several patterns
+ * start at the same offset the longest of them is returned.
+ *
+ * @param mp The automaton created with \ref pl_multi_pattern_new.
+ *
+ * @param the_string The string you want to search.
+ *
+ * @param pattern Optional, if not \b NULL it is set to the index of the
+ * pattern that matched, or \b -1 if nothing matched.
+ *
+ * @return Returns the offset of the match. If none of the patterns are found
+ * \b -1 is returned, and if the function fails \b -2 is returned.
+ */
+int pl_find_any(pl_multi_pattern *mp, char *the_string, int *pattern) {
+    if (mp == NULL || the_string == NULL) {
+        return -2;
+    }
+
+    return multi_find(mp, the_string, strlen(the_string), 0, pattern);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_find_any, the string is given as a
+ * pointer and a length.
+ *
+ * @param mp The automaton created with \ref pl_multi_pattern_new.
+ *
+ * @param the_string The string you want to search.
+ *
+ * @param length The length of the string.
+ *
+ * @param pattern Optional, set to the index of the pattern that matched, or
+ * \b -1 if nothing matched.
+ *
+ * @return Returns the offset of the match. If none of the patterns are found
+ * \b -1 is returned, and if the function fails \b -2 is returned.
+ */
+ptrdiff_t pl_find_any_n(pl_multi_pattern *mp, char *the_string, size_t length,
+                        int *pattern) {
+    if (mp == NULL || the_string == NULL) {
+        return -2;
+    }
+
+    return multi_find(mp, the_string, length, 0, pattern);
+}
+
+
+/**
+ * @brief Returns a copy of the string where occurences of \a old are replaced
+ * by \a new, like Python's replace. If \a maxcount is not negative only the
+ * first \a maxcount occurences are replaced.
+ *
+ * The occurences are found once and remembered, the exact size of the result
+ * is computed from them, and the result is built with one allocation and
+ * memcpy of the pieces.
+ *
+ * You need to free the returned buffer after use.
+ *
+ * @param string The string you want to replace in.
+ *
+ * @param old The sub string you want to replace, it can not be empty.
+ *
+ * @param new The string the occurences are replaced with, it can be empty.
+ *
+ * @param maxcount The maximum number of replacements, or \b -1 to replace all
+ * of the occurences.
+ *
+ * @return Returns a pointer to the new string. If the function fails \b NULL is
+ * returned.
+ *
+ * \b Example
+\code{.c}
+#include "plstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main() {
+    char the_string[] = "one fish, two fish, red fish";
+    char *ret_val;
+
+    ret_val = pl_replace(the_string, "fish", "cat", -1);
+    if (ret_val != NULL) {
+        printf("%s\n", ret_val);
+        free(ret_val);
+    }
+
+    ret_val = pl_replace(the_string, "fish", "", 2);
+    if (ret_val != NULL) {
+        printf("%s\n", ret_val);
+        free(ret_val);
+    }
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+one cat, two cat, red cat
+one , two , red fish
+\endcode
+ */
+char *pl_replace(char *string, char *old, char *new, int maxcount) {
+    if (string == NULL || old == NULL || new == NULL) {
+        return NULL;
+    }
+
+    return pl_replace_n(string, strlen(string), old, strlen(old), new,
+                        strlen(new), maxcount, NULL);
+}
 
 
 /**
- * @brief This function is a wrapper around \a strcpy, it copies a string into a
- * buffer. If the \a destination argument is \b NULL a new buffer is allocated,
- * and if it is not \b NULL the string passed in \a source is copied into the
- * destination buffer.
+ * @brief Binary safe version of \ref pl_replace, all the strings are given as
+ * a pointer and a length.
  *
- * If the \a source parameter is \b NULL you will need to free the returned
- * buffer after use.
+ * You need to free the returned buffer after use, it is NUL terminated.
  *
- * @param source This is string you want to copy into the buffer.
+ * @param string The string you want to replace in.
  *
- * @param destination This is the optional \a destination buffer, if \b NULL is
- * passed a new buffer is allocated and the \a source is copied into it. If it
- * is not \b NULL the source will be copied into the destination buffer.
+ * @param string_length The length of the string.
  *
- * @return If successful a pointer to buffer is returned. If the function fails
- * \b NULL is returned.
+ * @param old The sub string you want to replace, it can not be empty.
  *
- * \b Example
+ * @param old_length The length of \a old.
  *
- * \code{.c}
+ * @param new The string the occurences are replaced with.
+ *
+ * @param new_length The length of \a new, it can be \b 0.
+ *
+ * @param maxcount The maximum number of replacements, or a negative number to
+ * replace every occurence.
+ *
+ * @param out_length Optional, set to the length of the returned string.
+ *
+ * @return Returns a pointer to the new string. If the function fails \b NULL is
+ * returned.
+ */
+char *pl_replace_n(char *string, size_t string_length, char *old,
+                   size_t old_length, char *new, size_t new_length,
+                   ptrdiff_t maxcount, size_t *out_length) {
+    size_t stack_offsets[32];
+    size_t *offsets = stack_offsets, capacity = 32, count = 0;
+    char *ret_val = NULL;
+
+    if (string == NULL || old == NULL || new == NULL) {
+        return NULL;
+    }
+
+    if (string_length == 0 || old_length == 0) {
+        return NULL;
+    }
+
+    char *pch = string, *end = string + string_length;
+
+    while ((maxcount < 0 || count < (size_t) maxcount) &&
+           (pch = find_kernel(pch, end - pch, old, old_length)) != NULL) {
+        if (count == capacity) {
+            size_t *tmp = (size_t *) malloc(capacity * 2 * sizeof(size_t));
+            if (tmp == NULL) {
+                goto exit;
+            }
+
+            memcpy(tmp, offsets, count * sizeof(size_t));
+            if (offsets != stack_offsets) {
+                free(offsets);
+            }
+
+            offsets = tmp;
+            capacity *= 2;
+        }
+
+        offsets[count++] = pch - string;
+        pch += old_length;
+    }
+
+    size_t ret_length = string_length - count * old_length + count * new_length;
+
+    ret_val = (char *) malloc(ret_length + 1);
+    if (ret_val == NULL) {
+        goto exit;
+    }
+
+    char *out = ret_val;
+    size_t last = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(out, string + last, offsets[i] - last);
+        out += offsets[i] - last;
+        memcpy(out, new, new_length);
+        out += new_length;
+        last = offsets[i] + old_length;
+    }
+
+    memcpy(out, string + last, string_length - last);
+    ret_val[ret_length] = '\0';
+
+    if (out_length != NULL) {
+        *out_length = ret_length;
+    }
+
+exit:
+    if (offsets != stack_offsets) {
+        free(offsets);
+    }
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Applies a whole substitution map to a string in a single pass. Every
+ * pattern in the automaton is replaced with the replacement at the same index,
+ * the leftmost match wins and if several patterns start at the same offset the
+ * longest is used. Replaced text is never searched again.
+ *
+ * The automaton can be reused for many strings, so the patterns are only
+ * compiled once. You need to free the returned buffer after use.
+ *
+ * @param string The string you want to replace in.
+ *
+ * @param mp The patterns to replace, created with \ref pl_multi_pattern_new.
+ *
+ * @param replacements Array with one replacement for every pattern in the
+ * automaton, none of them can be \b NULL but they can be empty.
+ *
+ * @return Returns a pointer to the new string. If the function fails \b NULL is
+ * returned.
+ *
+ * \b Example
+\code{.c}
 #include "plstr.h"
-#include <stdlib.h>
 #include <stdio.h>
-#include <string.h>
+#include <stdlib.h>
+
+
+int main() {
+    char *secrets[] = {"hunter2", "s3cr3t", "token=abc"};
+    char *masks[] = {"*******", "******", "token=***"};
+    char line[] = "login user pass=hunter2 token=abc key=s3cr3t";
+    pl_multi_pattern *mp;
+    char *ret_val;
+
+    mp = pl_multi_pattern_new(secrets, 3);
+    if (mp == NULL) {
+        return 1;
+    }
+
+    ret_val = pl_replace_many(line, mp, masks);
+    if (ret_val != NULL) {
+        printf("%s\n", ret_val);
+        free(ret_val);
+    }
+
+    pl_multi_pattern_free(mp);
+
+    return 0;
+}
+\endcode
+ *
+ * \b Output
+\code{.unparsed}
+login user pass=******* token=*** key=******
+\endcode
+ */
+char *pl_replace_many(char *string, pl_multi_pattern *mp, char **replacements) {
+    struct multi_match *matches = NULL;
+    char *ret_val = NULL;
+
+    if (string == NULL || mp == NULL || replacements == NULL) {
+        return NULL;
+    }
+
+    size_t string_length = strlen(string);
+
+    if (string_length == 0) {
+        return NULL;
+    }
+
+    size_t *replacement_lengths = (size_t *) calloc(mp->pattern_count, sizeof(size_t));
+    if (replacement_lengths == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < mp->pattern_count; i++) {
+        if (replacements[i] == NULL) {
+            goto exit;
+        }
+
+        replacement_lengths[i] = strlen(replacements[i]);
+    }
+
+    ptrdiff_t count = multi_matches(mp, string, string_length, &matches);
+    if (count == -1) {
+        goto exit;
+    }
+
+    size_t ret_length = string_length;
+
+    for (ptrdiff_t i = 0; i < count; i++) {
+        int p = matches[i].pattern;
+
+        ret_length = ret_length - mp->lengths[p] + replacement_lengths[p];
+    }
+
+    ret_val = (char *) malloc(ret_length + 1);
+    if (ret_val == NULL) {
+        goto exit;
+    }
+
+    char *out = ret_val;
+    size_t last = 0;
+
+    for (ptrdiff_t i = 0; i < count; i++) {
+        int p = matches[i].pattern;
+
+        memcpy(out, string + last, matches[i].offset - last);
+        out += matches[i].offset - last;
+        memcpy(out, replacements[p], replacement_lengths[p]);
+        out += replacement_lengths[p];
+        last = matches[i].offset + mp->lengths[p];
+    }
+
+    memcpy(out, string + last, string_length - last);
+    ret_val[ret_length] = '\0';
+
+exit:
+    free(replacement_lengths);
+    free(matches);
+
+    return ret_val;
+}
+
+
+/**
+ * @brief Validates a buffer of UTF-8. Runs of ASCII are skipped with the
+ * vector kernel, and the multi byte sequences are checked one at a time for
+ * overlong forms, surrogates and code points above U+10FFFF.
+ */
+static int utf8_validate(char *string, size_t length) {
+    unsigned char *s = (unsigned char *) string;
+    size_t i = 0;
+
+    while (i < length) {
+        i += ascii_prefix_kernel(string + i, length - i);
+        if (i == length) {
+            break;
+        }
+
+        unsigned char lead = s[i];
+        unsigned char low = 0x80, high = 0xBF;
+        size_t needed;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            needed = 1;
+        }
+
+        else if (lead >= 0xE0 && lead <= 0xEF) {
+            needed = 2;
+            if (lead == 0xE0) {
+                low = 0xA0;
+            }
+
+            else if (lead == 0xED) {
+                high = 0x9F;
+            }
+        }
+
+        else if (lead >= 0xF0 && lead <= 0xF4) {
+            needed = 3;
+            if (lead == 0xF0) {
+                low = 0x90;
+            }
+
+            else if (lead == 0xF4) {
+                high = 0x8F;
+            }
+        }
+
+        else {
+            return 0;
+        }
+
+        if (length - i <= needed) {
+            return 0;
+        }
+
+        // Only the first continuation byte has a narrowed range.
+        if (s[i + 1] < low || s[i + 1] > high) {
+            return 0;
+        }
+
+        for (size_t x = 2; x <= needed; x++) {
+            if ((s[i + x] & 0xC0) != 0x80) {
+                return 0;
+            }
+        }
+
+        i += needed + 1;
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief Returns the byte offset of code point number \a n in a buffer of
+ * UTF-8, or \b -1 if the buffer has fewer code points. Asking for the code
+ * point just past the last one returns the length of the buffer. Whole blocks
+ * are skipped by counting their code points with the vector kernel.
+ */
+static ptrdiff_t utf8_advance(char *string, size_t length, size_t n) {
+    size_t pos = 0;
+
+    while (pos + 64 <= length) {
+        size_t count = utf8_count_kernel(string + pos, 64);
+
+        if (count > n) {
+            break;
+        }
+
+        n -= count;
+        pos += 64;
+    }
+
+    for (; pos < length; pos++) {
+        if (((unsigned char) string[pos] & 0xC0) != 0x80) {
+            if (n == 0) {
+                return pos;
+            }
+
+            n--;
+        }
+    }
+
+    return n == 0 ? (ptrdiff_t) length : -1;
+}
+
+
+/**
+ * @brief Checks if a string is valid UTF-8. Overlong encodings, surrogates,
+ * code points above U+10FFFF and truncated sequences are all rejected. Runs of
+ * ASCII are skipped 16 or 32 bytes at a time.
+ *
+ * @param string The string you want to validate.
+ *
+ * @return Returns \b 1 if the string is valid UTF-8, and \b 0 if it is not. If
+ * the function fails \b -1 is returned.
+ */
+int pl_utf8_validate(char *string) {
+    if (string == NULL) {
+        return -1;
+    }
+
+    return utf8_validate(string, strlen(string));
+}
+
+
+/**
+ * @brief Counts the number of code points in a UTF-8 string, which is the
+ * length of the string in Python. The string is not validated, every byte
+ * that is not a continuation byte is counted as a code point.
+ *
+ * @param string The string you want the length of.
+ *
+ * @return Returns the number of code points in the string. If the function
+ * fails \b -1 is returned.
+ */
+int pl_len_cp(char *string) {
+    if (string == NULL) {
+        return -1;
+    }
+
+    return (int) utf8_count_kernel(string, strlen(string));
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_utf8_validate, the string is given
+ * as a pointer and a length. NUL is a valid code point, so it can be part of
+ * the string.
+ *
+ * @param string The string you want to validate.
+ *
+ * @param length The length of the string.
+ *
+ * @return Returns \b 1 if the string is valid UTF-8 and \b 0 if it is not. If
+ * the function fails \b -1 is returned.
+ */
+int pl_utf8_validate_n(char *string, size_t length) {
+    if (string == NULL) {
+        return -1;
+    }
+
+    return utf8_validate(string, length);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_len_cp, the string is given as a
+ * pointer and a length.
+ *
+ * @param string The string you want the length of.
+ *
+ * @param length The length of the string in bytes.
+ *
+ * @return Returns the number of code points in the string. If the function
+ * fails \b -1 is returned.
+ */
+ptrdiff_t pl_len_cp_n(char *string, size_t length) {
+    if (string == NULL) {
+        return -1;
+    }
+
+    return utf8_count_kernel(string, length);
+}
+
+
+/**
+ * @brief Shared implementation of the code point slicing functions. The
+ * offset and limit are resolved like \ref pl_slice does it, and \a locate
+ * turns a code point index into a byte offset. The byte length of the slice
+ * is stored in \a out_length if it is not \b NULL.
+ */
+static char *slice_cp(char *string, size_t length, ptrdiff_t cp_length,
+                      ptrdiff_t offset, ptrdiff_t limit,
+                      ptrdiff_t (*locate)(void *, size_t), void *arg,
+                      size_t *out_length) {
+    if (offset < 0 || limit < 0) {
+        if (offset < 0) {
+            offset += cp_length;
+        }
+
+        if (limit < 0) {
+            limit += cp_length;
+        }
 
+        if (offset < 0 || limit < 0) {
+            return NULL;
+        }
+    }
 
-int main() {
-    char the_string[] = "This is a short string.";
-    char *copied_str, *pre_alloc;
+    if (limit <= offset || (cp_length >= 0 && limit > cp_length)) {
+        return NULL;
+    }
 
-    copied_str = pl_cpy(the_string, NULL);
-    if (copied_str != NULL) {
-        printf("copied_str: %s\n", copied_str);
+    ptrdiff_t begin = locate(arg, offset);
+    if (begin == -1) {
+        return NULL;
     }
 
-    pre_alloc = (char *) calloc(strlen(the_string) + 1, sizeof(char));
-    if (pre_alloc == NULL) {
-        return 0;
+    ptrdiff_t end = locate(arg, limit);
+    if (end == -1 || (size_t) end > length) {
+        return NULL;
     }
 
-    if(pl_cpy(the_string, pre_alloc) != NULL) {
-        printf("pre_alloc: %s\n", pre_alloc);
+    char *ret_val = (char *) calloc(end - begin + 1, sizeof(char));
+    if (ret_val == NULL) {
+        return NULL;
     }
 
-    free(copied_str);
-    free(pre_alloc);
+    memcpy(ret_val, string + begin, end - begin);
 
-    return 0;
-}
-\endcode
- *
- * \b Output
-\code{.unparsed}
-copied_str: This is a short string.
-pre_alloc: This is a short string.
-\endcode
- */
-char *pl_cpy(char *source, char *destination) {
-    char *ret_val = destination;
-    if (source == NULL) {
-        goto error_exit;
+    if (out_length != NULL) {
+        *out_length = end - begin;
     }
 
-    if (destination == NULL) {
-        ret_val = calloc(strlen(source) + 1, sizeof(char));
-        if (ret_val == NULL) {
-            goto error_exit;
-        }
-    }
+    return ret_val;
+}
 
-    ret_val = strcpy(ret_val, source);
 
-    return ret_val;
+struct cp_walk {
+    char *string;
+    size_t length;
+};
 
-error_exit:
-    return NULL;
+
+static ptrdiff_t locate_walk(void *arg, size_t n) {
+    struct cp_walk *walk = (struct cp_walk *) arg;
+
+    return utf8_advance(walk->string, walk->length, n);
 }
 
 
 /**
- * @brief This function slices an string using an offset and a limit and returns a
- * substring. The original string is not manipulated in any way. The function
- * supports the use of both a negative offset and limit. When using a negative
- * value it is offsetted from the end of the string.
+ * @brief This function slices a UTF-8 string like \ref pl_slice, but the
+ * offset and the limit count code points instead of bytes, so multi byte
+ * characters are never cut in half. Negative values are offsetted from the end
+ * of the string.
+ *
+ * The code point length of the string is only computed when a negative value
+ * is used. To slice the same long string many times build an index with
+ * \ref pl_cp_index_new and use \ref pl_cp_index_slice instead.
  *
  * You need to free the returned buffer after use.
  *
  * @param source The string you want to slice.
  *
- * @param offset The offset you want to slice from.
+ * @param offset The code point you want to slice from.
  *
- * @param limit The limit you want to slice too.
+ * @param limit The code point you want to slice too.
  *
- * @return The function returns a pointer to an allocated buffer containing the
- * substring if successful. In cases where the limit is smaller than the
- * offset, or if they are equal a \b NULL pointer is returned. The returned
- * \b NULL pointer can also be returned if the call to calloc fails, or if the
- * offset or limit is outside the range of the string.
+ * @return Returns a pointer to a buffer with the sub string. \b NULL is
+ * returned in the same cases as for \ref pl_slice.
  *
-\b Example
+ * \b Example
 \code{.c}
 #include "plstr.h"
-#include <stdlib.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 
 int main() {
-    char the_string[] = "subdermatoglyphic";
+    char the_string[] = "bl\xc3\xa5" "b\xc3\xa6rsyltet\xc3\xb8y";
     char *sliced;
 
-    sliced = pl_slice(the_string, 3, 10);
+    printf("bytes: %d code points: %d\n", (int) strlen(the_string),
+            pl_len_cp(the_string));
+
+    sliced = pl_slice_cp(the_string, 2, 6);
     if (sliced != NULL) {
-        printf("the_string: %s\nsliced 3, 10: %s\n", the_string, sliced);
+        printf("sliced 2, 6: %s\n", sliced);
         free(sliced);
     }
 
-    sliced = pl_slice(the_string, 0, -10);
+    sliced = pl_slice_cp(the_string, -3, -1);
     if (sliced != NULL) {
-        printf("sliced 0,-10: %s\n", sliced);
+        printf("sliced -3, -1: %s\n", sliced);
         free(sliced);
     }
 
@@ -183,317 +8240,295 @@ int main() {
  *
  * \b Output
 \code{.unparsed}
-the_string: subdermatoglyphic
-sliced 3, 10: dermato
-sliced 0,-10: subderm
+bytes: 17 code points: 14
+sliced 2, 6: åbær
+sliced -3, -1: tø
 \endcode
  */
-char *pl_slice(char *source, int offset, int limit) {
+char *pl_slice_cp(char *source, int offset, int limit) {
     if (source == NULL) {
         return NULL;
     }
 
-    int source_length = strlen(source);
+    return pl_slice_cp_n(source, strlen(source), offset, limit, NULL);
+}
+
 
-    if (source_length == 0) {
+/**
+ * @brief Binary safe version of \ref pl_slice_cp, the string is given as a
+ * pointer and a length.
+ *
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param source The string you want to slice.
+ *
+ * @param length The length of the string in bytes.
+ *
+ * @param offset The code point you want to slice from.
+ *
+ * @param limit The code point you want to slice too.
+ *
+ * @param out_length Optional, set to the length of the returned string in
+ * bytes.
+ *
+ * @return Returns a pointer to a buffer with the sub string. \b NULL is
+ * returned in the same cases as for \ref pl_slice.
+ */
+char *pl_slice_cp_n(char *source, size_t length, ptrdiff_t offset,
+                    ptrdiff_t limit, size_t *out_length) {
+    if (source == NULL || length == 0) {
         return NULL;
     }
 
-    // Get the right limit if limit is negative
-    int new_limit;
-    if (limit < 0) {
-        new_limit = source_length + limit;
-    }
+    struct cp_walk walk = {source, length};
+    ptrdiff_t cp_length = -1;
 
-    else {
-        new_limit = limit;
+    if (offset < 0 || limit < 0) {
+        cp_length = utf8_count_kernel(source, length);
     }
 
-    // Same shit but with the offset.
-    int new_offset;
-    if (offset < 0) {
-        new_offset = source_length + offset;
-    }
+    return slice_cp(source, length, cp_length, offset, limit,
+                    locate_walk, &walk, out_length);
+}
 
-    else {
-        new_offset = offset;
-    }
 
-    /*
-     * Exit if limit is less than offset or if they are equal.
-     * If the limit is less than the offset there is no characters to slice,
-     * same if they are equal.
-     */
-    if (new_limit < new_offset || (new_limit - new_offset) == 0 ||
-        // Exit if limit or offset points to somewhere outside of the string.
-        new_limit > source_length || new_offset > source_length) {
-        return NULL;
-    }
+/**
+ * @brief The sparse index remembers the byte offset of every
+ * \b PL_CP_INDEX_STRIDE th code point.
+ */
+struct pl_cp_index {
+    char *string;
+    size_t length;
+    size_t cp_length;
+    size_t *marks;
+};
 
-    char *tmp = (char *) calloc((new_limit - new_offset) + 1, sizeof(char));
-    if (tmp == NULL) {
-        return NULL;
-    }
 
-    int tmp_count = 0;
-    for(int i = new_offset; i < new_limit; i++) {
-        tmp[tmp_count] = source[i];
-        tmp_count++;
+/**
+ * @brief Builds a sparse code point to byte offset index for a UTF-8 string.
+ * The string is scanned once, and afterwards any code point can be found by
+ * scanning at most \b PL_CP_INDEX_STRIDE code points from the closest mark.
+ *
+ * The index points into the string, so the string must not be changed or
+ * freed while the index is used. You need to free the returned index with
+ * \ref pl_cp_index_free after use.
+ *
+ * @param string The string you want to index.
+ *
+ * @return Returns a pointer to the index. If the function fails \b NULL is
+ * returned.
+ */
+pl_cp_index *pl_cp_index_new(char *string) {
+    if (string == NULL) {
+        return NULL;
     }
 
-    return tmp;
+    return pl_cp_index_new_n(string, strlen(string));
 }
 
 
 /**
- * @brief This function creates a new buffer that is the size of the two
- * arguments, and both arguments are copied into it. The resulting string
- * is \a destination+source.
+ * @brief Binary safe version of \ref pl_cp_index_new, the string is given as a
+ * pointer and a length.
  *
- * You need to free the returned buffer after use.
- *
- * @param destination The first string you want to concatenation to.
- *
- * @param source The string you want concatenation destination with.
+ * @param string The string you want to index.
  *
- * @return Returns a pointer to the new buffer of the concatenation strings.
- * If the function fails \b NULL is returned.
+ * @param length The length of the string in bytes.
  *
- * \b Example
-\code{.c}
-#include "plstr.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
+ * @return Returns a pointer to the index. If the function fails \b NULL is
+ * returned.
+ */
+pl_cp_index *pl_cp_index_new_n(char *string, size_t length) {
+    if (string == NULL) {
+        return NULL;
+    }
 
+    pl_cp_index *index = (pl_cp_index *) calloc(1, sizeof(pl_cp_index));
+    if (index == NULL) {
+        return NULL;
+    }
 
-int main() {
-    char foo[] = "foo";
-    char bar[] = "bar";
-    char *concatenated = NULL;
+    index->string = string;
+    index->length = length;
+    index->cp_length = utf8_count_kernel(string, index->length);
 
-    concatenated = pl_cat(foo, bar);
-    if (concatenated != NULL) {
-        printf("foo:%s\nbar:%s\nconcatenated:%s\n", foo, bar, concatenated);
-    }
+    size_t mark_count = index->cp_length / PL_CP_INDEX_STRIDE + 1;
 
-    free(concatenated);
+    index->marks = (size_t *) calloc(mark_count, sizeof(size_t));
+    if (index->marks == NULL) {
+        free(index);
 
-    return 0;
-}
-\endcode
- *
- * \b Output
-\code
-foo:foo
-bar:bar
-concatenated:foobar
-\endcode
- */
-char *pl_cat(char *destination, char *source) {
-    if (destination == NULL || source == NULL) {
         return NULL;
     }
 
-    char *ret_val = (char *) calloc(strlen(source) + strlen(destination) + 1, sizeof(char));
-    if (ret_val == NULL) {
-        goto error_exit;
+    size_t pos = 0;
+    for (size_t i = 1; i < mark_count; i++) {
+        pos += utf8_advance(string + pos, index->length - pos, PL_CP_INDEX_STRIDE);
+        index->marks[i] = pos;
     }
 
-    ret_val = pl_cpy(destination, ret_val);
-    if (ret_val == NULL) {
-        goto error_exit;
-    }
+    return index;
+}
 
-    strcat(ret_val, source);
 
-    return ret_val;
+static ptrdiff_t locate_index(void *arg, size_t n) {
+    pl_cp_index *index = (pl_cp_index *) arg;
 
-error_exit:
-    free(ret_val);
+    if (n > index->cp_length) {
+        return -1;
+    }
 
-    return NULL;
+    size_t mark = index->marks[n / PL_CP_INDEX_STRIDE];
+    ptrdiff_t pos = utf8_advance(index->string + mark, index->length - mark,
+                                 n % PL_CP_INDEX_STRIDE);
+
+    return pos == -1 ? -1 : (ptrdiff_t) mark + pos;
 }
 
 
 /**
- * @brief This function splits the string using a delimiter, and puts the
- * results in array of strings. The function differs from the behaviour of
- * strtok, if the delimiter is longer than a single character it splits the
- * string where where the delimiter is found. If the string is
- * \a "fooasdbarasdmagic" and the delimiter is \a "asd" the result will be
- * ["foo", "bar", "magic"]. If the delimiter is not found, or it is empty string
- * NULL is returned instead. The original string is not modified.
- *
- * You need to free the returned buffer after use, remember to iterate over the
- * returned buffer and free every element in it before you free the returned
- * buffer.
+ * @brief Slices the indexed string like \ref pl_slice_cp, without scanning the
+ * string from the start.
  *
- * @param string The string you want to split up.
+ * You need to free the returned buffer after use.
  *
- * @param delim The delimiter you want to use.
+ * @param index The index created with \ref pl_cp_index_new.
  *
- * @param size This will be set to the size of the returned array.
+ * @param offset The code point you want to slice from.
  *
- * @return Returns an array of strings with the different sub strings if
- * successful. The size argument is set to the size of the returned array.
- * If the function fails \b NULL is returned.
+ * @param limit The code point you want to slice too.
  *
-\b Example
-\code{.c}
-#include "plstr.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-
-
-int main() {
-    char the_string[] = "This is a short string.";
-    char **splitted;
-    int size;
-
-    splitted = pl_split(the_string, " ", &size);
-
-    if (splitted != NULL) {
-        int i;
-
-        printf("The size is %d\n", size);
-        for (i = 0; i < size; i++) {
-            printf("splitted[%d] = %s\n", i, splitted[i]);
-        }
-
-        for (i = 0; i < size; i++) {
-            free(splitted[i]);
-        }
+ * @return Returns a pointer to a buffer with the sub string. If the function
+ * fails \b NULL is returned.
+ */
+char *pl_cp_index_slice(pl_cp_index *index, int offset, int limit) {
+    return pl_cp_index_slice_n(index, offset, limit, NULL);
+}
 
-        free(splitted);
-    }
 
-    return 0;
-}
-\endcode
+/**
+ * @brief Version of \ref pl_cp_index_slice with \b ptrdiff_t code points,
+ * that also returns the byte length of the slice.
  *
- * \b Output
-\code{.unparsed}
-The size is 5
-splitted[0] = This
-splitted[1] = is
-splitted[2] = a
-splitted[3] = short
-splitted[4] = string.
-\endcode
+ * You need to free the returned buffer after use, it is NUL terminated.
+ *
+ * @param index The index created with \ref pl_cp_index_new.
+ *
+ * @param offset The code point you want to slice from.
+ *
+ * @param limit The code point you want to slice too.
+ *
+ * @param out_length Optional, set to the length of the returned string in
+ * bytes.
+ *
+ * @return Returns a pointer to a buffer with the sub string. If the function
+ * fails \b NULL is returned.
  */
-char **pl_split(char *string, char *delim, int *size) {
-    char **ret_val = NULL;
-
-    if (string == NULL || strlen(string) == 0 || delim == NULL
-        || size == NULL) {
-        return NULL;
-    }
-
-    int delim_length = strlen(delim);
-
-    if (delim_length == 0) {
-        return NULL;
-    }
-
-    // Count the number of occurences of the sub str.
-    char *pch = string;
-    int delims = 0;
-    do {
-        pch = strstr(pch, delim);
-
-        if (pch != NULL) {
-            delims++;
-
-            pch = pch + delim_length;
-        }
-    } while (pch != NULL);
-
-    if (delims == 0) {
-        return NULL;
-    }
-
-    char **tmp = (char **) calloc(delims + 1, sizeof(char *));
-    if (tmp == NULL) {
+char *pl_cp_index_slice_n(pl_cp_index *index, ptrdiff_t offset,
+                          ptrdiff_t limit, size_t *out_length) {
+    if (index == NULL || index->length == 0) {
         return NULL;
     }
 
-    pch = string;
-    char *offset = string;
-    int i;
-    for (i = 0; i < delims; i++) {
-        char *sub_str = NULL;
+    return slice_cp(index->string, index->length, index->cp_length, offset,
+                    limit, locate_index, index, out_length);
+}
 
-        pch = strstr(pch, delim);
 
-        sub_str = (char *) calloc((pch - offset) + 1, sizeof(char));
-        if (sub_str == NULL) {
-            goto error_exit;
-        }
+/**
+ * @brief Returns the number of code points in the indexed string, without
+ * scanning it again.
+ *
+ * @param index The index created with \ref pl_cp_index_new.
+ *
+ * @return Returns the number of code points. If the function fails \b -1 is
+ * returned.
+ */
+int pl_cp_index_len(pl_cp_index *index) {
+    if (index == NULL) {
+        return -1;
+    }
 
-        strncpy(sub_str, offset, pch - offset);
+    return (int) index->cp_length;
+}
 
-        pch += delim_length;
-        offset = pch;
-        tmp[i] = sub_str;
-    }
 
-    pch = (char *) calloc(strlen(offset) + 1, sizeof(char));
-    if (pch == NULL) {
-        goto error_exit;
+/**
+ * @brief Frees an index created with \ref pl_cp_index_new. The indexed string
+ * is not freed. Passing \b NULL is allowed.
+ */
+void pl_cp_index_free(pl_cp_index *index) {
+    if (index == NULL) {
+        return;
     }
 
-    strncpy(pch, offset, strlen(offset));
-
-    tmp[i] = pch;
-    ret_val = tmp;
+    free(index->marks);
+    free(index);
+}
 
-    *size = i + 1;
 
-    return ret_val;
+/**
+ * @brief Shared implementation of the case conversion functions, it follows
+ * the conventions of \ref pl_cpy for the destination buffer.
+ */
+static char *convert_case(char *source, size_t length, char *destination,
+                          char lo1, char hi1, char lo2, char hi2) {
+    if (source == NULL) {
+        return NULL;
+    }
 
-error_exit:
-    for(int i = 0; i < (delims + 1); i++) {
-        free(tmp[i]);
+    if (destination == NULL) {
+        destination = (char *) malloc(length + 1);
+        if (destination == NULL) {
+            return NULL;
+        }
     }
 
-    free(tmp);
+    case_kernel(destination, source, length, lo1, hi1, lo2, hi2);
+    destination[length] = '\0';
 
-    return ret_val;
+    return destination;
 }
 
 
 /**
- * @brief Checks if the string starts with a prefix. Does not modify the string.
+ * @brief Converts the ASCII letters of a string to lower case, other bytes
+ * are copied unchanged so UTF-8 text passes through. The conversion does not
+ * depend on the locale, and is done 16 or 32 bytes at a time.
  *
- * @param string The string you want to check.
+ * The destination works like it does for \ref pl_cpy. If it is \b NULL a new
+ * buffer is allocated, which you need to free after use. To convert the string
+ * in place pass the string as the destination as well.
  *
- * @param prefix The substring you want to check if the string starts with.
+ * @param source The string you want to convert.
  *
- * @return Returns \b 1 if the string starts with the prefix, returns \b 0 if it
- * does not. If the function fails \b -1 is returned.
+ * @param destination Optional buffer with room for the string, or the string
+ * itself to convert it in place.
  *
+ * @return Returns a pointer to the converted string. If the function fails
+ * \b NULL is returned.
+ *
+ * \b Example
 \code{.c}
 #include "plstr.h"
-#include <stdlib.h>
 #include <stdio.h>
-#include <string.h>
+#include <stdlib.h>
 
 
 int main() {
-    char the_string[] = "http://google.com";
-    int ret_val;
+    char the_string[] = "Content-Type: Text/HTML";
+    char *ret_val;
 
-    ret_val = pl_startswith(the_string, "http://");
-    if (ret_val) {
-        printf("the_string, does indeed start with http://\n");
+    ret_val = pl_lower(the_string, NULL);
+    if (ret_val != NULL) {
+        printf("lower: %s\n", ret_val);
+        free(ret_val);
     }
 
-    ret_val = pl_startswith(the_string, "ftp://");
-    if (!ret_val) {
-        printf("And it does not start with ftp://\n");
-    }
+    pl_swapcase(the_string, the_string);
+    printf("swapped in place: %s\n", the_string);
+
+    printf("count_ci: %d\n", pl_count_ci(the_string, "text"));
 
     return 0;
 }
@@ -501,599 +8536,846 @@ int main() {
  *
  * \b Output
 \code{.unparsed}
-the_string, does indeed start with http://
-And it does not start with ftp://
+lower: content-type: text/html
+swapped in place: cONTENT-tYPE: tEXT/html
+count_ci: 1
 \endcode
  */
-int pl_startswith(char *string, char *prefix) {
-    char *tmp = NULL;
-    int ret_val = -1;
-    int prefix_length = 0;
-
-    if (string == NULL || prefix == NULL) {
-        goto error_exit;
+char *pl_lower(char *source, char *destination) {
+    if (source == NULL) {
+        return NULL;
     }
 
-    if (strlen(string) == 0) {
-        goto error_exit;
-    }
+    return convert_case(source, strlen(source), destination, 'A', 'Z', 1, 0);
+}
 
-    prefix_length = strlen(prefix);
 
-    if (prefix_length == 0) {
-        goto error_exit;
+/**
+ * @brief Converts the ASCII letters of a string to upper case. Works like
+ * \ref pl_lower.
+ *
+ * @param source The string you want to convert.
+ *
+ * @param destination Optional buffer with room for the string, or the string
+ * itself to convert it in place.
+ *
+ * @return Returns a pointer to the converted string. If the function fails
+ * \b NULL is returned.
+ */
+char *pl_upper(char *source, char *destination) {
+    if (source == NULL) {
+        return NULL;
     }
 
-    tmp = (char *) calloc(prefix_length + 1, sizeof(char));
-    if (tmp == NULL) {
-        goto error_exit;
-    }
+    return convert_case(source, strlen(source), destination, 'a', 'z', 1, 0);
+}
 
-    tmp = strncpy(tmp, string, prefix_length);
 
-    if (!strcmp(tmp, prefix)) {
-        ret_val = 1;
+/**
+ * @brief Swaps the case of the ASCII letters of a string. Works like
+ * \ref pl_lower.
+ *
+ * @param source The string you want to convert.
+ *
+ * @param destination Optional buffer with room for the string, or the string
+ * itself to convert it in place.
+ *
+ * @return Returns a pointer to the converted string. If the function fails
+ * \b NULL is returned.
+ */
+char *pl_swapcase(char *source, char *destination) {
+    if (source == NULL) {
+        return NULL;
     }
 
-    else {
-        ret_val = 0;
+    return convert_case(source, strlen(source), destination, 'A', 'Z', 'a', 'z');
+}
+
+
+/**
+ * @brief Case folds a string for caseless comparison. Only ASCII is folded,
+ * which makes it the same as \ref pl_lower, the full Unicode folding of
+ * Python's casefold is not done.
+ *
+ * @param source The string you want to convert.
+ *
+ * @param destination Optional buffer with room for the string, or the string
+ * itself to convert it in place.
+ *
+ * @return Returns a pointer to the folded string. If the function fails
+ * \b NULL is returned.
+ */
+char *pl_casefold_ascii(char *source, char *destination) {
+    if (source == NULL) {
+        return NULL;
     }
 
-    free(tmp);
+    return convert_case(source, strlen(source), destination, 'A', 'Z', 1, 0);
+}
 
-    return ret_val;
 
-error_exit:
-    free(tmp);
+/**
+ * @brief Binary safe version of \ref pl_lower, the source is given as a
+ * pointer and a length. The destination needs room for \a length bytes and a
+ * NUL terminator, and it can be the source to convert it in place.
+ *
+ * @param source The string you want to convert.
+ *
+ * @param length The length of the string.
+ *
+ * @param destination Optional buffer with room for the string, if it is
+ * \b NULL a new buffer is allocated.
+ *
+ * @return Returns a pointer to the converted string. If the function fails
+ * \b NULL is returned.
+ */
+char *pl_lower_n(char *source, size_t length, char *destination) {
+    return convert_case(source, length, destination, 'A', 'Z', 1, 0);
+}
 
-    return ret_val;
+
+/**
+ * @brief Binary safe version of \ref pl_upper. Works like \ref pl_lower_n.
+ *
+ * @param source The string you want to convert.
+ *
+ * @param length The length of the string.
+ *
+ * @param destination Optional buffer with room for the string.
+ *
+ * @return Returns a pointer to the converted string. If the function fails
+ * \b NULL is returned.
+ */
+char *pl_upper_n(char *source, size_t length, char *destination) {
+    return convert_case(source, length, destination, 'a', 'z', 1, 0);
 }
 
 
 /**
- * @brief Checks if a strings ends with a postfix. The function does not alter
- * the string.
+ * @brief Binary safe version of \ref pl_swapcase. Works like
+ * \ref pl_lower_n.
  *
- * @param string The string you want to check if ends with the postfix.
+ * @param source The string you want to convert.
  *
- * @param postfix The substring you want to check if the string ends with.
+ * @param length The length of the string.
  *
- * @return The function returns \b 1 if the string ends with the postfix. If the
- * string does not end with the postfix \b 0 is returned. If the function fails
- * \b -1 is returned.
+ * @param destination Optional buffer with room for the string.
  *
- * \b Example
-\code{.c}
-#include "plstr.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
+ * @return Returns a pointer to the converted string. If the function fails
+ * \b NULL is returned.
+ */
+char *pl_swapcase_n(char *source, size_t length, char *destination) {
+    return convert_case(source, length, destination, 'A', 'Z', 'a', 'z');
+}
 
 
-int main() {
-    char the_string[] = "http://google.com";
-    int ret_val;
+/**
+ * @brief Binary safe version of \ref pl_casefold_ascii. Works like
+ * \ref pl_lower_n.
+ *
+ * @param source The string you want to convert.
+ *
+ * @param length The length of the string.
+ *
+ * @param destination Optional buffer with room for the string.
+ *
+ * @return Returns a pointer to the folded string. If the function fails
+ * \b NULL is returned.
+ */
+char *pl_casefold_ascii_n(char *source, size_t length, char *destination) {
+    return convert_case(source, length, destination, 'A', 'Z', 1, 0);
+}
 
-    ret_val = pl_endswith(the_string, ".com");
-    if (ret_val) {
-            printf("the_string, does indeed end with .com\n");
-    }
 
-    ret_val = pl_endswith(the_string, ".net");
-    if (!ret_val) {
-            printf("And it does not end with .net\n");
+/**
+ * @brief Case insensitive version of \ref pl_count. ASCII letters are folded
+ * inside the search kernel, so no lower cased copy of the string is made.
+ *
+ * @param the_string The string you want to search.
+ *
+ * @param word The sub string you want to search the string for.
+ *
+ * @return Returns the number of occurences of the sub string. If the function
+ * fails \b -1 is returned.
+ */
+int pl_count_ci(char *the_string, char *word) {
+    if (the_string == NULL || word == NULL) {
+        return -1;
     }
 
-    return 0;
+    return (int) pl_count_ci_n(the_string, strlen(the_string), word,
+                               strlen(word));
 }
-\endcode
+
+
+/**
+ * @brief Binary safe version of \ref pl_count_ci, the string and the word are
+ * given as a pointer and a length.
  *
- * \b Output
-\code{.unparsed}
-the_string, does indeed end with .com
-And it does not end with .net
-\endcode
+ * @param the_string The string you want to search.
+ *
+ * @param length The length of the string.
+ *
+ * @param word The sub string you want to search the string for.
+ *
+ * @param word_length The length of the sub string.
+ *
+ * @return Returns the number of occurences of the sub string. If the function
+ * fails \b -1 is returned.
  */
-int pl_endswith(char *string, char *postfix) {
-    char *pch = NULL;
-    int ret_val = -1;
-    int string_length = 0, postfix_length = 0;
-
-    if (string == NULL || postfix == NULL) {
-        goto error_exit;
+ptrdiff_t pl_count_ci_n(char *the_string, size_t length, char *word,
+                        size_t word_length) {
+    if (the_string == NULL || word == NULL || length == 0 || word_length == 0) {
+        return -1;
     }
 
-    string_length = strlen(string);
-    postfix_length = strlen(postfix);
+    char *pch = the_string, *end = the_string + length;
+    ptrdiff_t count = 0;
 
-    if (string_length == 0 || postfix_length == 0) {
-        goto error_exit;
+    while ((pch = find_ci_kernel(pch, end - pch, word, word_length)) != NULL) {
+        pch += word_length;
+        count++;
     }
 
-    pch = string + string_length - postfix_length;
+    return count;
+}
 
-    if (!strcmp(pch, postfix)) {
-        ret_val = 1;
-    }
 
-    else {
-        ret_val = 0;
+/**
+ * @brief Case insensitive version of \ref pl_startswith, only ASCII letters
+ * are folded.
+ *
+ * @param string The string you want to check.
+ *
+ * @param prefix The substring you want to check if the string starts with.
+ *
+ * @return Returns \b 1 if the string starts with the prefix, returns \b 0 if it
+ * does not. If the function fails \b -1 is returned.
+ */
+int pl_startswith_ci(char *string, char *prefix) {
+    if (string == NULL || prefix == NULL) {
+        return -1;
     }
 
-    return ret_val;
-
-error_exit:
-
-    return ret_val;
+    return pl_startswith_ci_n(string, strlen(string), prefix, strlen(prefix));
 }
 
 
 /**
- * @brief This function handls the logic for the pl_split function for the cases
- * where the chars parameter is empty.
+ * @brief Binary safe version of \ref pl_startswith_ci, both strings are given
+ * as a pointer and a length.
+ *
+ * @param string The string you want to check.
+ *
+ * @param length The length of the string.
+ *
+ * @param prefix The substring you want to check if the string starts with.
+ *
+ * @param prefix_length The length of the prefix.
+ *
+ * @return Returns \b 1 if the string starts with the prefix, returns \b 0 if it
+ * does not. If the function fails \b -1 is returned.
  */
-static char *strip_empty_chars(char *string) {
-    char *offset = NULL, *limit = NULL, *ret_val;
-    int i;
-    int string_length = 0;
-
-    if (string == NULL)  {
-        goto error_exit;
+int pl_startswith_ci_n(char *string, size_t length, char *prefix,
+                       size_t prefix_length) {
+    if (string == NULL || prefix == NULL || length == 0 || prefix_length == 0) {
+        return -1;
     }
 
-    string_length = strlen(string);
-
-    if (string_length == 0) {
-        goto error_exit;
+    if (prefix_length > length) {
+        return 0;
     }
 
-    for (i = 0; i < string_length; i++) {
-        switch ((int) string[i]) {
-            case '\n':
-                break;
-            case '\r':
-                break;
-            case '\t':
-                break;
-            case '\v':
-                break;
-            case '\f':
-                break;
-            case ' ':
-                break;
-            default:
-                offset = string + i;
-                i = string_length;
-                break;
+    for (size_t i = 0; i < prefix_length; i++) {
+        if (fold_ascii(string[i]) != fold_ascii(prefix[i])) {
+            return 0;
         }
     }
 
-    // Cannot start comparison at the null terminator.
-    for (i = string_length - 1; i >= 0; i--) {
-        switch ((int) string[i]) {
-            case '\n':
-                break;
-            case '\r':
-                break;
-            case '\t':
-                break;
-            case '\v':
-                break;
-            case '\f':
-                break;
-            case ' ':
-                break;
-            default:
-                limit = string + i;
-                i = 0;
-                break;
-        }
+    return 1;
+}
+
+
+/**
+ * @brief Case insensitive version of \ref pl_find, only ASCII letters are
+ * folded. The arguments work the same way as for \ref pl_find.
+ *
+ * @param string The string you want to search.
+ *
+ * @param sub The sub string you want to find.
+ *
+ * @param start The offset where the search starts.
+ *
+ * @param end The offset where the search ends.
+ *
+ * @return Returns the offset of the sub string from the start of the string.
+ * If the sub string is not found, or if the function fails \b -1 is returned.
+ */
+int pl_find_ci(char *string, char *sub, int start, int end) {
+    if (string == NULL || sub == NULL) {
+        return -1;
     }
 
-    ret_val = (char *) calloc(limit - offset + 2, sizeof(char));
-    if (ret_val == NULL) {
-        goto error_exit;
+    return (int) pl_find_ci_n(string, strlen(string), sub, strlen(sub), start,
+                              end);
+}
+
+
+/**
+ * @brief Binary safe version of \ref pl_find_ci, the arguments are the same
+ * as for \ref pl_find_n.
+ *
+ * @return Returns the offset of the sub string from the start of the string.
+ * If the sub string is not found, or if the function fails \b -1 is returned.
+ */
+ptrdiff_t pl_find_ci_n(char *string, size_t length, char *sub,
+                       size_t sub_length, ptrdiff_t start, ptrdiff_t end) {
+    if (string == NULL || sub == NULL) {
+        return -1;
     }
 
-    strncpy(ret_val, offset, limit - offset + 1);
+    adjust_indices(&start, &end, length);
 
-    return ret_val;
+    if (start > (ptrdiff_t) length || end < start ||
+        (size_t) (end - start) < sub_length) {
+        return -1;
+    }
 
-error_exit:
-    free (ret_val);
+    char *pch = find_ci_kernel(string + start, end - start, sub, sub_length);
 
-    return ret_val;
+    return pch == NULL ? -1 : pch - string;
 }
 
 
 /**
- * @brief This is function handels logic for the pl_strip function when the
- * chars parameter is not empty.
+ * @brief Stores a string in a small string, inline if it fits and in a heap
+ * buffer if it does not. Returns \b -1 if the heap buffer can not be allocated.
  */
-static char *strip_with_chars(char *string, char *chars) {
-    char *ret_val = NULL, *offset = NULL, *limit = NULL;
-    int i, x, found = 0;
-    int string_length = 0, chars_length = 0;
+static int sstr_set(pl_sstr *sstr, char *data, size_t length) {
+    if (length <= PL_SSTR_INLINE) {
+        memcpy(sstr->u.inline_data, data, length);
+        sstr->u.inline_data[length] = '\0';
+        sstr->u.inline_data[PL_SSTR_INLINE + 1] = (char) length;
 
-    if (string == NULL || chars == NULL) {
-        goto error_exit;
+        return 0;
     }
 
-    string_length = strlen(string);
-    chars_length = strlen(chars);
+    char *tmp = (char *) malloc(length + 1);
+    if (tmp == NULL) {
+        sstr->u.inline_data[0] = '\0';
+        sstr->u.inline_data[PL_SSTR_INLINE + 1] = 0;
 
-    if (string_length == 0 || chars_length == 0) {
-        goto error_exit;
+        return -1;
     }
 
-    for (i = 0; i < string_length; i++) {
-        for (x = 0; x < chars_length; x++) {
-            if (string[i] == chars[x]) {
-                found = 1;
-            }
-        }
+    memcpy(tmp, data, length);
+    tmp[length] = '\0';
+
+    sstr->u.heap.ptr = tmp;
+    sstr->u.heap.length = length;
+    sstr->u.inline_data[PL_SSTR_INLINE + 1] = (char) PL_SSTR_HEAP;
+
+    return 0;
+}
+
+
+static int sstr_on_heap(pl_sstr *sstr) {
+    return (unsigned char) sstr->u.inline_data[PL_SSTR_INLINE + 1] == PL_SSTR_HEAP;
+}
 
-        if (!found) {
-            offset = string + i;
-            break;
-        }
 
-        found = 0;
+/**
+ * @brief Returns the NUL terminated contents of a small string. Strings of up
+ * to \b PL_SSTR_INLINE bytes are stored inside the struct itself, so the
+ * pointer is only valid as long as the struct is.
+ *
+ * @param sstr The small string.
+ *
+ * @return Returns a pointer to the string. If the function fails \b NULL is
+ * returned.
+ */
+char *pl_sstr_data(pl_sstr *sstr) {
+    if (sstr == NULL) {
+        return NULL;
     }
 
-    found = 0;
-    // Cant start comparing the null terminator as it is not striped.
-    for (i = string_length - 1; i >= 0; i--) {
-        for (x = 0; x < chars_length; x++) {
-            if (string[i] == chars[x]) {
-                found = 1;
-            }
-        }
+    return sstr_on_heap(sstr) ? sstr->u.heap.ptr : sstr->u.inline_data;
+}
 
-        if (!found) {
-            limit = string + i;
-            break;
-        }
 
-        found = 0;
+/**
+ * @brief Returns the length of a small string without scanning it.
+ *
+ * @param sstr The small string.
+ *
+ * @return Returns the length of the string. If the function fails \b 0 is
+ * returned.
+ */
+size_t pl_sstr_len(pl_sstr *sstr) {
+    if (sstr == NULL) {
+        return 0;
     }
 
-    ret_val = (char *) calloc(limit - offset + 2, sizeof(char));
-    if (ret_val == NULL) {
-        goto error_exit;
+    if (sstr_on_heap(sstr)) {
+        return sstr->u.heap.length;
     }
 
-    strncpy(ret_val, offset, limit - offset + 1);
+    return (unsigned char) sstr->u.inline_data[PL_SSTR_INLINE + 1];
+}
 
-    return ret_val;
 
-error_exit:
-    return ret_val;
+/**
+ * @brief Frees the heap buffer of a small string, if it has one, and leaves it
+ * as an empty string. The struct itself is not freed.
+ */
+void pl_sstr_free(pl_sstr *sstr) {
+    if (sstr == NULL) {
+        return;
+    }
+
+    if (sstr_on_heap(sstr)) {
+        free(sstr->u.heap.ptr);
+    }
+
+    sstr->u.inline_data[0] = '\0';
+    sstr->u.inline_data[PL_SSTR_INLINE + 1] = 0;
 }
 
 
 /**
- * @brief This function strips characters from a string. The default behaviour
- * if chars is \b NULL or empty string is to strip whitespace characters from
- * either end of the string. The characters removed is '\\n \\r \\t \\v \\f' and
- * the space character. If the chars parameter contains characters those
- * characters are removed from either side of the string.
+ * @brief Frees an array of small strings returned by \ref pl_split_sstr,
+ * including the heap buffers of the strings that did not fit inline.
+ */
+void pl_sstr_free_array(pl_sstr *array, int size) {
+    if (array == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < size; i++) {
+        pl_sstr_free(&array[i]);
+    }
+
+    free(array);
+}
+
+
+/**
+ * @brief Splits a string like \ref pl_split, but returns the tokens as an
+ * array of small strings. Tokens of up to \b PL_SSTR_INLINE bytes are stored
+ * inside the array, so a split of short tokens costs a single allocation and
+ * 24 bytes per token instead of one allocation per token.
  *
- * You need to free the returned buffer after use.
+ * You need to free the returned array with \ref pl_sstr_free_array after use.
  *
- * @param string The string you want to split.
+ * @param string The string you want to split up.
  *
- * @param chars The characters you want to strip from the string. If the
- * parameter is empty or \b NULL whitespace is removed from either side.
+ * @param delim The delimiter you want to use.
  *
- * @return The function returns a pointer to the string with the characters
- * removed. If the function fails \b NULL is returned.
+ * @param size This will be set to the size of the returned array.
+ *
+ * @return Returns an array of small strings. If the delimiter is not found, or
+ * if the function fails \b NULL is returned.
  *
  * \b Example
 \code{.c}
 #include "plstr.h"
-#include <stdlib.h>
 #include <stdio.h>
-#include <string.h>
+#include <stdlib.h>
 
 
 int main() {
-    char whitespace[] = "   lots of space   ";
-    char cool_nick[] = "xxxxTheDude99xxxx";
-    char *ret_val = NULL;
+    char the_string[] = "GET,/index.html,200,a-token-that-does-not-fit-inline";
+    pl_sstr *tokens;
+    int size;
 
-    ret_val = pl_strip(whitespace, NULL);
-    if (ret_val != NULL) {
-        printf("Original: %s\nStriped: %s\n", whitespace, ret_val);
-        free(ret_val);
-    }
+    tokens = pl_split_sstr(the_string, ",", &size);
+    if (tokens != NULL) {
+        for (int i = 0; i < size; i++) {
+            printf("%d: %s (%d)\n", i, pl_sstr_data(&tokens[i]),
+                    (int) pl_sstr_len(&tokens[i]));
+        }
 
-    ret_val = pl_strip(cool_nick, "x");
-    if (ret_val != NULL) {
-        printf("Striped: %s\n", ret_val);
-        free(ret_val);
+        pl_sstr_free_array(tokens, size);
     }
 
-
     return 0;
 }
 \endcode
  *
  * \b Output
 \code{.unparsed}
-Original:    lots of space
-Striped: lots of space
-Striped: TheDude99
+0: GET (3)
+1: /index.html (11)
+2: 200 (3)
+3: a-token-that-does-not-fit-inline (32)
 \endcode
  */
-char *pl_strip(char *string, char *chars) {
-    if (string == NULL || strlen(string) == 0) {
+pl_sstr *pl_split_sstr(char *string, char *delim, int *size) {
+    if (string == NULL || delim == NULL || size == NULL) {
         return NULL;
     }
 
-    if (chars == NULL || strlen(chars) == 0) {
-        return strip_empty_chars(string);
+    size_t count;
+    pl_sstr *ret_val = pl_split_sstr_n(string, strlen(string), delim,
+                                       strlen(delim), &count);
+
+    if (ret_val != NULL) {
+        *size = (int) count;
     }
 
-    return strip_with_chars(string, chars);
+    return ret_val;
 }
 
 
 /**
- * @brief This function handels the cases for pl_translate where there is no
- * table. It should not be called directly, call pl_translate with the table
- * parameter set as NULL instead.
+ * @brief Binary safe version of \ref pl_split_sstr, the string and the
+ * delimiter are given as a pointer and a length.
+ *
+ * You need to free the returned array with \ref pl_sstr_free_array after use.
+ *
+ * @param string The string you want to split up.
+ *
+ * @param string_length The length of the string.
+ *
+ * @param delim The delimiter you want to use.
+ *
+ * @param delim_length The length of the delimiter.
+ *
+ * @param size This will be set to the size of the returned array.
+ *
+ * @return Returns an array of small strings. If the delimiter is not found, or
+ * if the function fails \b NULL is returned.
  */
-static char *translate_no_table(char *string, char *deletechars) {
-    if (string == NULL || deletechars == NULL ||
-        strlen(string) == 0 || strlen(deletechars) == 0) {
+pl_sstr *pl_split_sstr_n(char *string, size_t string_length, char *delim,
+                         size_t delim_length, size_t *size) {
+    if (string == NULL || delim == NULL || size == NULL) {
         return NULL;
     }
 
-    int string_length = 0, deletechars_length = 0;
+    if (string_length == 0 || delim_length == 0) {
+        return NULL;
+    }
 
-    string_length = strlen(string);
-    deletechars_length = strlen(deletechars);
+    char *pch = string, *end = string + string_length;
+    size_t delims = 0;
 
-    int found = 0;
-    for (int i = 0; i < string_length; i++) {
-        for (int x = 0; x < deletechars_length; x++) {
-            if (string[i] == deletechars[x]) {
-                found++;
-            }
-        }
+    while ((pch = find_kernel(pch, end - pch, delim, delim_length)) != NULL) {
+        pch += delim_length;
+        delims++;
     }
 
+    if (delims == 0) {
+        return NULL;
+    }
 
-    char *tmp = (char *) calloc(string_length - found + 1, sizeof(char));
-    if (tmp == NULL) {
+    pl_sstr *ret_val = (pl_sstr *) calloc(delims + 1, sizeof(pl_sstr));
+    if (ret_val == NULL) {
         return NULL;
     }
 
+    char *offset = string;
+    for (size_t i = 0; i < delims; i++) {
+        pch = find_kernel(offset, end - offset, delim, delim_length);
 
-    int idx = 0;
-    for (int i = 0; i < string_length; i++) {
-        int delete = 0;
+        if (sstr_set(&ret_val[i], offset, pch - offset) == -1) {
+            pl_sstr_free_array(ret_val, delims + 1);
 
-        for (int x = 0; x < deletechars_length; x++) {
-            if (string[i] == deletechars[x]) {
-                delete = 1;
-            }
+            return NULL;
         }
 
-        if (!delete) {
-            tmp[idx] = string[i];
-            idx++;
-        }
+        offset = pch + delim_length;
     }
 
-    return tmp;
+    if (sstr_set(&ret_val[delims], offset, end - offset) == -1) {
+        pl_sstr_free_array(ret_val, delims + 1);
+
+        return NULL;
+    }
+
+    *size = delims + 1;
+
+    return ret_val;
 }
 
 
 /**
- * @brief This function handels the logic for the pl_translate function in the
- * cases where the table parameter is not empty. Do not call this function
- * directly, call pl_translate instead.
+ * @brief Strips a string like \ref pl_strip, but stores the result in a small
+ * string, so short results do not allocate.
+ *
+ * @param string The string you want to strip.
+ *
+ * @param chars The characters you want to strip from the string. If the
+ * parameter is empty or \b NULL whitespace is removed from either side.
+ *
+ * @param out The small string the result is stored in. Free it with
+ * \ref pl_sstr_free after use.
+ *
+ * @return Returns \b 0 if successful. If the function fails \b -1 is returned.
  */
-static char *translate_with_table(char *string, unsigned char *table, char *deletechars) {
-    char *tmp = NULL, *ret_val = NULL;
-    char swap_table[256];
-    int i;
-
-    if (string == NULL || table == NULL || deletechars == NULL) {
-        goto error_exit;
+int pl_strip_sstr(char *string, char *chars, pl_sstr *out) {
+    if (string == NULL) {
+        return -1;
     }
 
-    int table_size = strlen((char *) table);
+    return pl_strip_sstr_n(string, strlen(string), chars,
+                           chars == NULL ? 0 : strlen(chars), out);
+}
 
-    if (strlen(string) == 0 || table_size == 0 || strlen(deletechars) == 0) {
-        goto error_exit;
-    }
 
-    if (table_size != strlen(deletechars)) {
-        goto error_exit;
+/**
+ * @brief Binary safe version of \ref pl_strip_sstr, the string and the
+ * characters are given as a pointer and a length.
+ *
+ * @param string The string you want to strip.
+ *
+ * @param length The length of the string.
+ *
+ * @param chars The characters you want to strip from the string. If the
+ * parameter is empty or \b NULL whitespace is removed from either side.
+ *
+ * @param chars_length The number of characters.
+ *
+ * @param out The small string the result is stored in. Free it with
+ * \ref pl_sstr_free after use.
+ *
+ * @return Returns \b 0 if successful. If the function fails \b -1 is returned.
+ */
+int pl_strip_sstr_n(char *string, size_t length, char *chars,
+                    size_t chars_length, pl_sstr *out) {
+    if (string == NULL || out == NULL || length == 0) {
+        return -1;
     }
 
-    for (i = 0; i < 256; i++) {
-        swap_table[i] = i;
-    }
+    size_t begin, end;
+    strip_bounds(string, length, chars, chars == NULL ? 0 : chars_length,
+                 &begin, &end);
 
-    for (i = 0; i < table_size; i++) {
-        swap_table[(int) table[i]] = deletechars[i];
-    }
+    return sstr_set(out, string + begin, end - begin);
+}
 
-    tmp = pl_cpy(string, NULL);
-    if (tmp == NULL) {
-        goto error_exit;
-    }
 
-    for (i = 0; i < strlen(tmp); i++) {
-        tmp[i] = swap_table[(int) tmp[i]];
+/**
+ * @brief Slices a string like \ref pl_slice, but stores the result in a small
+ * string, so short results do not allocate.
+ *
+ * @param source The string you want to slice.
+ *
+ * @param offset The offset you want to slice from.
+ *
+ * @param limit The limit you want to slice too.
+ *
+ * @param out The small string the result is stored in. Free it with
+ * \ref pl_sstr_free after use.
+ *
+ * @return Returns \b 0 if successful. In the cases where \ref pl_slice returns
+ * \b NULL \b -1 is returned.
+ */
+int pl_slice_sstr(char *source, int offset, int limit, pl_sstr *out) {
+    if (source == NULL) {
+        return -1;
     }
 
-    ret_val = tmp;
-
-    return ret_val;
-
-error_exit:
-    free(tmp);
-
-    return ret_val;
+    return pl_slice_sstr_n(source, strlen(source), offset, limit, out);
 }
 
 
 /**
- * @brief This function implements the behaviour of python string translate
- * method. This function has two different behaviours. It either deletes
- * characters from the string, or switches out the characters with the ones
- * set in the table.
+ * @brief Binary safe version of \ref pl_slice_sstr, the string is given as a
+ * pointer and a length.
  *
- * If the table parameter, is \b NULL the characters passed in the deletechars
- * parameter are removed from the string. If you pass it the string
- * <a> 'read this short text'</a>, and deletechars is \a 'aeiou', the returned
- * string is <a>'rd ths shrt txt'</a>.
+ * @param source The string you want to slice.
  *
- * If the table parameter is not empty, every occurrence of one of the table
- * characters is replaced with the character in deletechars at the same index.
- * So if the same string is passed <a>'read this short text'</a>, and the table
- * is \a 'xxxxx', and deletechars is \a 'aeiou' the returned string is
- * <a>'rxxd thxs shxrt txxt'</a>. The length of the table and deletechars needs
- * to be of the same length, or else the function will return \b NULL.
+ * @param length The length of the string.
  *
- * You need to free the returned buffer after use.
+ * @param offset The offset you want to slice from.
  *
- * @param string The string you want to translate.
+ * @param limit The limit you want to slice too.
  *
- * @param table Optional parameter, if set it is used to swap the characters
- * passed in the deletechars parameter. If not every occurrence of the characters
- * passed in deletechars is removed from the string.
+ * @param out The small string the result is stored in. Free it with
+ * \ref pl_sstr_free after use.
  *
- * @param deletechars The characters in the parameter is removed or swapped out
- * from the string. If the table parameter is used this parameter and table
- * needs to be of equal size.
+ * @return Returns \b 0 if successful. In the cases where \ref pl_slice returns
+ * \b NULL \b -1 is returned.
+ */
+int pl_slice_sstr_n(char *source, size_t length, ptrdiff_t offset,
+                    ptrdiff_t limit, pl_sstr *out) {
+    if (source == NULL || out == NULL) {
+        return -1;
+    }
+
+    size_t begin, end;
+
+    if (slice_bounds(length, offset, limit, &begin, &end) == -1) {
+        return -1;
+    }
+
+    return sstr_set(out, source + begin, end - begin);
+}
+
+
+/**
+ * @brief A reference counted string. The string is stored right after the
+ * header, so it takes a single allocation, and it is never modified after it
+ * is created, so it can be read from many threads at once.
+ */
+struct pl_rcstr {
+    size_t refs;
+    size_t length;
+    char data[];
+};
+
+
+/**
+ * @brief Creates a reference counted string holding a copy of a string. The
+ * string starts with one reference, which is dropped with
+ * \ref pl_rcstr_release. Hand it to another thread by calling
+ * \ref pl_rcstr_retain first, and let that thread release it when it is done.
  *
- * @return Returns a pointer to the new string with the deleted/swapped out
- * characters. If the function fails \b NULL is returned.
+ * @param string The string you want to copy, it can contain NUL bytes.
  *
- * \b Example
-\code{.c}
-#include "plstr.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
+ * @param length The length of the string.
+ *
+ * @return Returns the new string. If the function fails \b NULL is returned.
+ */
+pl_rcstr *pl_rcstr_new(char *string, size_t length) {
+    if (string == NULL || length > SIZE_MAX - sizeof(pl_rcstr) - 1) {
+        return NULL;
+    }
 
+    pl_rcstr *ret_val = (pl_rcstr *) malloc(sizeof(pl_rcstr) + length + 1);
+    if (ret_val == NULL) {
+        return NULL;
+    }
 
-int main() {
-    char the_string[] = "read this short text";
-    char *ret_val = NULL;
+    ret_val->refs = 1;
+    ret_val->length = length;
+    memcpy(ret_val->data, string, length);
+    ret_val->data[length] = '\0';
 
-    ret_val = pl_translate(the_string, NULL, "aeiou");
-    if (ret_val != NULL) {
-        printf("the_string: %s\nno table:%s\n", the_string, ret_val);
-        free(ret_val);
-    }
+    return ret_val;
+}
 
-    ret_val = pl_translate(the_string, "aeiou", "xxxxx");
-    if (ret_val != NULL) {
-        printf("with table: %s\n", ret_val);
-        free(ret_val);
+
+/**
+ * @brief Takes another reference to a reference counted string. It is safe
+ * to call from any thread that already holds a reference.
+ *
+ * @param rcstr The string.
+ *
+ * @return Returns \a rcstr, so the call can be used in an assignment.
+ */
+pl_rcstr *pl_rcstr_retain(pl_rcstr *rcstr) {
+    if (rcstr != NULL) {
+        __atomic_add_fetch(&rcstr->refs, 1, __ATOMIC_RELAXED);
     }
 
-    return 0;
+    return rcstr;
 }
-\endcode
+
+
+/**
+ * @brief Drops a reference to a reference counted string, and frees it when
+ * the last reference is dropped. The string must not be used after its
+ * reference is released.
  *
- * \b Output
-\code{.unparsed}
-the_string: read this short text
-no table:rd ths shrt txt
-with table: rxxd thxs shxrt txxt
-\endcode
+ * @param rcstr The string.
  */
-char *pl_translate(char *string, unsigned char *table, char *deletechars) {
-    if (string == NULL || deletechars == NULL) {
-        return NULL;
+void pl_rcstr_release(pl_rcstr *rcstr) {
+    if (rcstr == NULL) {
+        return;
     }
 
-    if (strlen(string) == 0 || strlen(deletechars) == 0) {
-        return NULL;
+    if (__atomic_sub_fetch(&rcstr->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(rcstr);
     }
+}
 
-    if (table != NULL && strlen((char *) table) == 0) {
-        return NULL;
+
+/**
+ * @brief Releases every string in an array returned by \ref pl_split_rc, and
+ * frees the array. Strings that were retained stay valid.
+ */
+void pl_rcstr_release_array(pl_rcstr **array, int size) {
+    if (array == NULL) {
+        return;
     }
 
-    if (table == NULL) {
-        return translate_no_table(string, deletechars);
+    for (int i = 0; i < size; i++) {
+        pl_rcstr_release(array[i]);
     }
 
-    return translate_with_table(string, table, deletechars);
+    free(array);
 }
 
 
 /**
- * @brief This function splits up a string when a newline character is found.
+ * @brief Returns the NUL terminated contents of a reference counted string.
+ * The contents are shared with every other holder of the string, possibly
+ * other threads, so the pointer is \b const. Writing through it, after
+ * casting the \b const away, is undefined behaviour.
  *
- * The function is very similar to the split function but the results are a bit
- * different. It splits up a string whenever it finds the \a \\n or \a \\r character.
- * If the keepends parameter is set the function will not remove the newline
- * from the string.
+ * @param rcstr The string.
  *
- * If the string <a>"first\nsecond\n\nfourth"</a> is passed the results will be:
- * <a>["first", "second", "", "fourth"] </a>. If the keepends parameter is set
- * the results of the same string would be:
- * <a>["first\n", "second\n", "\n", "fourth\n"]</a>
+ * @return Returns a pointer to the string. If the function fails \b NULL is
+ * returned.
+ */
+const char *pl_rcstr_data(pl_rcstr *rcstr) {
+    return rcstr == NULL ? NULL : rcstr->data;
+}
+
+
+/**
+ * @brief Returns the length of a reference counted string without scanning
+ * it.
  *
- * This function allocates memory, the returned pointer should be freed after
+ * @param rcstr The string.
+ *
+ * @return Returns the length of the string. If the function fails \b 0 is
+ * returned.
+ */
+size_t pl_rcstr_len(pl_rcstr *rcstr) {
+    return rcstr == NULL ? 0 : rcstr->length;
+}
+
+
+/**
+ * @brief Splits a string like \ref pl_split, but returns the tokens as
+ * reference counted strings, so they can be handed to several threads
+ * without copying them.
+ *
+ * You need to free the returned array with \ref pl_rcstr_release_array after
  * use.
  *
- * @param the_string The string you want to split.
+ * @param string The string you want to split up.
  *
- * @param keepends If set to \a 1 the newlines will be appended, if not the
- * will be removed.
+ * @param delim The delimiter you want to use.
  *
- * @param size This parameter will be changed to the size of the returned
- * string array.
+ * @param size This will be set to the size of the returned array.
  *
- * @return The function will return a array of strings if successful, if the
- * function fails \b NULL will be returned.
+ * @return Returns an array of reference counted strings. If the delimiter is
+ * not found, or if the function fails \b NULL is returned.
  *
  * \b Example
 \code{.c}
 #include "plstr.h"
 #include <stdio.h>
-#include <stdlib.h>
 
 
 int main() {
-    char **ret_val = NULL;
-    int size = 0;
-
-    ret_val = pl_splitlines("first\nsecond\n\nfourth", 0, &size);
-    if (ret_val != NULL) {
-        int i;
-
-        for (i = 0; i < size; i++) {
-            printf("%d: %s ", i, ret_val[i]);
-            free(ret_val[i]);
-        }
+    char the_string[] = "GET,/index.html,200";
+    pl_rcstr **tokens, *path = NULL;
+    int size;
 
-        free(ret_val);
-        printf("\n\n");
+    tokens = pl_split_rc(the_string, ",", &size);
+    if (tokens != NULL) {
+        // Keep the path after the rest of the tokens are released.
+        path = pl_rcstr_retain(tokens[1]);
+        pl_rcstr_release_array(tokens, size);
     }
 
-    ret_val = pl_splitlines("first\nsecond\n\nfourth", 1, &size);
-    if (ret_val != NULL ) {
-        int i;
-
-        for (i = 0; i < size; i++) {
-            printf("%d: %s\n", i, ret_val[i]);
-            free(ret_val[i]);
-        }
-
-        printf("\n");
-        free(ret_val);
+    if (path != NULL) {
+        printf("%s (%d)\n", pl_rcstr_data(path), (int) pl_rcstr_len(path));
+        pl_rcstr_release(path);
     }
 
     return 0;
@@ -1102,266 +9384,113 @@ int main() {
  *
  * \b Output
 \code{.unparsed}
-0: first 1: second 2:  3: fourth
-
-0: first
-
-1: second
-
-2:
-
-3: fourth
-
+/index.html (11)
 \endcode
  */
-char **pl_splitlines(char *the_string, int keepends, int *size) {
-    if (the_string == NULL) {
+pl_rcstr **pl_split_rc(char *string, char *delim, int *size) {
+    if (string == NULL || delim == NULL || size == NULL) {
         return NULL;
     }
 
-    int string_length = strlen(the_string);
+    size_t string_length = strlen(string);
+    size_t delim_length = strlen(delim);
 
-    if (string_length == 0) {
+    if (string_length == 0 || delim_length == 0) {
         return NULL;
     }
 
-    // Count the number of lines.
+    char *pch = string, *end = string + string_length;
     int delims = 0;
-    for (int i = 0; i < string_length; i++) {
-        // 10 and 13 is the int value of \n and \r
-        if ((int) the_string[i] == '\n' || (int) the_string[i] == '\r') {
-            delims++;
-        }
+
+    while ((pch = find_kernel(pch, end - pch, delim, delim_length)) != NULL) {
+        pch += delim_length;
+        delims++;
     }
 
-    // Nothing todo.
     if (delims == 0) {
         return NULL;
     }
 
-    char **ret_val = NULL, *pch = NULL, *tmp = NULL;
-
-    ret_val = (char **) calloc(delims + 1, sizeof(char *));
+    pl_rcstr **ret_val = (pl_rcstr **) calloc(delims + 1, sizeof(pl_rcstr *));
     if (ret_val == NULL) {
-        goto error_exit;
+        return NULL;
     }
 
+    char *offset = string;
+    for (int i = 0; i < delims; i++) {
+        pch = find_kernel(offset, end - offset, delim, delim_length);
 
-    pch = the_string;
-    int idx = 0;
-    for (int i = 0; i < string_length; i++) {
-        if ((int) the_string[i] == '\n' || (int) the_string[i] == '\r') {
-            int len = (the_string + i) - pch;
-
-            if (keepends) {
-                len++;
-            }
-
-            tmp = (char *) calloc(len + 1, sizeof(char));
-            if (tmp == NULL) {
-                goto error_exit;
-            }
+        ret_val[i] = pl_rcstr_new(offset, pch - offset);
+        if (ret_val[i] == NULL) {
+            pl_rcstr_release_array(ret_val, delims + 1);
 
-            strncpy(tmp, pch, len);
-            pch = the_string + i + 1;
-            ret_val[idx] = tmp;
-            idx++;
+            return NULL;
         }
-    }
 
-    tmp = (char *) calloc(strlen(pch) + 1, sizeof(char));
-    if (tmp == NULL) {
-        goto error_exit;
+        offset = pch + delim_length;
     }
 
-    tmp = strncpy(tmp, pch, strlen(pch));
-    ret_val[delims] = tmp;
-
-    *size = delims + 1;
-
-    return ret_val;
+    ret_val[delims] = pl_rcstr_new(offset, end - offset);
+    if (ret_val[delims] == NULL) {
+        pl_rcstr_release_array(ret_val, delims + 1);
 
-error_exit:
-    if (delims) {
-        for (int i = 0; i < delims; i++) {
-            free(ret_val[i]);
-        }
+        return NULL;
     }
 
-    free(ret_val);
-    free(tmp);
+    *size = delims + 1;
 
     return ret_val;
 }
 
 
 /**
- * @brief Counts the number of occurences of a word in a string. The word can
- * does not need to be a word in the english langauge sense, just any form of
- * sub string can be counted.
- *
- * @param the_string The string you wnat to search.
+ * @brief Strips a string like \ref pl_strip, but returns the result as a
+ * reference counted string.
  *
- * @param word The sub string you want to search the string for.
+ * @param string The string you want to strip.
  *
- * @return Returns the number of occurences of the sub string. If the function
- * fails \b -1 is returned.
+ * @param chars The characters you want to strip from the string. If the
+ * parameter is empty or \b NULL whitespace is removed from either side.
  *
- * \b Example
-\code{.c}
-#include "plstr.h"
-#include <stdio.h>
-#include <stdlib.h>
-
-
-int main() {
-    int ret_val = 0;
-
-    ret_val = pl_count("one three three seven", "three");
-    if (ret_val != -1) {
-        printf("The word 'three' was found %d times.\n", ret_val);
-    }
-
-    ret_val = pl_count("What do you get if you multiply six by nine?", "42");
-    if (ret_val == 0) {
-        printf("Apparantly not 42. I always knew something was wrong with the universe.\n");
-    }
-
-    return 0;
-}
-\endcode
- * \b Output
-\code{.unparsed}
-The word 'three' was found 2 times.
-Apparantly not 42. I always knew something was wrong with the universe.
-\endcode
+ * @return Returns the stripped string, release it with
+ * \ref pl_rcstr_release after use. If the function fails \b NULL is returned.
  */
-int pl_count(char * the_string, char *word) {
-    char *pch = the_string;
-    int count = 0;
-
-    if (the_string == NULL || word == NULL) {
-        return -1;
-    }
-
-    if (strlen(the_string) == 0 || strlen(word) == 0) {
-        return -1;
+pl_rcstr *pl_strip_rc(char *string, char *chars) {
+    if (string == NULL || *string == '\0') {
+        return NULL;
     }
 
-    do {
-        pch = strstr(pch, word);
-        if (pch != NULL) {
-            pch += strlen(word);
-            count++;
-        }
-    } while(pch != NULL);
-
-    return count;
-}
-
-
-static int next_column(int position, int tabsize) {
-    if (tabsize == 0) {
-        return 0;
-    }
+    size_t begin, end;
+    strip_bounds(string, strlen(string), chars, chars == NULL ? 0 : strlen(chars),
+                 &begin, &end);
 
-    return tabsize - (position % tabsize);
+    return pl_rcstr_new(string + begin, end - begin);
 }
 
 
 /**
- * @brief This function replaces tabs with spaces.
- *
- * The tabs are replaced with spaces ' ' up to the next column. The column width
- * is specified by the \a tabsize parameter, and the number of spaces inserted 
- * for each tab is the number of spaces needed to reach the next multiple of 
- * tabsize. The returned string is allocated on the heap, remember to free this
- * resource after use. NULL is returned in the follwoing cases: The passed string
- * points to NULL. \a tabsize has a negative value. Or the string has a length of
- * zero.
- *
- * @param the_string The string with tabs.
+ * @brief Slices a string like \ref pl_slice, but returns the result as a
+ * reference counted string.
  *
- * @param tabsize The width of the column.
+ * @param source The string you want to slice.
  *
- * @return The function returns a heap allocated buffer of the string with tabs
- * replaced. If the function fails \b NULL is returned.
+ * @param offset The offset you want to slice from.
  *
- * \b Example
-\code{.c}
-#include "plstr.h"
-#include <stdio.h>
-#include <stdlib.h>
-
-
-int main() {
-    char *ret_val;
-
-    ret_val = pl_expandtabs("tabs\tinstead\tof\tspace", 1);
-    if (ret_val != NULL) {
-        printf("tabs\tinstead\tof\tspace\n%s\n", ret_val);
-    }
-
-    free(ret_val);
-
-    return 0;
-}
-
-\endcode
+ * @param limit The limit you want to slice too.
  *
- * \b Output
-\code{.unparsed}
-tabs    instead of      space
-tabs instead of space
-\endcode
+ * @return Returns the slice, release it with \ref pl_rcstr_release after
+ * use. In the cases where \ref pl_slice returns \b NULL \b NULL is returned.
  */
-char *pl_expandtabs(char *the_string, int tabsize) {
-    char *ret_val = NULL;
-    if (the_string == NULL || tabsize < 0) {
-        goto error_exit;
-    }
-    
-    int str_len = strlen(the_string);
-    
-    if (str_len == 0) {
-        goto error_exit;
-    }
-    
-    int extra_size = 0;
-    
-    for (int i = 0; i < str_len; i++) {
-        if (the_string[i] == '\t') {
-            if (tabsize != 0) {
-                extra_size += next_column(i, tabsize);
-            }
-            
-            else {
-                extra_size--; // Save a byte!
-            }
-        }
+pl_rcstr *pl_slice_rc(char *source, int offset, int limit) {
+    if (source == NULL) {
+        return NULL;
     }
 
-    ret_val = (char *) calloc(str_len + extra_size + 1, sizeof(char));
-    if (ret_val == NULL) {
-        goto error_exit;
-    }
-    
-    for (int i = 0, idx = 0; i < str_len; i++) {
-        if (the_string[i] != '\t') {
-            ret_val[idx] = the_string[i];
-            idx++;
-        }
-        
-        else {
-            int spaces = next_column(idx, tabsize);
-            for (int x = 0; x < spaces; x++) {
-                ret_val[idx] = ' ';
-                idx++;
-            }
-        }
+    size_t begin, end;
+
+    if (slice_bounds(strlen(source), offset, limit, &begin, &end) == -1) {
+        return NULL;
     }
 
-error_exit:
-    
-    return ret_val;
+    return pl_rcstr_new(source + begin, end - begin);
 }
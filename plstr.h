@@ -26,6 +26,93 @@
 #define PLSTR_H
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+
+
+/*****************************************************************
+ *                  TYPES AND CONSTANTS                          *
+ *****************************************************************/
+
+
+#define PL_PREFIX   0
+#define PL_SUFFIX   1
+
+#define PL_END      INT_MAX
+#define PL_END_N    PTRDIFF_MAX
+
+#define PL_SLICE_NONE   PTRDIFF_MIN
+
+#define PL_CP_INDEX_STRIDE  64
+
+/*
+ * A view of part of a string. It points into the string it was taken from, is
+ * not NUL terminated, and is never freed on its own.
+ */
+typedef struct pl_span {
+    char *ptr;
+    size_t length;
+} pl_span;
+
+/*
+ * State of a split in progress, see pl_split_iter_init. It lives on the
+ * caller's stack, the fields are private.
+ */
+typedef struct pl_split_iter {
+    char *next;
+    char *end;
+    char *delim;
+    size_t delim_length;
+    int done;
+} pl_split_iter;
+
+/*
+ * Called by the CSV reader for every row, with the fields of the row, the
+ * number of fields and the argument given to pl_csv_reader_new.
+ */
+typedef int (*pl_csv_row_fn)(pl_span *, size_t, void *);
+
+typedef struct pl_csv_reader pl_csv_reader;
+
+/*
+ * A key and its value, both views into the parsed line.
+ */
+typedef struct pl_kv_pair {
+    pl_span key;
+    pl_span value;
+} pl_kv_pair;
+
+typedef struct pl_kv_filter pl_kv_filter;
+typedef struct pl_affixset pl_affixset;
+typedef struct pl_multi_pattern pl_multi_pattern;
+typedef struct pl_cp_index pl_cp_index;
+typedef struct pl_arena pl_arena;
+
+#define PL_SSTR_INLINE  22
+#define PL_SSTR_HEAP    0xFF
+
+/*
+ * A string that is stored inside the struct when it is at most
+ * PL_SSTR_INLINE bytes long, and in a heap buffer otherwise. The last byte
+ * holds the inline length, or PL_SSTR_HEAP. Use the pl_sstr_* functions to
+ * access it.
+ */
+typedef struct pl_sstr {
+    union {
+        char inline_data[PL_SSTR_INLINE + 2];
+        struct {
+            char *ptr;
+            size_t length;
+        } heap;
+    } u;
+} pl_sstr;
+
+/*
+ * An immutable string with an atomic reference count, which can be shared by
+ * several threads. Use the pl_rcstr_* functions to access it.
+ */
+typedef struct pl_rcstr pl_rcstr;
 
 
 /*****************************************************************
@@ -33,7 +120,17 @@
  *****************************************************************/
 
 
+int     pl_set_isa(char *);
+char    *pl_get_isa(void);
+int     pl_cache_enable(int);
+void    pl_cache_disable(void);
+
 char    *pl_cpy(char *, char *);
+int     pl_cpy_n(char *, size_t, char *, size_t, size_t *);
+pl_arena *pl_arena_new(size_t);
+void    pl_arena_reset(pl_arena *);
+void    pl_arena_free(pl_arena *);
+char    *pl_dup_into_arena(pl_arena *, char *, size_t);
 char    *pl_slice(char *, int, int);
 char    *pl_cat(char *, char *);
 char    **pl_split(char *, char *, int *);
@@ -44,5 +141,126 @@ char    *pl_translate(char *, unsigned char *, char *);
 char    **pl_splitlines(char *, int , int *);
 int     pl_count(char *, char *);
 char    *pl_expandtabs(char *, int);
+int     pl_startswith_any(char *, char **, int);
+int     pl_endswith_any(char *, char **, int);
+int     pl_find(char *, char *, int, int);
+int     pl_rfind(char *, char *, int, int);
+int     pl_index(char *, char *, int, int);
+int     pl_rindex(char *, char *, int, int);
+int     pl_contains(char *, char *);
+int     pl_split_iter_init(pl_split_iter *, char *, char *);
+int     pl_split_iter_init_n(pl_split_iter *, char *, size_t, char *, size_t);
+int     pl_split_iter_next(pl_split_iter *, pl_span *);
+char    **pl_rsplit(char *, char *, int, int *);
+char    **pl_rsplit_n(char *, size_t, char *, size_t, ptrdiff_t, size_t *, size_t **);
+char    **pl_split_ws(char *, int *);
+char    **pl_split_ws_n(char *, size_t, size_t *);
+ptrdiff_t pl_split_ws_spans(char *, size_t, pl_span *, size_t);
+int     pl_partition(char *, char *, pl_span *);
+int     pl_partition_n(char *, size_t, char *, size_t, pl_span *);
+int     pl_rpartition(char *, char *, pl_span *);
+int     pl_rpartition_n(char *, size_t, char *, size_t, pl_span *);
+ptrdiff_t pl_partition_many(char **, size_t, char *, pl_span *);
+
+pl_csv_reader *pl_csv_reader_new(char, char, pl_csv_row_fn, void *);
+int     pl_csv_reader_feed(pl_csv_reader *, char *, size_t);
+int     pl_csv_reader_finish(pl_csv_reader *);
+void    pl_csv_reader_free(pl_csv_reader *);
+
+pl_kv_filter *pl_kv_filter_new(char **, int);
+void    pl_kv_filter_free(pl_kv_filter *);
+ptrdiff_t pl_kv_parse(char *, char, char, char, pl_kv_filter *, pl_kv_pair *, size_t);
+ptrdiff_t pl_kv_parse_n(char *, size_t, char, char, char, pl_kv_filter *, pl_kv_pair *, size_t);
+
+int     pl_parse_i64(pl_span, int64_t *);
+int     pl_parse_u64(pl_span, uint64_t *);
+int     pl_parse_f64(pl_span, double *);
+ptrdiff_t pl_split_to_i64(char *, char *, int64_t *, size_t);
+ptrdiff_t pl_split_to_i64_n(char *, size_t, char *, size_t, int64_t *, size_t);
+
+char    *pl_slice_n(char *, size_t, ptrdiff_t, ptrdiff_t, size_t *);
+int     pl_slice_view(char *, size_t, ptrdiff_t, ptrdiff_t, pl_span *);
+char    *pl_slice_ex(char *, size_t, ptrdiff_t, ptrdiff_t, ptrdiff_t, size_t *);
+char    *pl_cat_n(char *, size_t, char *, size_t, size_t *);
+char    **pl_split_n(char *, size_t, char *, size_t, size_t *, size_t **);
+int     pl_startswith_n(char *, size_t, char *, size_t);
+int     pl_endswith_n(char *, size_t, char *, size_t);
+int     pl_startswith_any_n(char *, size_t, pl_span *, size_t);
+int     pl_endswith_any_n(char *, size_t, pl_span *, size_t);
+int     pl_startswith_ci_n(char *, size_t, char *, size_t);
+char    *pl_strip_n(char *, size_t, char *, size_t, size_t *);
+int     pl_strip_view(char *, size_t, char *, size_t, pl_span *);
+char    *pl_translate_n(char *, size_t, unsigned char *, char *, size_t, size_t *);
+ptrdiff_t pl_translate_into(char *, size_t, unsigned char *, char *, size_t, char *);
+char    **pl_splitlines_n(char *, size_t, int, size_t *, size_t **);
+ptrdiff_t pl_count_n(char *, size_t, char *, size_t);
+char    *pl_expandtabs_n(char *, size_t, int, size_t *);
+ptrdiff_t pl_find_n(char *, size_t, char *, size_t, ptrdiff_t, ptrdiff_t);
+ptrdiff_t pl_rfind_n(char *, size_t, char *, size_t, ptrdiff_t, ptrdiff_t);
+ptrdiff_t pl_index_n(char *, size_t, char *, size_t, ptrdiff_t, ptrdiff_t);
+ptrdiff_t pl_rindex_n(char *, size_t, char *, size_t, ptrdiff_t, ptrdiff_t);
+int     pl_contains_n(char *, size_t, char *, size_t);
+char    *pl_replace_n(char *, size_t, char *, size_t, char *, size_t, ptrdiff_t, size_t *);
+ptrdiff_t pl_count_ci_n(char *, size_t, char *, size_t);
+ptrdiff_t pl_find_ci_n(char *, size_t, char *, size_t, ptrdiff_t, ptrdiff_t);
+int     pl_utf8_validate_n(char *, size_t);
+ptrdiff_t pl_len_cp_n(char *, size_t);
+char    *pl_slice_cp_n(char *, size_t, ptrdiff_t, ptrdiff_t, size_t *);
+char    *pl_lower_n(char *, size_t, char *);
+char    *pl_upper_n(char *, size_t, char *);
+char    *pl_swapcase_n(char *, size_t, char *);
+char    *pl_casefold_ascii_n(char *, size_t, char *);
+
+pl_affixset *pl_affixset_new(char **, int, int);
+int     pl_affixset_match(pl_affixset *, char *);
+void    pl_affixset_free(pl_affixset *);
+
+pl_multi_pattern *pl_multi_pattern_new(char **, int);
+void    pl_multi_pattern_free(pl_multi_pattern *);
+int     pl_count_many(pl_multi_pattern *, char *, int *);
+int     pl_find_any(pl_multi_pattern *, char *, int *);
+int     pl_count_many_n(pl_multi_pattern *, char *, size_t, int *);
+ptrdiff_t pl_find_any_n(pl_multi_pattern *, char *, size_t, int *);
+char    *pl_replace(char *, char *, char *, int);
+char    *pl_replace_many(char *, pl_multi_pattern *, char **);
+int     pl_utf8_validate(char *);
+int     pl_len_cp(char *);
+char    *pl_slice_cp(char *, int, int);
+
+pl_cp_index *pl_cp_index_new(char *);
+pl_cp_index *pl_cp_index_new_n(char *, size_t);
+char    *pl_cp_index_slice(pl_cp_index *, int, int);
+char    *pl_cp_index_slice_n(pl_cp_index *, ptrdiff_t, ptrdiff_t, size_t *);
+int     pl_cp_index_len(pl_cp_index *);
+void    pl_cp_index_free(pl_cp_index *);
+
+char    *pl_lower(char *, char *);
+char    *pl_upper(char *, char *);
+char    *pl_swapcase(char *, char *);
+char    *pl_casefold_ascii(char *, char *);
+int     pl_count_ci(char *, char *);
+int     pl_startswith_ci(char *, char *);
+int     pl_find_ci(char *, char *, int, int);
+
+char    *pl_sstr_data(pl_sstr *);
+size_t  pl_sstr_len(pl_sstr *);
+void    pl_sstr_free(pl_sstr *);
+void    pl_sstr_free_array(pl_sstr *, int);
+pl_sstr *pl_split_sstr(char *, char *, int *);
+int     pl_strip_sstr(char *, char *, pl_sstr *);
+int     pl_slice_sstr(char *, int, int, pl_sstr *);
+pl_sstr *pl_split_sstr_n(char *, size_t, char *, size_t, size_t *);
+int     pl_strip_sstr_n(char *, size_t, char *, size_t, pl_sstr *);
+int     pl_slice_sstr_n(char *, size_t, ptrdiff_t, ptrdiff_t, pl_sstr *);
+
+pl_rcstr *pl_rcstr_new(char *, size_t);
+pl_rcstr *pl_rcstr_retain(pl_rcstr *);
+void    pl_rcstr_release(pl_rcstr *);
+void    pl_rcstr_release_array(pl_rcstr **, int);
+const char *pl_rcstr_data(pl_rcstr *);
+size_t  pl_rcstr_len(pl_rcstr *);
+pl_rcstr **pl_split_rc(char *, char *, int *);
+pl_rcstr *pl_strip_rc(char *, char *);
+pl_rcstr *pl_slice_rc(char *, int, int);
 
 #endif /* PLSTR_H */
@@ -22,10 +22,16 @@
  * THE SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "plstr.h"
+#include "pl_pipeline.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 
 
@@ -1310,50 +1316,3090 @@ void test_expandtabs_no_params() {
 }
 
 
-int main () {
+void test_endswith_long_postfix() {
+    int ret_val = pl_endswith("m.com", "www.m.com");
 
-    test_slice_positive_sub_str();
-    test_slice_equal_offlim();
-    test_slice_negative_offset();
-    test_slice_negative_limit();
-    test_slice_both_negative();
-    test_slice_limit_oor();
-    test_slice_offset_oor();
-    test_slice_empty_string();
-    test_strcpy_no_alloc();
-    test_strcpy_pre_alloc();
-    test_strcpy_not_empty();
-    test_strcpy_empty_paras();
-    test_strcat();
-    test_strcat_empty_source();
-    test_strcat_empty_destination();
-    test_strcat_empty_params();
-    test_split();
-    test_split_multiple_delims();
-    test_split_delim_not_found();
-    test_split_empty_delim();
-    test_split_single_delim();
-    test_split_empty_paras();
-    test_startswith();
-    test_startwith_empy_string();
-    test_startwith_empy_prefix();
-    test_startwith_empty_params();
-    test_endswith();
-    test_endswith_empty_string();
-    test_endswith_empty_postfix();
-    test_endswith_empty_params();
-    test_strip_no_chars();
-    test_strip_with_chars();
-    test_strip_empty_params();
-    test_translate();
-    test_translate_empty_params();
-    test_splitlines();
-    test_splitlines_keepends();
-    test_splitlines_empty_params();
-    test_count();
-    test_count_empty_params();
-    test_expandtabs();
-    test_expandtabs_no_params();
+    assert_equal_int(
+                0,
+                ret_val,
+                "test_endswith_long_postfix",
+                "The string does end with the longer postfix."
+            );
+}
+
+
+void test_startswith_any() {
+    char *prefixes[] = {"ftp://", NULL, "http://"};
+    int ret_val;
+
+    ret_val = pl_startswith_any("http://vg.no", prefixes, 3);
+    assert_equal_int(
+                1,
+                ret_val,
+                "test_startswith_any",
+                "Test 1: The string does not start with any prefix."
+            );
+
+    ret_val = pl_startswith_any("gopher://vg.no", prefixes, 3);
+    assert_equal_int(
+                0,
+                ret_val,
+                "test_startswith_any",
+                "Test 2: The string starts with a prefix."
+            );
+
+    ret_val = pl_startswith_any("", prefixes, 3);
+    assert_equal_int(
+                -1,
+                ret_val,
+                "test_startswith_any",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_endswith_any() {
+    char *postfixes[] = {".net", "", ".com"};
+    int ret_val;
+
+    ret_val = pl_endswith_any("http://yahoo.com", postfixes, 3);
+    assert_equal_int(
+                1,
+                ret_val,
+                "test_endswith_any",
+                "Test 1: The string does not end with any postfix."
+            );
+
+    ret_val = pl_endswith_any("m.org", postfixes, 3);
+    assert_equal_int(
+                0,
+                ret_val,
+                "test_endswith_any",
+                "Test 2: The string ends with a postfix."
+            );
+
+    ret_val = pl_endswith_any("m.org", NULL, 3);
+    assert_equal_int(
+                -1,
+                ret_val,
+                "test_endswith_any",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_affixset_prefix() {
+    char *prefixes[] = {"/api/", "/api/v2/", "/static/", "/api/"};
+    pl_affixset *set = pl_affixset_new(prefixes, 4, PL_PREFIX);
+
+    assert_equal_int(
+                1,
+                pl_affixset_match(set, "/api/v2/users"),
+                "test_affixset_prefix",
+                "Test 1: The longest prefix was not returned."
+            );
+
+    assert_equal_int(
+                0,
+                pl_affixset_match(set, "/api/v1/users"),
+                "test_affixset_prefix",
+                "Test 2: The first duplicate was not returned."
+            );
+
+    assert_equal_int(
+                2,
+                pl_affixset_match(set, "/static/"),
+                "test_affixset_prefix",
+                "Test 3: The exact prefix was not matched."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_affixset_match(set, "/ap"),
+                "test_affixset_prefix",
+                "Test 4: A prefix longer than the string matched."
+            );
+
+    pl_affixset_free(set);
+}
+
+
+void test_affixset_suffix() {
+    char *suffixes[] = {".gz", ".tar.gz", ".c"};
+    pl_affixset *set = pl_affixset_new(suffixes, 3, PL_SUFFIX);
+
+    assert_equal_int(
+                1,
+                pl_affixset_match(set, "plstr.tar.gz"),
+                "test_affixset_suffix",
+                "Test 1: The longest suffix was not returned."
+            );
+
+    assert_equal_int(
+                0,
+                pl_affixset_match(set, "log.gz"),
+                "test_affixset_suffix",
+                "Test 2: The suffix was not matched."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_affixset_match(set, "plstr.h"),
+                "test_affixset_suffix",
+                "Test 3: A suffix matched."
+            );
+
+    pl_affixset_free(set);
+}
+
+
+void test_affixset_empty_params() {
+    char *affixes[] = {"a", ""};
+
+    assert_equal_pointers(
+                NULL,
+                pl_affixset_new(affixes, 2, PL_PREFIX),
+                "test_affixset_empty_params",
+                "Test 1: NULL not returned."
+            );
+
+    assert_equal_pointers(
+                NULL,
+                pl_affixset_new(NULL, 2, PL_PREFIX),
+                "test_affixset_empty_params",
+                "Test 2: NULL not returned."
+            );
+
+    assert_equal_int(
+                -2,
+                pl_affixset_match(NULL, "a"),
+                "test_affixset_empty_params",
+                "Test 3: -2 not returned."
+            );
+}
+
+
+void test_count_many() {
+    char *patterns[] = {"aa", "a", "ab", "aa", "zz"};
+    char the_string[] = "aaaab aab";
+    int counts[5];
+    pl_multi_pattern *mp = pl_multi_pattern_new(patterns, 5);
+
+    int ret_val = pl_count_many(mp, the_string, counts);
+    assert_equal_int(
+                14,
+                ret_val,
+                "test_count_many",
+                "Test 1: The total count is wrong."
+            );
+
+    for (int i = 0; i < 5; i++) {
+        assert_equal_int(
+                    pl_count(the_string, patterns[i]),
+                    counts[i],
+                    "test_count_many",
+                    "Test 2: The count differs from pl_count."
+                );
+    }
+
+    pl_multi_pattern_free(mp);
+}
+
+
+void test_count_many_empty_params() {
+    char *patterns[] = {"a", NULL};
+    char *valid[] = {"a"};
+    int counts[1];
+
+    assert_equal_pointers(
+                NULL,
+                pl_multi_pattern_new(patterns, 2),
+                "test_count_many_empty_params",
+                "Test 1: NULL not returned."
+            );
+
+    pl_multi_pattern *mp = pl_multi_pattern_new(valid, 1);
+
+    assert_equal_int(
+                -1,
+                pl_count_many(mp, "", counts),
+                "test_count_many_empty_params",
+                "Test 2: -1 not returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_count_many(mp, "a", NULL),
+                "test_count_many_empty_params",
+                "Test 3: -1 not returned."
+            );
+
+    pl_multi_pattern_free(mp);
+}
+
+
+void test_find_any() {
+    char *patterns[] = {"world", "o w", "hello", "hello world"};
+    pl_multi_pattern *mp = pl_multi_pattern_new(patterns, 4);
+    int pattern = 0;
+
+    int ret_val = pl_find_any(mp, "say hello world", &pattern);
+    assert_equal_int(
+                4,
+                ret_val,
+                "test_find_any",
+                "Test 1: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                3,
+                pattern,
+                "test_find_any",
+                "Test 2: The longest pattern was not chosen."
+            );
+
+    ret_val = pl_find_any(mp, "hell no", &pattern);
+    assert_equal_int(
+                -1,
+                ret_val,
+                "test_find_any",
+                "Test 3: -1 not returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pattern,
+                "test_find_any",
+                "Test 4: The pattern index was not reset."
+            );
+
+    assert_equal_int(
+                -2,
+                pl_find_any(NULL, "hello", NULL),
+                "test_find_any",
+                "Test 5: -2 not returned."
+            );
+
+    pl_multi_pattern_free(mp);
+}
+
+
+void test_find() {
+    char the_string[] = "spam, eggs, and ham";
+
+    assert_equal_int(
+                2,
+                pl_find(the_string, "am", 0, PL_END),
+                "test_find",
+                "Test 1: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                17,
+                pl_find(the_string, "am", 3, PL_END),
+                "test_find",
+                "Test 2: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_find(the_string, "am", 3, 17),
+                "test_find",
+                "Test 3: The end offset was ignored."
+            );
+
+    assert_equal_int(
+                17,
+                pl_find(the_string, "am", -4, PL_END),
+                "test_find",
+                "Test 4: Negative start not handled."
+            );
+
+    assert_equal_int(
+                5,
+                pl_find(the_string, "", 5, 9),
+                "test_find",
+                "Test 5: Empty sub string not found at start."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_find(the_string, "bacon", 0, PL_END),
+                "test_find",
+                "Test 6: -1 not returned."
+            );
+}
+
+
+void test_find_long_string() {
+    char the_string[200];
+
+    memset(the_string, 'a', sizeof(the_string));
+    the_string[199] = '\0';
+    memcpy(the_string + 150, "needle", 6);
+    memcpy(the_string + 40, "needle", 6);
+
+    assert_equal_int(
+                40,
+                pl_find(the_string, "needle", 0, PL_END),
+                "test_find_long_string",
+                "Test 1: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                150,
+                pl_rfind(the_string, "needle", 0, PL_END),
+                "test_find_long_string",
+                "Test 2: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_find(the_string, "needle", 41, 155),
+                "test_find_long_string",
+                "Test 3: The needle crossing end was found."
+            );
+
+    assert_equal_int(
+                156,
+                pl_find(the_string, "aaaaaa", 151, PL_END),
+                "test_find_long_string",
+                "Test 4: Wrong offset returned at the end."
+            );
+}
+
+
+void test_rfind() {
+    char the_string[] = "spam, eggs, and ham";
+
+    assert_equal_int(
+                10,
+                pl_rfind(the_string, ", ", 0, PL_END),
+                "test_rfind",
+                "Test 1: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                4,
+                pl_rfind(the_string, ", ", 0, -9),
+                "test_rfind",
+                "Test 2: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                19,
+                pl_rfind(the_string, "", 0, PL_END),
+                "test_rfind",
+                "Test 3: Empty sub string not found at the end."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_rfind(the_string, "spam", 1, PL_END),
+                "test_rfind",
+                "Test 4: -1 not returned."
+            );
+}
+
+
+void test_index() {
+    assert_equal_int(
+                6,
+                pl_index("spam, eggs", "eggs", 0, PL_END),
+                "test_index",
+                "Test 1: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_rindex("spam, eggs", "ham", 0, PL_END),
+                "test_index",
+                "Test 2: -1 not returned."
+            );
+
+    assert_equal_int(
+                -2,
+                pl_index(NULL, "ham", 0, PL_END),
+                "test_index",
+                "Test 3: -2 not returned."
+            );
+}
+
+
+void test_contains() {
+    assert_equal_int(
+                1,
+                pl_contains("spam, eggs", "eggs"),
+                "test_contains",
+                "Test 1: 1 not returned."
+            );
+
+    assert_equal_int(
+                0,
+                pl_contains("spam, eggs", "ham"),
+                "test_contains",
+                "Test 2: 0 not returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_contains("spam, eggs", NULL),
+                "test_contains",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_replace() {
+    char the_string[] = "one fish, two fish, red fish";
+    char *ret_val;
+
+    ret_val = pl_replace(the_string, "fish", "salmon", -1);
+    assert_equal_str(
+                "one salmon, two salmon, red salmon",
+                ret_val,
+                "test_replace",
+                "Test 1: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_replace(the_string, "fish", "", 2);
+    assert_equal_str(
+                "one , two , red fish",
+                ret_val,
+                "test_replace",
+                "Test 2: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_replace("aaaa", "aa", "b", -1);
+    assert_equal_str(
+                "bb",
+                ret_val,
+                "test_replace",
+                "Test 3: Overlapping matches were replaced."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_replace(the_string, "cat", "dog", -1);
+    assert_equal_str(
+                the_string,
+                ret_val,
+                "test_replace",
+                "Test 4: The string without matches was changed."
+            );
+
+    free(ret_val);
+}
+
+
+void test_replace_many_matches() {
+    char the_string[100] = "";
+    char expected[200] = "";
+    char *ret_val;
+
+    // More matches than the offsets kept on the stack.
+    for (int i = 0; i < 40; i++) {
+        strcat(the_string, "a-");
+        strcat(expected, "bc-");
+    }
+
+    ret_val = pl_replace(the_string, "a", "bc", -1);
+    assert_equal_str(
+                expected,
+                ret_val,
+                "test_replace_many_matches",
+                "The strings are not equal."
+            );
+
+    free(ret_val);
+}
+
+
+void test_replace_empty_params() {
+    assert_equal_pointers(
+                NULL,
+                pl_replace("spam", "", "x", -1),
+                "test_replace_empty_params",
+                "Test 1: NULL not returned."
+            );
+
+    assert_equal_pointers(
+                NULL,
+                pl_replace("", "a", "x", -1),
+                "test_replace_empty_params",
+                "Test 2: NULL not returned."
+            );
+
+    assert_equal_pointers(
+                NULL,
+                pl_replace("spam", "a", NULL, -1),
+                "test_replace_empty_params",
+                "Test 3: NULL not returned."
+            );
+}
+
+
+void test_replace_many() {
+    char *patterns[] = {"he", "she", "hers", "his"};
+    char *replacements[] = {"1", "2", "", "4444"};
+    pl_multi_pattern *mp = pl_multi_pattern_new(patterns, 4);
+    char *ret_val;
+
+    ret_val = pl_replace_many("ushers and his hero", mp, replacements);
+    assert_equal_str(
+                "u2rs and 4444 1ro",
+                ret_val,
+                "test_replace_many",
+                "Test 1: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_replace_many("nothing", mp, replacements);
+    assert_equal_str(
+                "nothing",
+                ret_val,
+                "test_replace_many",
+                "Test 2: The string without matches was changed."
+            );
+
+    free(ret_val);
+
+    replacements[1] = NULL;
+    assert_equal_pointers(
+                NULL,
+                pl_replace_many("she", mp, replacements),
+                "test_replace_many",
+                "Test 3: NULL not returned."
+            );
+
+    pl_multi_pattern_free(mp);
+}
+
+
+void test_utf8_validate() {
+    assert_equal_int(
+                1,
+                pl_utf8_validate("pl\xc3\xa6str \xe2\x82\xac \xf0\x9f\x98\x80"),
+                "test_utf8_validate",
+                "Test 1: Valid UTF-8 was rejected."
+            );
+
+    assert_equal_int(
+                0,
+                pl_utf8_validate("overlong \xc0\xaf"),
+                "test_utf8_validate",
+                "Test 2: An overlong encoding was accepted."
+            );
+
+    assert_equal_int(
+                0,
+                pl_utf8_validate("surrogate \xed\xa0\x80"),
+                "test_utf8_validate",
+                "Test 3: A surrogate was accepted."
+            );
+
+    assert_equal_int(
+                0,
+                pl_utf8_validate("a long ascii prefix before the cut \xe2\x82"),
+                "test_utf8_validate",
+                "Test 4: A truncated sequence was accepted."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_utf8_validate(NULL),
+                "test_utf8_validate",
+                "Test 5: -1 not returned."
+            );
+}
+
+
+void test_len_cp() {
+    assert_equal_int(
+                14,
+                pl_len_cp("bl\xc3\xa5" "b\xc3\xa6rsyltet\xc3\xb8y"),
+                "test_len_cp",
+                "Test 1: Wrong length returned."
+            );
+
+    assert_equal_int(
+                0,
+                pl_len_cp(""),
+                "test_len_cp",
+                "Test 2: Wrong length returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_len_cp(NULL),
+                "test_len_cp",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_slice_cp() {
+    char the_string[] = "bl\xc3\xa5" "b\xc3\xa6rsyltet\xc3\xb8y";
+    char *ret_val;
+
+    ret_val = pl_slice_cp(the_string, 2, 5);
+    assert_equal_str(
+                "\xc3\xa5" "b\xc3\xa6",
+                ret_val,
+                "test_slice_cp",
+                "Test 1: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_slice_cp(the_string, -2, 14);
+    assert_equal_str(
+                "\xc3\xb8y",
+                ret_val,
+                "test_slice_cp",
+                "Test 2: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_slice_cp(the_string, 3, 15);
+    assert_equal_pointers(
+                NULL,
+                ret_val,
+                "test_slice_cp",
+                "Test 3: A limit outside the string was accepted."
+            );
+
+    ret_val = pl_slice_cp(the_string, 5, 5);
+    assert_equal_pointers(
+                NULL,
+                ret_val,
+                "test_slice_cp",
+                "Test 4: NULL not returned."
+            );
+}
+
+
+void test_cp_index() {
+    char the_string[401] = "";
+    char *ret_val;
+
+    // 200 two byte code points, so the index needs several marks.
+    for (int i = 0; i < 200; i++) {
+        strcat(the_string, i == 130 ? "\xc3\xb8" : "\xc3\xa6");
+    }
+
+    pl_cp_index *index = pl_cp_index_new(the_string);
+
+    assert_equal_int(
+                200,
+                pl_cp_index_len(index),
+                "test_cp_index",
+                "Test 1: Wrong length returned."
+            );
+
+    ret_val = pl_cp_index_slice(index, 129, 132);
+    assert_equal_str(
+                "\xc3\xa6\xc3\xb8\xc3\xa6",
+                ret_val,
+                "test_cp_index",
+                "Test 2: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_cp_index_slice(index, -71, -69);
+    assert_equal_str(
+                "\xc3\xa6\xc3\xb8",
+                ret_val,
+                "test_cp_index",
+                "Test 3: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    assert_equal_pointers(
+                NULL,
+                pl_cp_index_slice(index, 190, 201),
+                "test_cp_index",
+                "Test 4: NULL not returned."
+            );
+
+    pl_cp_index_free(index);
+}
+
+
+void test_lower_upper() {
+    char the_string[] = "Content-Type: Text/HTML; charset=\xc3\x86\xc3\x98";
+    char pre_alloc[64];
+    char *ret_val;
+
+    ret_val = pl_lower(the_string, NULL);
+    assert_equal_str(
+                "content-type: text/html; charset=\xc3\x86\xc3\x98",
+                ret_val,
+                "test_lower_upper",
+                "Test 1: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_upper(the_string, pre_alloc);
+    assert_equal_pointers(
+                pre_alloc,
+                ret_val,
+                "test_lower_upper",
+                "Test 2: The destination was not returned."
+            );
+
+    assert_equal_str(
+                "CONTENT-TYPE: TEXT/HTML; CHARSET=\xc3\x86\xc3\x98",
+                pre_alloc,
+                "test_lower_upper",
+                "Test 3: The strings are not equal."
+            );
+
+    ret_val = pl_casefold_ascii("[@AZ`az{]", NULL);
+    assert_equal_str(
+                "[@az`az{]",
+                ret_val,
+                "test_lower_upper",
+                "Test 4: Characters next to the letters were changed."
+            );
+
+    free(ret_val);
+}
+
+
+void test_swapcase_in_place() {
+    char the_string[] = "Spam, EGGS, and ham, spam, EGGS, and ham";
+
+    pl_swapcase(the_string, the_string);
+    assert_equal_str(
+                "sPAM, eggs, AND HAM, SPAM, eggs, AND HAM",
+                the_string,
+                "test_swapcase_in_place",
+                "The strings are not equal."
+            );
+
+    assert_equal_pointers(
+                NULL,
+                pl_swapcase(NULL, the_string),
+                "test_swapcase_in_place",
+                "NULL not returned."
+            );
+}
+
+
+void test_count_ci() {
+    char the_string[] = "Error: ERROR in error handler, eRRor";
+
+    assert_equal_int(
+                4,
+                pl_count_ci(the_string, "error"),
+                "test_count_ci",
+                "Test 1: Wrong count returned."
+            );
+
+    assert_equal_int(
+                0,
+                pl_count_ci(the_string, "warning"),
+                "test_count_ci",
+                "Test 2: Wrong count returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_count_ci(the_string, ""),
+                "test_count_ci",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_startswith_ci() {
+    assert_equal_int(
+                1,
+                pl_startswith_ci("HTTP://google.com", "http://"),
+                "test_startswith_ci",
+                "Test 1: 1 not returned."
+            );
+
+    assert_equal_int(
+                0,
+                pl_startswith_ci("HTTP", "http://"),
+                "test_startswith_ci",
+                "Test 2: 0 not returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_startswith_ci(NULL, "http://"),
+                "test_startswith_ci",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_find_ci() {
+    char the_string[] = "GET /Index.HTML HTTP/1.1 with a longer tail to search in";
+
+    assert_equal_int(
+                5,
+                pl_find_ci(the_string, "index.html", 0, PL_END),
+                "test_find_ci",
+                "Test 1: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                47,
+                pl_find_ci(the_string, "SEARCH", 0, PL_END),
+                "test_find_ci",
+                "Test 2: Wrong offset returned."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_find_ci(the_string, "index", 6, PL_END),
+                "test_find_ci",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_set_isa() {
+    char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+    char the_string[] = "a long string with the needle close to the end, needle";
+
+    for (int i = 0; i < 4; i++) {
+        if (pl_set_isa(names[i]) != 0) {
+            continue;
+        }
+
+        assert_equal_str(
+                    names[i],
+                    pl_get_isa(),
+                    "test_set_isa",
+                    "Test 1: The kernel set was not switched."
+                );
+
+        assert_equal_int(
+                    48,
+                    pl_rfind(the_string, "needle", 0, PL_END),
+                    "test_set_isa",
+                    "Test 2: Wrong offset returned."
+                );
+    }
+
+    assert_equal_int(
+                -1,
+                pl_set_isa("mmx"),
+                "test_set_isa",
+                "Test 3: -1 not returned."
+            );
+
+    assert_equal_int(
+                0,
+                pl_set_isa(NULL),
+                "test_set_isa",
+                "Test 4: 0 not returned."
+            );
+}
+
+
+void test_strip_everything() {
+    char *ret_val;
+
+    ret_val = pl_strip(" \t\n ", NULL);
+    assert_equal_str(
+                "",
+                ret_val,
+                "test_strip_everything",
+                "Test 1: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_strip("xxxx", "x");
+    assert_equal_str(
+                "",
+                ret_val,
+                "test_strip_everything",
+                "Test 2: The strings are not equal."
+            );
+
+    free(ret_val);
+}
+
+
+void test_split_sstr() {
+    char the_string[] = "short,twenty-two-bytes-token,twenty-three-bytes-tokn,";
+    pl_sstr *ret_val;
+    int size = 0;
+
+    assert_equal_int(
+                24,
+                (int) sizeof(pl_sstr),
+                "test_split_sstr",
+                "Test 1: The small string is not 24 bytes."
+            );
+
+    ret_val = pl_split_sstr(the_string, ",", &size);
+    assert_equal_int(
+                4,
+                size,
+                "test_split_sstr",
+                "Test 2: Wrong size returned."
+            );
+
+    assert_equal_str(
+                "short",
+                pl_sstr_data(&ret_val[0]),
+                "test_split_sstr",
+                "Test 3: The strings are not equal."
+            );
+
+    assert_equal_pointers(
+                ret_val[1].u.inline_data,
+                pl_sstr_data(&ret_val[1]),
+                "test_split_sstr",
+                "Test 4: A 22 byte token was not stored inline."
+            );
+
+    assert_equal_str(
+                "twenty-three-bytes-tokn",
+                pl_sstr_data(&ret_val[2]),
+                "test_split_sstr",
+                "Test 5: The strings are not equal."
+            );
+
+    assert_equal_int(
+                23,
+                (int) pl_sstr_len(&ret_val[2]),
+                "test_split_sstr",
+                "Test 6: Wrong length returned."
+            );
+
+    assert_equal_int(
+                0,
+                (int) pl_sstr_len(&ret_val[3]),
+                "test_split_sstr",
+                "Test 7: The last token is not empty."
+            );
+
+    pl_sstr_free_array(ret_val, size);
+
+    assert_equal_pointers(
+                NULL,
+                pl_split_sstr(the_string, ";", &size),
+                "test_split_sstr",
+                "Test 8: NULL not returned."
+            );
+}
+
+
+void test_strip_sstr() {
+    pl_sstr ret_val;
+
+    assert_equal_int(
+                0,
+                pl_strip_sstr("   lots of space   ", NULL, &ret_val),
+                "test_strip_sstr",
+                "Test 1: 0 not returned."
+            );
+
+    assert_equal_str(
+                "lots of space",
+                pl_sstr_data(&ret_val),
+                "test_strip_sstr",
+                "Test 2: The strings are not equal."
+            );
+
+    pl_sstr_free(&ret_val);
+
+    assert_equal_int(
+                -1,
+                pl_strip_sstr("", "x", &ret_val),
+                "test_strip_sstr",
+                "Test 3: -1 not returned."
+            );
+}
+
+
+void test_slice_sstr() {
+    char the_string[] = "subdermatoglyphic and a much longer tail";
+    pl_sstr ret_val;
+
+    assert_equal_int(
+                0,
+                pl_slice_sstr(the_string, 3, 10, &ret_val),
+                "test_slice_sstr",
+                "Test 1: 0 not returned."
+            );
+
+    assert_equal_str(
+                "dermato",
+                pl_sstr_data(&ret_val),
+                "test_slice_sstr",
+                "Test 2: The strings are not equal."
+            );
+
+    pl_sstr_free(&ret_val);
+
+    pl_slice_sstr(the_string, 0, -1, &ret_val);
+    assert_equal_str(
+                "subdermatoglyphic and a much longer tai",
+                pl_sstr_data(&ret_val),
+                "test_slice_sstr",
+                "Test 3: The strings are not equal."
+            );
+
+    pl_sstr_free(&ret_val);
+
+    assert_equal_int(
+                -1,
+                pl_slice_sstr(the_string, 5, 5, &ret_val),
+                "test_slice_sstr",
+                "Test 4: -1 not returned."
+            );
+}
+
+
+void test_split_n() {
+    char the_string[] = "a\0b,c\0,d";
+    char **ret_val;
+    size_t size = 0, *lengths = NULL;
+
+    ret_val = pl_split_n(the_string, sizeof(the_string) - 1, ",", 1, &size,
+                         &lengths);
+    assert_equal_int(
+                3,
+                (int) size,
+                "test_split_n",
+                "Test 1: Wrong size returned."
+            );
+
+    assert_equal_int(
+                3,
+                (int) lengths[0],
+                "test_split_n",
+                "Test 2: The NUL byte was not kept in the token."
+            );
+
+    assert_equal_int(
+                0,
+                memcmp(ret_val[0], "a\0b", 3),
+                "test_split_n",
+                "Test 3: The token is not correct."
+            );
+
+    for (size_t i = 0; i < size; i++) {
+        free(ret_val[i]);
+    }
+
+    free(ret_val);
+    free(lengths);
+
+    ret_val = pl_split_n(the_string, sizeof(the_string) - 1, "\0", 1, &size,
+                         NULL);
+    assert_equal_int(
+                3,
+                (int) size,
+                "test_split_n",
+                "Test 4: Splitting on NUL gave the wrong size."
+            );
+
+    for (size_t i = 0; i < size; i++) {
+        free(ret_val[i]);
+    }
+
+    free(ret_val);
+}
+
+
+void test_find_n() {
+    char the_string[] = "key\0value\0key\0";
+    size_t length = sizeof(the_string) - 1;
+
+    assert_equal_int(
+                3,
+                (int) pl_find_n(the_string, length, "\0", 1, 0, PL_END_N),
+                "test_find_n",
+                "Test 1: The NUL byte was not found."
+            );
+
+    assert_equal_int(
+                10,
+                (int) pl_rfind_n(the_string, length, "key", 3, 0, PL_END_N),
+                "test_find_n",
+                "Test 2: The match after a NUL byte was not found."
+            );
+
+    assert_equal_int(
+                2,
+                (int) pl_count_n(the_string, length, "key", 3),
+                "test_find_n",
+                "Test 3: Wrong count returned."
+            );
+
+    assert_equal_int(
+                -2,
+                (int) pl_index_n(NULL, length, "key", 3, 0, PL_END_N),
+                "test_find_n",
+                "Test 4: A failure was not reported."
+            );
+
+    assert_equal_int(
+                1,
+                pl_endswith_n(the_string, length, "key\0", 4),
+                "test_find_n",
+                "Test 5: The postfix was not found."
+            );
+}
+
+
+void test_replace_n() {
+    char the_string[] = "a\0b\0c";
+    char *ret_val;
+    size_t length = 0;
+
+    ret_val = pl_replace_n(the_string, 5, "\0", 1, ", ", 2, -1, &length);
+    assert_equal_str(
+                "a, b, c",
+                ret_val,
+                "test_replace_n",
+                "Test 1: The strings are not equal."
+            );
+
+    assert_equal_int(
+                7,
+                (int) length,
+                "test_replace_n",
+                "Test 2: Wrong length returned."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_translate_n(the_string, 5, NULL, "\0", 1, &length);
+    assert_equal_str(
+                "abc",
+                ret_val,
+                "test_replace_n",
+                "Test 3: The NUL bytes were not deleted."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_strip_n("\0\0text\0", 7, "\0", 1, &length);
+    assert_equal_str(
+                "text",
+                ret_val,
+                "test_replace_n",
+                "Test 4: The NUL bytes were not stripped."
+            );
+
+    free(ret_val);
+}
+
+
+void test_translate_high_bytes() {
+    unsigned char table[] = {0xe9, 0};
+    char *ret_val;
+
+    ret_val = pl_translate("caf\xe9", table, "e");
+    assert_equal_str(
+                "cafe",
+                ret_val,
+                "test_translate_high_bytes",
+                "Test 1: A byte above 127 was not translated."
+            );
+
+    free(ret_val);
+}
+
+
+void test_expandtabs_columns() {
+    char *ret_val;
+    size_t length = 0;
+
+    ret_val = pl_expandtabs_n("abcdef\t\tx", 9, 4, &length);
+    assert_equal_str(
+                "abcdef      x",
+                ret_val,
+                "test_expandtabs_columns",
+                "Test 1: The strings are not equal."
+            );
+
+    assert_equal_int(
+                13,
+                (int) length,
+                "test_expandtabs_columns",
+                "Test 2: Wrong length returned."
+            );
+
+    free(ret_val);
+}
+
+
+void test_split_iter() {
+    char the_string[] = "a,,bc,";
+    pl_split_iter iter;
+    pl_span token;
+    char *expected[] = {"a", "", "bc", ""};
+    int count = 0;
+
+    assert_equal_int(
+                0,
+                pl_split_iter_init(&iter, the_string, ","),
+                "test_split_iter",
+                "Test 1: The iterator was not prepared."
+            );
+
+    while (pl_split_iter_next(&iter, &token) == 1) {
+        if (count < 4 && (token.length != strlen(expected[count]) ||
+            memcmp(token.ptr, expected[count], token.length) != 0)) {
+            break;
+        }
+
+        count++;
+    }
+
+    assert_equal_int(
+                4,
+                count,
+                "test_split_iter",
+                "Test 2: The tokens are not correct."
+            );
+
+    assert_equal_int(
+                0,
+                pl_split_iter_next(&iter, &token),
+                "test_split_iter",
+                "Test 3: A finished iterator returned a token."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_split_iter_init(&iter, the_string, ""),
+                "test_split_iter",
+                "Test 4: An empty delimiter was accepted."
+            );
+}
+
+
+void test_split_iter_n() {
+    char the_string[] = "x\0\0y\0\0z";
+    pl_split_iter iter;
+    pl_span token;
+
+    pl_split_iter_init_n(&iter, the_string, sizeof(the_string) - 1, "\0\0", 2);
+    pl_split_iter_next(&iter, &token);
+    pl_split_iter_next(&iter, &token);
+
+    assert_equal_pointers(
+                the_string + 3,
+                token.ptr,
+                "test_split_iter_n",
+                "Test 1: The token does not point into the string."
+            );
+
+    pl_split_iter_next(&iter, &token);
+    assert_equal_int(
+                1,
+                (int) token.length,
+                "test_split_iter_n",
+                "Test 2: The last token has the wrong length."
+            );
+
+    pl_split_iter_init(&iter, "no delimiter", ",");
+    pl_split_iter_next(&iter, &token);
+    assert_equal_int(
+                12,
+                (int) token.length,
+                "test_split_iter_n",
+                "Test 3: The whole string was not returned."
+            );
+}
+
+
+void test_rsplit() {
+    char the_string[] = "a.b.c.d";
+    char **ret_val;
+    int size = 0;
+
+    ret_val = pl_rsplit(the_string, ".", 2, &size);
+    assert_equal_int(
+                3,
+                size,
+                "test_rsplit",
+                "Test 1: Wrong size returned."
+            );
+
+    assert_equal_str(
+                "a.b",
+                ret_val[0],
+                "test_rsplit",
+                "Test 2: The remainder is not the first token."
+            );
+
+    assert_equal_str(
+                "d",
+                ret_val[2],
+                "test_rsplit",
+                "Test 3: The strings are not equal."
+            );
+
+    for (int i = 0; i < size; i++) {
+        free(ret_val[i]);
+    }
+
+    free(ret_val);
+
+    ret_val = pl_rsplit("aaa", "aa", -1, &size);
+    assert_equal_str(
+                "a",
+                ret_val[0],
+                "test_rsplit",
+                "Test 4: The delimiters were not matched from the right."
+            );
+
+    for (int i = 0; i < size; i++) {
+        free(ret_val[i]);
+    }
+
+    free(ret_val);
+
+    assert_equal_pointers(
+                NULL,
+                pl_rsplit(the_string, ",", -1, &size),
+                "test_rsplit",
+                "Test 5: A missing delimiter did not return NULL."
+            );
+}
+
+
+void test_split_ws() {
+    char **ret_val;
+    int size = 0;
+
+    ret_val = pl_split_ws("\t one  two\n\nthree ", &size);
+    assert_equal_int(
+                3,
+                size,
+                "test_split_ws",
+                "Test 1: Wrong size returned."
+            );
+
+    assert_equal_str(
+                "two",
+                ret_val[1],
+                "test_split_ws",
+                "Test 2: The strings are not equal."
+            );
+
+    assert_equal_pointers(
+                NULL,
+                ret_val[3],
+                "test_split_ws",
+                "Test 3: The array does not end with NULL."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_split_ws(" \t\r\n ", &size);
+    assert_equal_int(
+                0,
+                size,
+                "test_split_ws",
+                "Test 4: Only whitespace gave tokens."
+            );
+
+    free(ret_val);
+}
+
+
+void test_split_ws_spans() {
+    char the_string[] = "a                                                                 "
+                        "long-token-across-the-block-boundary   z";
+    pl_span spans[2];
+
+    assert_equal_int(
+                3,
+                (int) pl_split_ws_spans(the_string, strlen(the_string), spans, 2),
+                "test_split_ws_spans",
+                "Test 1: Wrong count returned."
+            );
+
+    assert_equal_pointers(
+                the_string + 66,
+                spans[1].ptr,
+                "test_split_ws_spans",
+                "Test 2: The span does not point into the string."
+            );
+
+    assert_equal_int(
+                36,
+                (int) spans[1].length,
+                "test_split_ws_spans",
+                "Test 3: Wrong length for a token across blocks."
+            );
+}
+
+
+void test_partition() {
+    char the_string[] = "a=b=c";
+    pl_span parts[3];
+
+    assert_equal_int(
+                1,
+                pl_partition(the_string, "=", parts),
+                "test_partition",
+                "Test 1: The separator was not found."
+            );
+
+    assert_equal_pointers(
+                the_string + 2,
+                parts[2].ptr,
+                "test_partition",
+                "Test 2: The tail does not point into the string."
+            );
+
+    assert_equal_int(
+                3,
+                (int) parts[2].length,
+                "test_partition",
+                "Test 3: The tail has the wrong length."
+            );
+
+    pl_rpartition(the_string, "=", parts);
+    assert_equal_int(
+                3,
+                (int) parts[0].length,
+                "test_partition",
+                "Test 4: The head has the wrong length."
+            );
+
+    assert_equal_int(
+                0,
+                pl_rpartition(the_string, ":", parts),
+                "test_partition",
+                "Test 5: A missing separator was found."
+            );
+
+    assert_equal_int(
+                5,
+                (int) parts[2].length,
+                "test_partition",
+                "Test 6: The whole string is not the tail."
+            );
+}
+
+
+void test_partition_many() {
+    char *lines[] = {"a=1", "b", "c=3=4"};
+    pl_span parts[9];
+
+    assert_equal_int(
+                2,
+                (int) pl_partition_many(lines, 3, "=", parts),
+                "test_partition_many",
+                "Test 1: Wrong number of separators found."
+            );
+
+    assert_equal_int(
+                1,
+                (int) parts[3].length,
+                "test_partition_many",
+                "Test 2: The line without a separator is not the head."
+            );
+
+    assert_equal_int(
+                3,
+                (int) parts[8].length,
+                "test_partition_many",
+                "Test 3: The last tail has the wrong length."
+            );
+}
+
+
+void test_cache() {
+    char the_string[] = "abcabcab, abc, abcab";
+    char *ret_val;
+    int size = 0;
+
+    assert_equal_int(
+                -1,
+                pl_cache_enable(0),
+                "test_cache",
+                "Test 1: A cache without room was enabled."
+            );
+
+    assert_equal_int(
+                0,
+                pl_cache_enable(2),
+                "test_cache",
+                "Test 2: The cache was not enabled."
+            );
+
+    pl_set_isa("scalar");
+
+    for (int i = 0; i < 3; i++) {
+        assert_equal_int(
+                    6,
+                    pl_count(the_string, "ab"),
+                    "test_cache",
+                    "Test 3: Wrong count with a cached pattern."
+                );
+
+        char **tokens = pl_split(the_string, ", ", &size);
+        for (int x = 0; x < size; x++) {
+            free(tokens[x]);
+        }
+
+        free(tokens);
+
+        assert_equal_int(
+                    3,
+                    size,
+                    "test_cache",
+                    "Test 4: Wrong size with a cached pattern."
+                );
+    }
+
+    pl_set_isa(NULL);
+
+    ret_val = pl_translate(the_string, NULL, "c, ");
+    assert_equal_str(
+                "abababababab",
+                ret_val,
+                "test_cache",
+                "Test 5: Wrong result after the cache evicted a pattern."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_translate(the_string, (unsigned char *) "abc", "xyz");
+    assert_equal_str(
+                "xyzxyzxy, xyz, xyzxy",
+                ret_val,
+                "test_cache",
+                "Test 6: A delete table was used for a swap table."
+            );
+
+    free(ret_val);
+
+    pl_cache_disable();
+}
+
+
+struct csv_test_rows {
+    int rows;
+    int fields;
+    char last[64];
+    int stop_after;
+};
+
+
+static int csv_test_row(pl_span *fields, size_t count, void *arg) {
+    struct csv_test_rows *result = (struct csv_test_rows *) arg;
+    pl_span *last = &fields[count - 1];
+
+    result->rows++;
+    result->fields += count;
+    memcpy(result->last, last->ptr, last->length);
+    result->last[last->length] = '\0';
+
+    return result->rows == result->stop_after;
+}
+
+
+void test_csv_reader() {
+    char data[] = "a,\"b,\"\"c\"\"\"\r\n\nx,\"multi\nline\",z\n";
+    struct csv_test_rows result = {0, 0, "", 0};
+    pl_csv_reader *reader;
+
+    assert_equal_pointers(
+                NULL,
+                pl_csv_reader_new(',', ',', csv_test_row, &result),
+                "test_csv_reader",
+                "Test 1: The quote and the delimiter can not be the same."
+            );
+
+    reader = pl_csv_reader_new(',', '"', csv_test_row, &result);
+
+    // Feed one byte at a time so every row crosses chunk boundaries.
+    for (size_t i = 0; i < strlen(data); i++) {
+        pl_csv_reader_feed(reader, data + i, 1);
+
+        if (i == 12) {
+            assert_equal_str(
+                        "b,\"c\"",
+                        result.last,
+                        "test_csv_reader",
+                        "Test 2: The quoted field was not unescaped."
+                    );
+        }
+    }
+
+    pl_csv_reader_finish(reader);
+
+    assert_equal_int(
+                2,
+                result.rows,
+                "test_csv_reader",
+                "Test 3: Wrong number of rows, the empty line is skipped."
+            );
+
+    assert_equal_int(
+                5,
+                result.fields,
+                "test_csv_reader",
+                "Test 4: Wrong number of fields."
+            );
+
+    pl_csv_reader_free(reader);
+}
+
+
+void test_csv_reader_stop() {
+    char data[] = "1,2\n3,4\n5,6";
+    struct csv_test_rows result = {0, 0, "", 2};
+    pl_csv_reader *reader;
+
+    reader = pl_csv_reader_new(',', '"', csv_test_row, &result);
+
+    assert_equal_int(
+                1,
+                pl_csv_reader_feed(reader, data, strlen(data)),
+                "test_csv_reader_stop",
+                "Test 1: The callback did not stop the reader."
+            );
+
+    assert_equal_str(
+                "4",
+                result.last,
+                "test_csv_reader_stop",
+                "Test 2: The strings are not equal."
+            );
+
+    result.stop_after = 0;
+    pl_csv_reader_feed(reader, "7,8", 3);
+    pl_csv_reader_finish(reader);
+
+    assert_equal_str(
+                "8",
+                result.last,
+                "test_csv_reader_stop",
+                "Test 3: A row without a newline was not read."
+            );
+
+    pl_csv_reader_free(reader);
+}
+
+
+void test_kv_parse() {
+    char line[] = "  k1=v1 k2=\"v 2\"  junk k3=a=b k4=";
+    pl_kv_pair pairs[2];
+
+    assert_equal_int(
+                4,
+                (int) pl_kv_parse(line, ' ', '=', '"', NULL, pairs, 2),
+                "test_kv_parse",
+                "Test 1: Wrong number of pairs."
+            );
+
+    assert_equal_pointers(
+                line + 12,
+                pairs[1].value.ptr,
+                "test_kv_parse",
+                "Test 2: The quoted value does not point into the line."
+            );
+
+    assert_equal_int(
+                3,
+                (int) pairs[1].value.length,
+                "test_kv_parse",
+                "Test 3: The quoted value has the wrong length."
+            );
+
+    assert_equal_int(
+                -1,
+                (int) pl_kv_parse(line, '=', '=', '"', NULL, pairs, 2),
+                "test_kv_parse",
+                "Test 4: The same separator twice was accepted."
+            );
+}
+
+
+void test_kv_filter() {
+    char line[] = "a=1 bb=2 ccc=3 a=4";
+    char *keys[] = {"a", "ccc", "a"};
+    pl_kv_filter *filter;
+    pl_kv_pair pairs[4];
+
+    filter = pl_kv_filter_new(keys, 3);
+
+    assert_equal_int(
+                3,
+                (int) pl_kv_parse(line, ' ', '=', '\0', filter, pairs, 4),
+                "test_kv_filter",
+                "Test 1: Wrong number of pairs kept."
+            );
+
+    assert_equal_int(
+                3,
+                (int) pairs[1].key.length,
+                "test_kv_filter",
+                "Test 2: The wrong key was kept."
+            );
+
+    assert_equal_pointers(
+                NULL,
+                pl_kv_filter_new(keys, 0),
+                "test_kv_filter",
+                "Test 3: An empty filter was created."
+            );
+
+    pl_kv_filter_free(filter);
+}
+
+
+void test_parse_int() {
+    pl_span span = {"18446744073709551615", 20};
+    uint64_t u;
+    int64_t i;
+
+    assert_equal_int(
+                0,
+                pl_parse_u64(span, &u) + (u != UINT64_MAX),
+                "test_parse_int",
+                "Test 1: The largest u64 was not parsed."
+            );
+
+    span.ptr = "18446744073709551616";
+    assert_equal_int(
+                -1,
+                pl_parse_u64(span, &u),
+                "test_parse_int",
+                "Test 2: An overflow was not reported."
+            );
+
+    span.ptr = "-123456789012";
+    span.length = 13;
+    pl_parse_i64(span, &i);
+    assert_equal_int(
+                1,
+                i == -123456789012LL,
+                "test_parse_int",
+                "Test 3: Wrong value parsed."
+            );
+
+    span.ptr = "12 ";
+    span.length = 3;
+    assert_equal_int(
+                -1,
+                pl_parse_i64(span, &i),
+                "test_parse_int",
+                "Test 4: Trailing whitespace was accepted."
+            );
+}
+
+
+void test_parse_f64() {
+    pl_span span = {"0.1", 3};
+    double value;
+
+    pl_parse_f64(span, &value);
+    assert_equal_int(
+                1,
+                value == 0.1,
+                "test_parse_f64",
+                "Test 1: The fast path was not correctly rounded."
+            );
+
+    span.ptr = "2.2250738585072014e-308";
+    span.length = strlen(span.ptr);
+    pl_parse_f64(span, &value);
+    assert_equal_int(
+                1,
+                value == 2.2250738585072014e-308,
+                "test_parse_f64",
+                "Test 2: Wrong value from the slow path."
+            );
+
+    span.ptr = "1.5e";
+    span.length = 4;
+    assert_equal_int(
+                -1,
+                pl_parse_f64(span, &value),
+                "test_parse_f64",
+                "Test 3: A missing exponent was accepted."
+            );
+}
+
+
+void test_split_to_i64() {
+    int64_t values[4];
+
+    assert_equal_int(
+                3,
+                (int) pl_split_to_i64("5, -6, 7", ", ", values, 4),
+                "test_split_to_i64",
+                "Test 1: Wrong number of values."
+            );
+
+    assert_equal_int(
+                -6,
+                (int) values[1],
+                "test_split_to_i64",
+                "Test 2: Wrong value parsed."
+            );
+
+    assert_equal_int(
+                -1,
+                (int) pl_split_to_i64("5,,7", ",", values, 4),
+                "test_split_to_i64",
+                "Test 3: An empty field was accepted."
+            );
+}
+
+
+struct pipeline_test_sink {
+    long next;
+    int out_of_order;
+    int stop;
+    size_t items;
+};
+
+
+/*
+ * Checks that the items are "line", the line number and "errorx" or "okx",
+ * and that the line numbers come in order.
+ */
+static int pipeline_test_sink(pl_span *items, size_t count, void *arg) {
+    struct pipeline_test_sink *result = (struct pipeline_test_sink *) arg;
+    char number[32];
+
+    for (size_t i = 0; i + 2 < count; i += 3) {
+        memcpy(number, items[i + 1].ptr, items[i + 1].length);
+        number[items[i + 1].length] = '\0';
+
+        if (items[i].length != 4 || memcmp(items[i].ptr, "line", 4) != 0 ||
+            strtol(number, NULL, 10) != result->next) {
+            result->out_of_order = 1;
+        }
+
+        result->next++;
+    }
+
+    result->items += count;
+
+    return result->stop;
+}
+
+
+static int pipeline_test_filter(pl_span item, void *arg) {
+    return item.length > *(size_t *) arg;
+}
+
+
+/*
+ * Writes the test lines to a temporary file, every third line has an ERROR.
+ */
+static FILE *pipeline_test_input(int lines, char *last) {
+    FILE *file = tmpfile();
+
+    for (int i = 0; i < lines; i++) {
+        fprintf(file, "  Line %d %s,X \t\n", i, i % 3 == 0 ? "ERROR" : "OK");
+    }
+
+    if (last != NULL) {
+        fputs(last, file);
+    }
+
+    fflush(file);
+    rewind(file);
+
+    return file;
+}
+
+
+void test_pipeline() {
+    struct pipeline_test_sink result = {0, 0, 0, 0};
+    FILE *file = pipeline_test_input(20000, NULL);
+    pl_pipeline_stats stats;
+    pl_pipeline *pipeline;
+    int errors;
+
+    pipeline = pl_pipeline_new(4, 256, PL_PIPELINE_ORDERED);
+
+    pl_pipeline_strip(pipeline, NULL);
+    errors = pl_pipeline_count(pipeline, "ERROR");
+    pl_pipeline_lower(pipeline);
+    pl_pipeline_translate(pipeline, NULL, ",");
+    pl_pipeline_split(pipeline, " ");
+    pl_pipeline_sink(pipeline, pipeline_test_sink, &result);
+
+    assert_equal_int(
+                0,
+                pl_pipeline_run(pipeline, fileno(file)),
+                "test_pipeline",
+                "Test 1: The run failed."
+            );
+
+    assert_equal_int(
+                6667,
+                (int) pl_pipeline_counter(pipeline, errors),
+                "test_pipeline",
+                "Test 2: Wrong number of errors counted."
+            );
+
+    assert_equal_int(
+                0,
+                result.out_of_order,
+                "test_pipeline",
+                "Test 3: The items did not arrive in input order."
+            );
+
+    assert_equal_int(
+                20000,
+                (int) result.next,
+                "test_pipeline",
+                "Test 4: Wrong number of lines passed to the sink."
+            );
+
+    pl_pipeline_get_stats(pipeline, &stats);
+
+    assert_equal_int(
+                1,
+                stats.lines == 20000 && stats.items == 60000 &&
+                stats.batches > 100,
+                "test_pipeline",
+                "Test 5: Wrong stats."
+            );
+
+    pl_pipeline_free(pipeline);
+    fclose(file);
+}
+
+
+void test_pipeline_unordered() {
+    char last[2000];
+    FILE *file;
+    pl_pipeline_stats stats;
+    pl_pipeline *pipeline;
+    size_t min_length = 4;
+    int errors;
+
+    // A last line that is longer than a batch, without a newline.
+    memset(last, 'x', sizeof(last) - 7);
+    strcpy(last + sizeof(last) - 7, "ERROR");
+    file = pipeline_test_input(5000, last);
+
+    pipeline = pl_pipeline_new(3, 64, PL_PIPELINE_UNORDERED);
+
+    pl_pipeline_split(pipeline, " ");
+    pl_pipeline_filter(pipeline, pipeline_test_filter, &min_length);
+    errors = pl_pipeline_count(pipeline, "ERROR");
+
+    assert_equal_int(
+                0,
+                pl_pipeline_run(pipeline, fileno(file)),
+                "test_pipeline_unordered",
+                "Test 1: The run failed."
+            );
+
+    assert_equal_int(
+                1668,
+                (int) pl_pipeline_counter(pipeline, errors),
+                "test_pipeline_unordered",
+                "Test 2: Wrong number of errors counted."
+            );
+
+    pl_pipeline_get_stats(pipeline, &stats);
+
+    // Only "ERROR,X" and the long line are longer than 4 bytes.
+    assert_equal_int(
+                1,
+                stats.lines == 5001 && stats.items == 1668,
+                "test_pipeline_unordered",
+                "Test 3: Wrong stats."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_pipeline_split(pipeline, ""),
+                "test_pipeline_unordered",
+                "Test 4: An empty delimiter was accepted."
+            );
+
+    pl_pipeline_free(pipeline);
+    fclose(file);
+}
+
+
+void test_pipeline_stop() {
+    struct pipeline_test_sink result = {0, 0, 1, 0};
+    FILE *file = pipeline_test_input(10000, NULL);
+    pl_pipeline *pipeline;
+
+    pipeline = pl_pipeline_new(2, 128, PL_PIPELINE_ORDERED);
+
+    pl_pipeline_strip(pipeline, NULL);
+    pl_pipeline_lower(pipeline);
+    pl_pipeline_split(pipeline, " ");
+    pl_pipeline_sink(pipeline, pipeline_test_sink, &result);
+
+    assert_equal_int(
+                1,
+                pl_pipeline_run(pipeline, fileno(file)),
+                "test_pipeline_stop",
+                "Test 1: The sink did not stop the pipeline."
+            );
+
+    assert_equal_int(
+                1,
+                result.items > 0 && result.next < 10000 && !result.out_of_order,
+                "test_pipeline_stop",
+                "Test 2: The pipeline did not stop after the first batch."
+            );
+
+    pl_pipeline_free(pipeline);
+    fclose(file);
+}
+
+
+struct pipeline_test_files {
+    long next[4];
+    int out_of_order;
+};
+
+
+/*
+ * The items are "<file>:<line>", the lines of every file have to come in
+ * order.
+ */
+static int pipeline_test_files_sink(pl_span *items, size_t count, void *arg) {
+    struct pipeline_test_files *result = (struct pipeline_test_files *) arg;
+    char number[32];
+
+    for (size_t i = 0; i < count; i++) {
+        int file = items[i].ptr[0] - '0';
+
+        memcpy(number, items[i].ptr + 2, items[i].length - 2);
+        number[items[i].length - 2] = '\0';
+
+        long line = strtol(number, NULL, 10);
+
+        if (line != result->next[file]) {
+            result->out_of_order = 1;
+        }
+
+        result->next[file]++;
+    }
+
+    return 0;
+}
+
+
+void test_pipeline_files() {
+    struct pipeline_test_files result = {{0, 0, 0, 0}, 0};
+    pl_pipeline_stats stats;
+    pl_pipeline *pipeline;
+    FILE *files[4];
+    int fds[4], errors;
+
+    for (int i = 0; i < 4; i++) {
+        files[i] = tmpfile();
+
+        for (int x = 0; x < 3000 * (i + 1); x++) {
+            fprintf(files[i], "%d:%d%s\n", i, x, x % 10 == 0 ? " ERROR" : "");
+        }
+
+        fflush(files[i]);
+        rewind(files[i]);
+        fds[i] = fileno(files[i]);
+    }
+
+    pipeline = pl_pipeline_new(3, 512, PL_PIPELINE_ORDERED);
+
+    errors = pl_pipeline_count(pipeline, "ERROR");
+    pl_pipeline_sink(pipeline, pipeline_test_files_sink, &result);
+
+    assert_equal_int(
+                0,
+                pl_pipeline_run_files(pipeline, fds, 4),
+                "test_pipeline_files",
+                "Test 1: The run failed."
+            );
+
+    assert_equal_int(
+                3000,
+                (int) pl_pipeline_counter(pipeline, errors),
+                "test_pipeline_files",
+                "Test 2: Wrong number of errors counted."
+            );
+
+    assert_equal_int(
+                1,
+                !result.out_of_order && result.next[0] == 3000 &&
+                result.next[3] == 12000,
+                "test_pipeline_files",
+                "Test 3: The lines of a file did not arrive in order."
+            );
+
+    pl_pipeline_get_stats(pipeline, &stats);
+
+    assert_equal_int(
+                30000,
+                (int) stats.lines,
+                "test_pipeline_files",
+                "Test 4: Wrong number of lines."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_pipeline_run_files(pipeline, fds, 0),
+                "test_pipeline_files",
+                "Test 5: An empty list of files was accepted."
+            );
+
+    pl_pipeline_free(pipeline);
+
+    for (int i = 0; i < 4; i++) {
+        fclose(files[i]);
+    }
+}
+
+
+void test_translate_kernels() {
+    char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+    char the_string[300], expected[300], table[97], chars[97];
+    char *ret_val;
+    int ok = 1;
+
+    // 96 swapped characters, so every kernel also takes its dense path.
+    for (int i = 0; i < 96; i++) {
+        table[i] = ' ' + i;
+        chars[i] = ' ' + (i + 1) % 96;
+    }
+
+    table[96] = chars[96] = '\0';
+
+    for (int i = 0; i < 299; i++) {
+        the_string[i] = ' ' + (i * 7) % 96;
+        expected[i] = ' ' + ((i * 7) % 96 + 1) % 96;
+    }
+
+    the_string[299] = expected[299] = '\0';
+
+    for (int i = 0; i < 4; i++) {
+        if (pl_set_isa(names[i]) != 0) {
+            continue;
+        }
+
+        ret_val = pl_translate(the_string, (unsigned char *) table, chars);
+        ok &= ret_val != NULL && !strcmp(ret_val, expected);
+        free(ret_val);
+
+        ret_val = pl_translate(the_string, (unsigned char *) "aeiou", "AEIOU");
+        for (int x = 0; ret_val != NULL && x < 299; x++) {
+            ok &= ret_val[x] == (strchr("aeiou", the_string[x]) != NULL ?
+                                 the_string[x] - 32 : the_string[x]);
+        }
+
+        free(ret_val);
+    }
+
+    pl_set_isa(NULL);
+
+    assert_equal_int(
+                1,
+                ok,
+                "test_translate_kernels",
+                "Test 1: A kernel translated the string wrong."
+            );
+}
+
+
+void test_translate_delete_kernels() {
+    char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+    char *sets[] = {",", "!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"};
+    char the_string[400], expected[400];
+    size_t length;
+    char *ret_val;
+    int ok = 1;
+
+    for (int i = 0; i < 399; i++) {
+        the_string[i] = "Hello, World! (a test; of: deletion)"[i % 36];
+    }
+
+    the_string[399] = '\0';
+
+    for (int s = 0; s < 2; s++) {
+        length = 0;
+
+        for (int i = 0; i < 399; i++) {
+            if (strchr(sets[s], the_string[i]) == NULL) {
+                expected[length++] = the_string[i];
+            }
+        }
+
+        expected[length] = '\0';
+
+        for (int i = 0; i < 4; i++) {
+            if (pl_set_isa(names[i]) != 0) {
+                continue;
+            }
+
+            ret_val = pl_translate(the_string, NULL, sets[s]);
+            ok &= ret_val != NULL && !strcmp(ret_val, expected);
+            free(ret_val);
+        }
+    }
+
+    pl_set_isa(NULL);
+
+    assert_equal_int(
+                1,
+                ok,
+                "test_translate_delete_kernels",
+                "Test 1: A kernel deleted the wrong characters."
+            );
+}
+
+
+void test_strip_padded() {
+    char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+    char record[4100];
+    char *ret_val;
+    int ok = 1;
+
+    memset(record, ' ', sizeof(record) - 1);
+    record[sizeof(record) - 1] = '\0';
+    memcpy(record + 1500, "id=7\tname", 9);
+    record[3000] = '\n';
+
+    for (int i = 0; i < 4; i++) {
+        if (pl_set_isa(names[i]) != 0) {
+            continue;
+        }
+
+        ret_val = pl_strip(record, NULL);
+        ok &= ret_val != NULL && !strcmp(ret_val, "id=7\tname");
+        free(ret_val);
+
+        ret_val = pl_strip(record, " \n");
+        ok &= ret_val != NULL && !strcmp(ret_val, "id=7\tname");
+        free(ret_val);
+
+        ret_val = pl_strip(record, " ");
+        ok &= ret_val != NULL && strlen(ret_val) == 3000 - 1500 + 1;
+        free(ret_val);
+    }
+
+    pl_set_isa(NULL);
+
+    assert_equal_int(
+                1,
+                ok,
+                "test_strip_padded",
+                "Test 1: A kernel stripped a padded record wrong."
+            );
+}
+
+
+void test_slice_view() {
+    char the_string[] = "subdermatoglyphic";
+    pl_span view = {NULL, 0};
+
+    assert_equal_int(
+                0,
+                pl_slice_view(the_string, strlen(the_string), 3, -7, &view),
+                "test_slice_view",
+                "Test 1: 0 not returned."
+            );
+
+    assert_equal_int(
+                1,
+                view.ptr == the_string + 3 && view.length == 7,
+                "test_slice_view",
+                "Test 2: The view does not point into the string."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_slice_view(the_string, strlen(the_string), 5, 5, &view),
+                "test_slice_view",
+                "Test 3: -1 not returned for an empty slice."
+            );
+}
+
+
+void test_slice_ex() {
+    char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+    char the_string[301], reversed[301], even[151];
+    size_t length = 0;
+    char *ret_val;
+    int ok = 1;
+
+    for (int i = 0; i < 300; i++) {
+        the_string[i] = 'a' + i % 26;
+        reversed[299 - i] = the_string[i];
+
+        if (i % 2 == 0) {
+            even[i / 2] = the_string[i];
+        }
+    }
+
+    the_string[300] = reversed[300] = even[150] = '\0';
+
+    for (int i = 0; i < 4; i++) {
+        if (pl_set_isa(names[i]) != 0) {
+            continue;
+        }
+
+        ret_val = pl_slice_ex(the_string, 300, PL_SLICE_NONE, PL_SLICE_NONE, -1, NULL);
+        ok &= ret_val != NULL && !strcmp(ret_val, reversed);
+        free(ret_val);
+
+        ret_val = pl_slice_ex(the_string, 300, PL_SLICE_NONE, PL_SLICE_NONE, 2, NULL);
+        ok &= ret_val != NULL && !strcmp(ret_val, even);
+        free(ret_val);
+    }
+
+    pl_set_isa(NULL);
+
+    assert_equal_int(
+                1,
+                ok,
+                "test_slice_ex",
+                "Test 1: A kernel sliced the string wrong."
+            );
+
+    ret_val = pl_slice_ex("0123456789", 10, -2, -100, -3, &length);
+
+    assert_equal_str(
+                "852",
+                ret_val,
+                "test_slice_ex",
+                "Test 2: The strings are not equal."
+            );
+
+    free(ret_val);
+
+    ret_val = pl_slice_ex("0123456789", 10, 7, 3, 1, &length);
+
+    assert_equal_int(
+                1,
+                ret_val != NULL && length == 0 && *ret_val == '\0',
+                "test_slice_ex",
+                "Test 3: An empty slice did not return an empty string."
+            );
+
+    free(ret_val);
+
+    assert_equal_pointers(
+                NULL,
+                pl_slice_ex("0123456789", 10, 0, 5, 0, NULL),
+                "test_slice_ex",
+                "Test 4: A step of 0 was accepted."
+            );
+}
+
+
+void test_cpy_n() {
+    char the_string[] = "This is a short string.";
+    char buffer[10];
+    size_t length = 0;
+    int ret_val;
+
+    ret_val = pl_cpy_n(buffer, sizeof(buffer), the_string, strlen(the_string), &length);
+
+    assert_equal_int(
+                1,
+                ret_val == 1 && length == 9 && !strcmp(buffer, "This is a"),
+                "test_cpy_n",
+                "Test 1: A long string was not truncated."
+            );
+
+    ret_val = pl_cpy_n(buffer, sizeof(buffer), "abc\0def", 7, &length);
+
+    assert_equal_int(
+                1,
+                ret_val == 0 && length == 7 && !memcmp(buffer, "abc\0def", 8),
+                "test_cpy_n",
+                "Test 2: A string with a NUL byte was not copied."
+            );
+
+    ret_val = pl_cpy_n(buffer, 1, the_string, strlen(the_string), &length);
+
+    assert_equal_int(
+                1,
+                ret_val == 1 && length == 0 && buffer[0] == '\0',
+                "test_cpy_n",
+                "Test 3: A one byte buffer was not left empty."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_cpy_n(buffer, 0, the_string, 1, NULL),
+                "test_cpy_n",
+                "Test 4: A zero capacity did not fail."
+            );
+}
+
+
+void test_dup_into_arena() {
+    pl_arena *arena = pl_arena_new(64);
+    char large[100];
+    char *copies[20];
+    int ok = 1;
+
+    memset(large, 'x', sizeof(large));
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 20; i++) {
+            copies[i] = pl_dup_into_arena(arena, i == 7 ? large : "token", i == 7 ? 100 : 5);
+        }
+
+        for (int i = 0; i < 20; i++) {
+            if (i == 7) {
+                ok &= copies[i] != NULL && !memcmp(copies[i], large, 100) && copies[i][100] == '\0';
+            }
+
+            else {
+                ok &= copies[i] != NULL && !strcmp(copies[i], "token");
+            }
+        }
+
+        pl_arena_reset(arena);
+    }
+
+    assert_equal_int(
+                1,
+                ok,
+                "test_dup_into_arena",
+                "Test 1: A copy in the arena was overwritten."
+            );
+
+    assert_equal_pointers(
+                NULL,
+                pl_dup_into_arena(NULL, "token", 5),
+                "test_dup_into_arena",
+                "Test 2: A NULL arena did not fail."
+            );
+
+    pl_arena_free(arena);
+}
+
+
+void test_split_rc() {
+    char the_string[] = "GET,/index.html,,200";
+    char *expected[] = {"GET", "/index.html", "", "200"};
+    pl_rcstr **tokens, *kept = NULL;
+    int size = 0, ok = 1;
+
+    tokens = pl_split_rc(the_string, ",", &size);
+
+    assert_equal_int(
+                4,
+                size,
+                "test_split_rc",
+                "Test 1: The size is not correct."
+            );
+
+    for (int i = 0; tokens != NULL && i < size; i++) {
+        ok &= !strcmp(pl_rcstr_data(tokens[i]), expected[i]) &&
+              pl_rcstr_len(tokens[i]) == strlen(expected[i]);
+    }
+
+    assert_equal_int(
+                1,
+                ok,
+                "test_split_rc",
+                "Test 2: A token is not correct."
+            );
+
+    if (tokens != NULL) {
+        kept = pl_rcstr_retain(tokens[3]);
+        pl_rcstr_release_array(tokens, size);
+    }
+
+    assert_equal_int(
+                0,
+                kept == NULL ? -1 : strcmp(pl_rcstr_data(kept), "200"),
+                "test_split_rc",
+                "Test 3: A retained token did not outlive the array."
+            );
+
+    pl_rcstr_release(kept);
+
+    assert_equal_pointers(
+                NULL,
+                pl_split_rc(the_string, ";", &size),
+                "test_split_rc",
+                "Test 4: A missing delimiter did not return NULL."
+            );
+}
+
+
+void test_strip_slice_rc() {
+    pl_rcstr *ret_val;
+    const char *data;
+
+    ret_val = pl_strip_rc("  padded value \n", NULL);
+    data = pl_rcstr_data(ret_val);
+
+    assert_equal_int(
+                0,
+                data == NULL ? -1 : strcmp(data, "padded value"),
+                "test_strip_slice_rc",
+                "Test 1: The strings are not equal."
+            );
+
+    pl_rcstr_release(ret_val);
+
+    ret_val = pl_slice_rc("Hello, world", 7, 12);
+    data = pl_rcstr_data(ret_val);
+
+    assert_equal_int(
+                0,
+                data == NULL ? -1 : strcmp(data, "world"),
+                "test_strip_slice_rc",
+                "Test 2: The strings are not equal."
+            );
+
+    pl_rcstr_release(ret_val);
+
+    assert_equal_pointers(
+                NULL,
+                pl_slice_rc("Hello", 4, 2),
+                "test_strip_slice_rc",
+                "Test 3: An invalid slice did not return NULL."
+            );
+}
+
+
+static void *rcstr_consumer(void *arg) {
+    pl_rcstr *token = (pl_rcstr *) arg;
+    size_t sum = 0;
+
+    for (int i = 0; i < 10000; i++) {
+        pl_rcstr *mine = pl_rcstr_retain(token);
+
+        sum += pl_rcstr_len(mine) + (unsigned char) pl_rcstr_data(mine)[0];
+        pl_rcstr_release(mine);
+    }
+
+    pl_rcstr_release(token);
+
+    return (void *) sum;
+}
+
+
+void test_rcstr_threads() {
+    pthread_t threads[4];
+    pl_rcstr *token = pl_rcstr_new("shared token", 12);
+    void *sum;
+    int ok = token != NULL;
+
+    for (int i = 0; ok && i < 4; i++) {
+        ok &= pthread_create(&threads[i], NULL, rcstr_consumer,
+                             pl_rcstr_retain(token)) == 0;
+    }
+
+    pl_rcstr_release(token);
+
+    for (int i = 0; ok && i < 4; i++) {
+        pthread_join(threads[i], &sum);
+        ok &= (size_t) sum == 10000 * (12 + 's');
+    }
+
+    assert_equal_int(
+                1,
+                ok,
+                "test_rcstr_threads",
+                "Test 1: A thread did not see the shared string."
+            );
+}
+
+
+static double replace_many_seconds(char *text, int pattern_length) {
+    char *pattern = (char *) malloc(pattern_length + 2);
+    char *patterns[] = {"a", pattern};
+    char *replacements[] = {"x", "y"};
+    pl_multi_pattern *mp;
+    char *ret_val;
+    clock_t start;
+
+    memset(pattern, 'a', pattern_length);
+    pattern[pattern_length] = 'b';
+    pattern[pattern_length + 1] = '\0';
+
+    mp = pl_multi_pattern_new(patterns, 2);
+    start = clock();
+    ret_val = pl_replace_many(text, mp, replacements);
+    start = clock() - start;
+
+    free(ret_val);
+    free(pattern);
+    pl_multi_pattern_free(mp);
+
+    return (double) start / CLOCKS_PER_SEC;
+}
+
+
+void test_replace_many_single_pass() {
+    char *patterns[] = {"a", "aaab"};
+    char *replacements[] = {"x", "y"};
+    pl_multi_pattern *mp = pl_multi_pattern_new(patterns, 2);
+    size_t length = 1 << 20;
+    char *text = (char *) malloc(length + 1);
+    char *ret_val;
+
+    ret_val = pl_replace_many("aacaaabaa", mp, replacements);
+    assert_equal_str(
+                "xxcyxx",
+                ret_val,
+                "test_replace_many_single_pass",
+                "Test 1: The strings are not equal."
+            );
+
+    free(ret_val);
+    pl_multi_pattern_free(mp);
+
+    memset(text, 'a', length);
+    text[length] = '\0';
+
+    // A long pattern that almost matches everywhere must not rescan the text.
+    double short_seconds = replace_many_seconds(text, 1);
+    double long_seconds = replace_many_seconds(text, 512);
+
+    assert_equal_int(
+                1,
+                long_seconds < 4 * short_seconds + 0.05,
+                "test_replace_many_single_pass",
+                "Test 2: The time grew with the length of the patterns."
+            );
+
+    free(text);
+}
+
+
+void test_affix_n() {
+    char the_string[] = "GET\0/index.html\0";
+    size_t length = sizeof(the_string) - 1;
+    pl_span prefixes[] = {{"POST", 4}, {NULL, 0}, {"get\0", 4}};
+    pl_span postfixes[] = {{".html", 5}, {"html\0", 5}};
+
+    assert_equal_int(
+                1,
+                pl_startswith_ci_n(the_string, length, "get\0/", 5),
+                "test_affix_n",
+                "Test 1: The prefix with a NUL byte was not found."
+            );
+
+    assert_equal_int(
+                0,
+                pl_startswith_any_n(the_string, length, prefixes, 2),
+                "test_affix_n",
+                "Test 2: A prefix matched that should not."
+            );
+
+    prefixes[2].ptr = "GET\0";
+
+    assert_equal_int(
+                1,
+                pl_startswith_any_n(the_string, length, prefixes, 3),
+                "test_affix_n",
+                "Test 3: The prefix with a NUL byte was not found."
+            );
+
+    assert_equal_int(
+                1,
+                pl_endswith_any_n(the_string, length, postfixes, 2),
+                "test_affix_n",
+                "Test 4: The postfix with a NUL byte was not found."
+            );
+
+    assert_equal_int(
+                -1,
+                pl_endswith_any_n(the_string, 0, postfixes, 2),
+                "test_affix_n",
+                "Test 5: -1 not returned."
+            );
+}
+
+
+void test_slice_cp_n() {
+    char the_string[] = "bl\xc3\xa5\0b\xc3\xa6r";
+    size_t length = 0;
+    char *ret_val;
+
+    ret_val = pl_slice_cp_n(the_string, sizeof(the_string) - 1, 2, -1, &length);
+
+    assert_equal_int(
+                1,
+                ret_val != NULL && length == 6 && !memcmp(ret_val, "\xc3\xa5\0b\xc3\xa6", 6),
+                "test_slice_cp_n",
+                "Test 1: The slice over a NUL byte is not correct."
+            );
+
+    free(ret_val);
+
+    assert_equal_pointers(
+                NULL,
+                pl_slice_cp_n(the_string, sizeof(the_string) - 1, 3, 3, NULL),
+                "test_slice_cp_n",
+                "Test 2: NULL not returned."
+            );
+}
+
+
+void test_sstr_n() {
+    char the_string[] = " a\0b, c ";
+    size_t length = sizeof(the_string) - 1, size = 0;
+    pl_sstr *tokens, ret_val;
+
+    tokens = pl_split_sstr_n(the_string, length, ",", 1, &size);
+
+    assert_equal_int(
+                1,
+                tokens != NULL && size == 2 && pl_sstr_len(&tokens[0]) == 4 &&
+                !memcmp(pl_sstr_data(&tokens[0]), " a\0b", 4),
+                "test_sstr_n",
+                "Test 1: The token with a NUL byte is not correct."
+            );
+
+    pl_sstr_free_array(tokens, (int) size);
+
+    assert_equal_int(
+                0,
+                pl_strip_sstr_n(the_string, length, NULL, 0, &ret_val),
+                "test_sstr_n",
+                "Test 2: 0 not returned."
+            );
+
+    assert_equal_int(
+                1,
+                pl_sstr_len(&ret_val) == 6 &&
+                !memcmp(pl_sstr_data(&ret_val), "a\0b, c", 6),
+                "test_sstr_n",
+                "Test 3: The stripped string is not correct."
+            );
+
+    pl_sstr_free(&ret_val);
+
+    assert_equal_int(
+                0,
+                pl_slice_sstr_n(the_string, length, 1, -1, &ret_val),
+                "test_sstr_n",
+                "Test 4: 0 not returned."
+            );
+
+    assert_equal_int(
+                1,
+                pl_sstr_len(&ret_val) == 6 &&
+                !memcmp(pl_sstr_data(&ret_val), "a\0b, c", 6),
+                "test_sstr_n",
+                "Test 5: The slice is not correct."
+            );
+
+    pl_sstr_free(&ret_val);
+}
+
+
+void test_cp_index_n() {
+    char the_string[] = "\xc3\xa6\0\xc3\xb8\0\xc3\xa5";
+    pl_cp_index *index = pl_cp_index_new_n(the_string, sizeof(the_string) - 1);
+    size_t length = 0;
+    char *ret_val;
+
+    assert_equal_int(
+                5,
+                pl_cp_index_len(index),
+                "test_cp_index_n",
+                "Test 1: The NUL bytes were not counted."
+            );
+
+    ret_val = pl_cp_index_slice_n(index, 1, -1, &length);
+
+    assert_equal_int(
+                1,
+                ret_val != NULL && length == 4 && !memcmp(ret_val, "\0\xc3\xb8\0", 4),
+                "test_cp_index_n",
+                "Test 2: The slice is not correct."
+            );
+
+    free(ret_val);
+    pl_cp_index_free(index);
+}
+
+
+/*
+ * Writes a line to the pipe every 30 ms, and closes it after ten lines.
+ */
+static void *pipeline_slow_writer(void *arg) {
+    int fd = *(int *) arg;
+    struct timespec pause = {0, 30000000};
+
+    for (int i = 0; i < 10; i++) {
+        if (write(fd, "slow line\n", 10) != 10) {
+            break;
+        }
+
+        nanosleep(&pause, NULL);
+    }
+
+    close(fd);
+
+    return NULL;
+}
+
+
+void test_pipeline_idle() {
+    struct pipeline_test_sink result = {0, 0, 0, 0};
+    pl_pipeline_stats stats;
+    pl_pipeline *pipeline;
+    pthread_t writer;
+    int fds[2];
+    clock_t cpu;
+
+    if (pipe(fds) != 0) {
+        return;
+    }
+
+    pipeline = pl_pipeline_new(4, 256, PL_PIPELINE_ORDERED);
+    pl_pipeline_split(pipeline, " ");
+    pl_pipeline_sink(pipeline, pipeline_test_sink, &result);
+
+    cpu = clock();
+    pthread_create(&writer, NULL, pipeline_slow_writer, &fds[1]);
+    pl_pipeline_run(pipeline, fds[0]);
+    pthread_join(writer, NULL);
+    cpu = clock() - cpu;
+
+    pl_pipeline_get_stats(pipeline, &stats);
+
+    assert_equal_int(
+                20,
+                (int) result.items,
+                "test_pipeline_idle",
+                "Test 1: Wrong number of items passed to the sink."
+            );
+
+    // Threads that wait for input must sleep, not spin on a core each.
+    assert_equal_int(
+                1,
+                (double) cpu / CLOCKS_PER_SEC < 0.5 * stats.elapsed_seconds,
+                "test_pipeline_idle",
+                "Test 2: The waiting threads used the CPU."
+            );
+
+    assert_equal_int(
+                1,
+                stats.worker_waits > 0 && stats.sink_waits > 0,
+                "test_pipeline_idle",
+                "Test 3: The waits were not counted."
+            );
+
+    pl_pipeline_free(pipeline);
+    close(fds[0]);
+}
+
+
+void test_translate_into() {
+    char the_string[] = "a-b-c\0-d";
+    char buffer[sizeof(the_string)];
+
+    assert_equal_int(
+                1,
+                pl_translate_into(the_string, sizeof(the_string) - 1, NULL,
+                                  "-\0", 2, buffer) == 4 &&
+                !strcmp(buffer, "abcd"),
+                "test_translate_into",
+                "Test 1: The characters were not deleted."
+            );
+
+    assert_equal_int(
+                1,
+                pl_translate_into(the_string, 5, (unsigned char *) "-", "+", 1,
+                                  buffer) == 5 &&
+                !strcmp(buffer, "a+b+c"),
+                "test_translate_into",
+                "Test 2: The characters were not swapped."
+            );
+
+    assert_equal_int(
+                1,
+                pl_translate_into(the_string, 0, NULL, "-", 1, buffer) == 0 &&
+                buffer[0] == '\0',
+                "test_translate_into",
+                "Test 3: An empty string did not give an empty result."
+            );
+
+    assert_equal_int(
+                -1,
+                (int) pl_translate_into(the_string, 5, NULL, "-", 1, NULL),
+                "test_translate_into",
+                "Test 4: -1 not returned."
+            );
+}
+
+
+int main () {
+
+    test_slice_positive_sub_str();
+    test_slice_equal_offlim();
+    test_slice_negative_offset();
+    test_slice_negative_limit();
+    test_slice_both_negative();
+    test_slice_limit_oor();
+    test_slice_offset_oor();
+    test_slice_empty_string();
+    test_strcpy_no_alloc();
+    test_strcpy_pre_alloc();
+    test_strcpy_not_empty();
+    test_strcpy_empty_paras();
+    test_strcat();
+    test_strcat_empty_source();
+    test_strcat_empty_destination();
+    test_strcat_empty_params();
+    test_split();
+    test_split_multiple_delims();
+    test_split_delim_not_found();
+    test_split_empty_delim();
+    test_split_single_delim();
+    test_split_empty_paras();
+    test_startswith();
+    test_startwith_empy_string();
+    test_startwith_empy_prefix();
+    test_startwith_empty_params();
+    test_endswith();
+    test_endswith_empty_string();
+    test_endswith_empty_postfix();
+    test_endswith_empty_params();
+    test_strip_no_chars();
+    test_strip_with_chars();
+    test_strip_empty_params();
+    test_translate();
+    test_translate_empty_params();
+    test_splitlines();
+    test_splitlines_keepends();
+    test_splitlines_empty_params();
+    test_count();
+    test_count_empty_params();
+    test_expandtabs();
+    test_expandtabs_no_params();
+
+    test_endswith_long_postfix();
+    test_startswith_any();
+    test_endswith_any();
+    test_affixset_prefix();
+    test_affixset_suffix();
+    test_affixset_empty_params();
+
+    test_count_many();
+    test_count_many_empty_params();
+    test_find_any();
+
+    test_find();
+    test_find_long_string();
+    test_rfind();
+    test_index();
+    test_contains();
+
+    test_replace();
+    test_replace_many_matches();
+    test_replace_empty_params();
+    test_replace_many();
+
+    test_utf8_validate();
+    test_len_cp();
+    test_slice_cp();
+    test_cp_index();
+
+    test_lower_upper();
+    test_swapcase_in_place();
+    test_count_ci();
+    test_startswith_ci();
+    test_find_ci();
+
+    test_set_isa();
+
+    test_strip_everything();
+    test_split_sstr();
+    test_strip_sstr();
+    test_slice_sstr();
+
+    test_split_n();
+    test_find_n();
+    test_replace_n();
+    test_translate_high_bytes();
+    test_expandtabs_columns();
+
+    test_split_iter();
+    test_split_iter_n();
+
+    test_rsplit();
+
+    test_split_ws();
+    test_split_ws_spans();
+
+    test_partition();
+    test_partition_many();
+
+    test_cache();
+
+    test_csv_reader();
+    test_csv_reader_stop();
+
+    test_kv_parse();
+    test_kv_filter();
+
+    test_parse_int();
+    test_parse_f64();
+    test_split_to_i64();
+
+    test_pipeline();
+    test_pipeline_unordered();
+    test_pipeline_stop();
+
+    test_pipeline_files();
+
+    test_translate_kernels();
+
+    test_translate_delete_kernels();
+
+    test_strip_padded();
+
+    test_slice_view();
+    test_slice_ex();
+
+    test_cpy_n();
+    test_dup_into_arena();
+
+    test_split_rc();
+    test_strip_slice_rc();
+    test_rcstr_threads();
+
+    test_replace_many_single_pass();
+
+    test_affix_n();
+    test_slice_cp_n();
+    test_sstr_n();
+
+    test_cp_index_n();
+
+    test_pipeline_idle();
+
+    test_translate_into();
 
     return 0;
 }